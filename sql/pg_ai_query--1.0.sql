@@ -29,6 +29,35 @@ Parameters:
 Returns: Generated SQL query string
 Example: SELECT generate_query(''show top 10 products by sales'', ''sk-...'', ''openai'');';
 
+-- Generate a query and return its result rows
+CREATE OR REPLACE FUNCTION ai_query(
+    natural_language_query text,
+    api_key text DEFAULT NULL,
+    provider text DEFAULT 'auto',
+    max_rows integer DEFAULT NULL
+)
+RETURNS SETOF jsonb
+AS 'MODULE_PATHNAME', 'ai_query'
+LANGUAGE C
+VOLATILE;
+
+-- Example usage:
+-- SELECT * FROM ai_query('Count orders by status');
+-- SELECT row->>'status', (row->>'count')::bigint
+--   FROM ai_query('Count orders by status') AS row;
+-- SELECT * FROM ai_query('Show me all users', max_rows => 50);
+
+COMMENT ON FUNCTION ai_query(text, text, text, integer) IS
+'Generate a PostgreSQL SELECT query from natural language, as generate_query does, and return its result with one jsonb object per row.
+Only a single read-only SELECT is executed. Queries that call a volatile function anywhere, including through views (nextval, dblink_exec, random, ...), are rejected, so the query has no side effects beyond those of stable and immutable functions; queries whose estimated cost exceeds pg_ai_query.max_query_cost are rejected as well.
+Parameters:
+  - natural_language_query: Natural language description of desired query
+  - api_key: API key for the AI provider (NULL to use config file)
+  - provider: AI provider name (openai, anthropic, gemini, or auto)
+  - max_rows: Rows returned at most (NULL for default_limit when enforce_limit is on, otherwise all rows)
+Returns: One jsonb object per result row, keyed by column name
+Example: SELECT * FROM ai_query(''top 10 products by sales'');';
+
 -- Get all tables in the database with metadata
 CREATE OR REPLACE FUNCTION get_database_tables()
 RETURNS text
@@ -88,3 +117,232 @@ Parameters:
 Returns: JSON with raw explain output and AI-generated performance insights
 Example: SELECT explain_query(''SELECT * FROM products ORDER BY price DESC LIMIT 10'', ''sk-...'', ''anthropic'');';
 
+-- Model routing statistics for the current session
+CREATE OR REPLACE FUNCTION get_routing_stats()
+RETURNS text
+AS 'MODULE_PATHNAME', 'get_routing_stats'
+LANGUAGE C
+VOLATILE;
+
+-- Example usage:
+-- SELECT get_routing_stats();
+
+COMMENT ON FUNCTION get_routing_stats() IS
+'Returns JSON with the number of generate_query model calls per tier in the current session.
+"fast" counts requests tried on the configured fast_model, how many of its answers were returned (accepted) or escalated, and the hit rate.
+"strong" counts calls to the default model: complex requests, escalations, and all requests when no fast_model is set.
+Example: SELECT get_routing_stats();';
+
+-- Accepted (request, SQL) pairs reused by generate_query
+CREATE TABLE pg_ai_query_history (
+    id bigserial PRIMARY KEY,
+    schema_version text NOT NULL,
+    natural_language_query text NOT NULL,
+    query text NOT NULL,
+    -- Every table and view the query reads, including those under views
+    relids oid[] NOT NULL DEFAULT '{}',
+    accepted_by name NOT NULL DEFAULT session_user,
+    accepted_at timestamptz NOT NULL DEFAULT now()
+);
+
+CREATE INDEX pg_ai_query_history_version_idx
+    ON pg_ai_query_history (schema_version, accepted_at DESC);
+
+-- Keep accepted queries in pg_dump output
+SELECT pg_catalog.pg_extension_config_dump('pg_ai_query_history', '');
+SELECT pg_catalog.pg_extension_config_dump('pg_ai_query_history_id_seq', '');
+
+-- generate_query reads the history as the calling user, who only sees
+-- queries over relations it can select from
+GRANT SELECT ON pg_ai_query_history TO PUBLIC;
+ALTER TABLE pg_ai_query_history ENABLE ROW LEVEL SECURITY;
+CREATE POLICY pg_ai_query_history_readable ON pg_ai_query_history
+    FOR SELECT
+    USING (NOT EXISTS (
+        SELECT 1 FROM pg_catalog.unnest(relids) AS r(relid)
+        WHERE pg_catalog.has_table_privilege(r.relid, 'SELECT') IS NOT TRUE
+    ));
+
+-- Record an accepted query
+CREATE OR REPLACE FUNCTION accept_query(
+    natural_language_query text,
+    query text
+)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'accept_query'
+LANGUAGE C
+VOLATILE
+STRICT
+SECURITY DEFINER;
+
+-- Accepted queries are returned to every user for matching requests, so
+-- only trusted roles may add them.
+REVOKE EXECUTE ON FUNCTION accept_query(text, text) FROM PUBLIC;
+
+-- Example usage:
+-- SELECT accept_query('active users by signup month',
+--                     'SELECT date_trunc(''month'', created_at) AS month, count(*) FROM users WHERE active GROUP BY 1 ORDER BY 1');
+-- GRANT EXECUTE ON FUNCTION accept_query(text, text) TO analysts;
+
+COMMENT ON FUNCTION accept_query(text, text) IS
+'Records an accepted SQL query for a natural language request in pg_ai_query_history.
+generate_query includes the most similar accepted queries for the current set of tables as examples in its prompt, and returns an accepted query directly when a request is nearly identical to its original request.
+The query must parse and refer to existing relations. It is only offered to roles with SELECT on every table and view it reads, including those under views.
+Parameters:
+- natural_language_query: The request the query answers
+- query: The accepted SQL
+Returns: id of the new pg_ai_query_history row
+Example: SELECT accept_query(''how many active users'', ''SELECT count(*) FROM users WHERE active'');';
+
+-- Start a new generate_query conversation
+CREATE OR REPLACE FUNCTION reset_conversation()
+RETURNS void
+AS 'MODULE_PATHNAME', 'reset_conversation'
+LANGUAGE C
+VOLATILE;
+
+-- Example usage:
+-- SELECT reset_conversation();
+
+COMMENT ON FUNCTION reset_conversation() IS
+'Forgets the earlier requests and tables of the current session''s generate_query conversation, so the next request is sent with the full schema.
+Example: SELECT reset_conversation();';
+
+-- Schema version of the current database
+CREATE OR REPLACE FUNCTION get_schema_version()
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'get_schema_version'
+LANGUAGE C
+VOLATILE;
+
+-- Example usage:
+-- SELECT get_schema_version();
+
+COMMENT ON FUNCTION get_schema_version() IS
+'Returns the schema version of the current database. It advances when a transaction changing tables, columns, indexes, schemas, policies or grants commits, and invalidates the schema data cached for prompts.
+Returns NULL unless pg_ai_query is loaded through shared_preload_libraries.
+Example: SELECT get_schema_version();';
+
+-- Event trigger function recording schema changes
+CREATE OR REPLACE FUNCTION pg_ai_query_schema_changed()
+RETURNS event_trigger
+AS 'MODULE_PATHNAME', 'pg_ai_query_schema_changed'
+LANGUAGE C;
+
+COMMENT ON FUNCTION pg_ai_query_schema_changed() IS
+'Event trigger function that records the relations changed by DDL so the schema version advances when the transaction commits.';
+
+CREATE EVENT TRIGGER pg_ai_query_ddl_command_end
+    ON ddl_command_end
+    EXECUTE FUNCTION pg_ai_query_schema_changed();
+
+CREATE EVENT TRIGGER pg_ai_query_sql_drop
+    ON sql_drop
+    EXECUTE FUNCTION pg_ai_query_schema_changed();
+
+-- Pre-rendered prompt context per table, kept current by the schema digest
+-- worker (pg_ai_query.digest_database)
+CREATE TABLE pg_ai_query_schema_digest (
+    relid oid PRIMARY KEY,
+    schema_name name NOT NULL,
+    table_name name NOT NULL,
+    schema_version bigint NOT NULL,
+    estimated_rows bigint NOT NULL,
+    details jsonb NOT NULL,
+    fragment text NOT NULL,
+    tokens integer NOT NULL,
+    refreshed_at timestamptz NOT NULL DEFAULT now()
+);
+
+-- generate_query reads the digest as the calling user, who only sees the
+-- tables they can select from
+ALTER TABLE pg_ai_query_schema_digest ENABLE ROW LEVEL SECURITY;
+CREATE POLICY pg_ai_query_schema_digest_visible ON pg_ai_query_schema_digest
+    FOR SELECT
+    USING (pg_catalog.has_any_column_privilege(relid, 'SELECT'));
+GRANT SELECT ON pg_ai_query_schema_digest TO PUBLIC;
+
+-- Rebuild the schema digest
+CREATE OR REPLACE FUNCTION refresh_schema_digest()
+RETURNS integer
+AS 'MODULE_PATHNAME', 'refresh_schema_digest'
+LANGUAGE C
+VOLATILE;
+
+-- The digest is shared by all users; only trusted roles may rewrite it.
+REVOKE EXECUTE ON FUNCTION refresh_schema_digest() FROM PUBLIC;
+
+-- Example usage:
+-- SELECT refresh_schema_digest();
+
+COMMENT ON FUNCTION refresh_schema_digest() IS
+'Rewrites pg_ai_query_schema_digest from the catalogs: one row per table with its details, pre-rendered prompt fragment, token estimate and row estimate.
+The background worker does this incrementally when pg_ai_query.digest_database names this database; call it directly to fill the digest without the worker.
+Returns: number of tables written
+Example: SELECT refresh_schema_digest();';
+
+-- Search table and column names in the cached schema
+CREATE OR REPLACE FUNCTION search_schema(
+    query text,
+    k integer DEFAULT 10
+)
+RETURNS TABLE (
+    schema_name text,
+    table_name text,
+    column_name text,
+    score real,
+    snippet text
+)
+AS 'MODULE_PATHNAME', 'search_schema'
+LANGUAGE C
+VOLATILE
+STRICT;
+
+-- Example usage:
+-- SELECT * FROM search_schema('cust');
+-- SELECT table_name, column_name FROM search_schema('customer email', 5);
+
+COMMENT ON FUNCTION search_schema(text, integer) IS
+'Ranks the tables and columns whose names match the query, for autocomplete and "which table holds X" lookups. Served from the session''s schema cache and the schema snapshot, without calling an AI provider; columns of tables neither has yet are read from the catalogs in one query.
+Parameters:
+- query: Name, name prefix or words to look for
+- k: Maximum number of rows (default: 10)
+Returns: schema_name, table_name, column_name (NULL for tables), score (0-1, best first) and a short snippet
+Example: SELECT * FROM search_schema(''cust'');';
+
+-- Business terms users say for tables and columns, e.g. 'customers' for
+-- acct. generate_query adds the tables of terms in a request to its prompt,
+-- and search_schema finds tables and columns by their terms.
+CREATE TABLE pg_ai_query_glossary (
+    id bigserial PRIMARY KEY,
+    term text NOT NULL,
+    schema_name name NOT NULL DEFAULT 'public',
+    table_name name NOT NULL,
+    column_name name
+);
+
+-- Keep glossary entries in pg_dump output
+SELECT pg_catalog.pg_extension_config_dump('pg_ai_query_glossary', '');
+SELECT pg_catalog.pg_extension_config_dump('pg_ai_query_glossary_id_seq', '');
+
+GRANT SELECT ON pg_ai_query_glossary TO PUBLIC;
+
+-- Sessions cache the glossary; this makes them read it again after a change
+CREATE OR REPLACE FUNCTION pg_ai_query_glossary_changed()
+RETURNS trigger
+AS 'MODULE_PATHNAME', 'pg_ai_query_glossary_changed'
+LANGUAGE C;
+
+CREATE TRIGGER pg_ai_query_glossary_changed
+    AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON pg_ai_query_glossary
+    FOR EACH STATEMENT
+    EXECUTE FUNCTION pg_ai_query_glossary_changed();
+
+-- Example usage:
+-- INSERT INTO pg_ai_query_glossary (term, table_name)
+--     VALUES ('customers', 'acct'), ('churn', 'subscription_events');
+-- INSERT INTO pg_ai_query_glossary (term, table_name, column_name)
+--     VALUES ('revenue', 'fin_ledger_entries', 'amount');
+
+COMMENT ON TABLE pg_ai_query_glossary IS
+'Business terms mapped to the tables (and optionally columns) they mean. Terms match whole words of a request, ignoring case and plural endings.';
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <pwd.h>
 #include <sstream>
@@ -14,6 +15,29 @@ namespace pg_ai::config {
 
 Configuration ConfigManager::config_;
 bool ConfigManager::config_loaded_ = false;
+uint64_t ConfigManager::generation_ = 0;
+std::vector<ProviderConfig> ConfigManager::effective_providers_;
+uint64_t ConfigManager::effective_generation_ = UINT64_MAX;
+
+namespace {
+
+void applyProfile(const SessionProfile& profile, ProviderConfig& config) {
+  if (profile.provider != Provider::UNKNOWN &&
+      profile.provider != config.provider) {
+    return;
+  }
+  if (!profile.model.empty()) {
+    config.default_model = profile.model;
+  }
+  if (profile.max_tokens > 0) {
+    config.default_max_tokens = profile.max_tokens;
+  }
+  if (profile.temperature >= 0) {
+    config.default_temperature = profile.temperature;
+  }
+}
+
+}  // namespace
 
 Configuration::Configuration() {
   // General settings defaults
@@ -21,11 +45,20 @@ Configuration::Configuration() {
   enable_logging = false;      // Default: disable logging
   request_timeout_ms = 30000;  // 30 seconds
   max_retries = 3;
+  adaptive_max_tokens = true;
 
   // Query generation defaults
   enforce_limit = true;
   default_limit = 1000;
   max_query_length = constants::DEFAULT_MAX_QUERY_LENGTH;
+  max_query_cost = 0.0;
+  plan_cache_size = constants::DEFAULT_PLAN_CACHE_SIZE;
+  template_fast_path = true;
+  template_min_confidence = constants::DEFAULT_TEMPLATE_MIN_CONFIDENCE;
+  history_examples = constants::DEFAULT_HISTORY_EXAMPLES;
+  history_min_similarity = constants::DEFAULT_HISTORY_MIN_SIMILARITY;
+  history_match_threshold = constants::DEFAULT_HISTORY_MATCH_THRESHOLD;
+  conversation_turns = constants::DEFAULT_CONVERSATION_TURNS;
 
   // Response format defaults
   show_explanation = true;
@@ -37,6 +70,9 @@ Configuration::Configuration() {
   system_prompt = "";
   explain_system_prompt = "";
 
+  // No schema digest worker unless a database is configured
+  digest_database = "";
+
   // Default OpenAI provider
   default_provider.provider = Provider::OPENAI;
   default_provider.api_key = "";
@@ -84,8 +120,11 @@ bool ConfigManager::loadConfig(const std::string& config_path) {
         "https://benodiwal.github.io/pg_ai_query/configuration.html");
   }
 
-  if (parseConfig(result.second)) {
+  Configuration parsed;
+  if (parseConfig(result.second, parsed)) {
+    config_ = std::move(parsed);
     config_loaded_ = true;
+    ++generation_;
     // Enable/disable logging based on config
     logger::Logger::setLoggingEnabled(config_.enable_logging);
     pg_ai::logger::Logger::set_level(config_.log_level);
@@ -99,6 +138,105 @@ bool ConfigManager::loadConfig(const std::string& config_path) {
   }
 }
 
+bool ConfigManager::loadConfigIfExists() {
+  std::string config_path = getDefaultConfigPath();
+  if (config_path.empty()) {
+    logger::Logger::warning("Could not determine home directory");
+    config_loaded_ = true;
+    return false;
+  }
+
+  return loadConfigIfExists(config_path);
+}
+
+bool ConfigManager::loadConfigIfExists(const std::string& config_path) {
+  std::error_code ec;
+  if (!std::filesystem::exists(config_path, ec)) {
+    logger::Logger::info("No configuration file at " + config_path +
+                         ", using defaults");
+    config_loaded_ = true;
+    return false;
+  }
+
+  bool loaded = loadConfig(config_path);
+  config_loaded_ = true;
+  return loaded;
+}
+
+Configuration& ConfigManager::getMutableConfig() {
+  config_loaded_ = true;
+  return config_;
+}
+
+void ConfigManager::markChanged() {
+  ++generation_;
+}
+
+uint64_t ConfigManager::generation() {
+  return generation_;
+}
+
+bool ConfigManager::readConfigFile(const std::string& config_path,
+                                   Configuration& config) {
+  std::error_code ec;
+  if (!std::filesystem::exists(config_path, ec)) {
+    return false;
+  }
+
+  auto result = utils::read_file(config_path);
+  return result.first && parseConfig(result.second, config);
+}
+
+std::string ConfigManager::getDefaultConfigPath() {
+  std::string home_dir = getHomeDirectory();
+  if (home_dir.empty()) {
+    return "";
+  }
+  return home_dir + "/" + constants::CONFIG_FILE_NAME;
+}
+
+ProviderConfig& ConfigManager::getOrCreateProviderConfig(Provider provider) {
+  size_t configured = config_.providers.size();
+  ProviderConfig& provider_config =
+      getOrCreateProviderConfig(config_, provider);
+  if (config_.providers.size() != configured) {
+    ++generation_;
+  }
+  return provider_config;
+}
+
+ProviderConfig& ConfigManager::getOrCreateProviderConfig(Configuration& config,
+                                                         Provider provider) {
+  for (auto& p : config.providers) {
+    if (p.provider == provider) {
+      return p;
+    }
+  }
+
+  ProviderConfig provider_config;
+  provider_config.provider = provider;
+  switch (provider) {
+    case Provider::OPENAI:
+      provider_config.default_model = constants::DEFAULT_OPENAI_MODEL;
+      break;
+    case Provider::ANTHROPIC:
+      provider_config.default_model = constants::DEFAULT_ANTHROPIC_MODEL;
+      provider_config.default_max_tokens =
+          constants::DEFAULT_ANTHROPIC_MAX_TOKENS;
+      break;
+    case Provider::GEMINI:
+      provider_config.default_model = constants::DEFAULT_GEMINI_MODEL;
+      provider_config.default_max_tokens = constants::DEFAULT_MAX_TOKENS;
+      provider_config.default_temperature = constants::DEFAULT_TEMPERATURE;
+      break;
+    default:
+      break;
+  }
+
+  config.providers.push_back(provider_config);
+  return config.providers.back();
+}
+
 void ConfigManager::loadEnvConfig() {
   // NOTE for developers: Environment variable loading is disabled for now - all
   // config via ~/.pg_ai.config
@@ -124,6 +262,26 @@ const ProviderConfig* ConfigManager::getProviderConfig(Provider provider) {
   return nullptr;
 }
 
+const ProviderConfig* ConfigManager::getEffectiveProviderConfig(
+    Provider provider) {
+  const Configuration& config = getConfig();
+
+  if (effective_generation_ != generation_) {
+    effective_providers_ = config.providers;
+    for (auto& p : effective_providers_) {
+      applyProfile(config.profile, p);
+    }
+    effective_generation_ = generation_;
+  }
+
+  for (const auto& p : effective_providers_) {
+    if (p.provider == provider) {
+      return &p;
+    }
+  }
+  return nullptr;
+}
+
 std::string ConfigManager::providerToString(Provider provider) {
   switch (provider) {
     case Provider::OPENAI:
@@ -153,14 +311,16 @@ Provider ConfigManager::stringToProvider(const std::string& provider_str) {
 void ConfigManager::reset() {
   config_ = Configuration();
   config_loaded_ = false;
+  ++generation_;
 }
 
-bool ConfigManager::parseConfig(const std::string& content) {
+bool ConfigManager::parseConfig(const std::string& content,
+                                Configuration& config) {
   std::istringstream stream(content);
   std::string line;
   std::string current_section;
 
-  config_ = Configuration();
+  config = Configuration();
 
   while (std::getline(stream, line)) {
     // Remove leading/trailing whitespace
@@ -205,32 +365,49 @@ bool ConfigManager::parseConfig(const std::string& content) {
 
     if (current_section == constants::SECTION_GENERAL) {
       if (key == "log_level")
-        config_.log_level = value;
+        config.log_level = value;
       else if (key == "enable_logging")
-        config_.enable_logging = (value == "true");
+        config.enable_logging = (value == "true");
       else if (key == "request_timeout_ms")
-        config_.request_timeout_ms = std::stoi(value);
+        config.request_timeout_ms = std::stoi(value);
       else if (key == "max_retries")
-        config_.max_retries = std::stoi(value);
+        config.max_retries = std::stoi(value);
+      else if (key == "adaptive_max_tokens")
+        config.adaptive_max_tokens = (value == "true");
     } else if (current_section == constants::SECTION_QUERY) {
       if (key == "enforce_limit")
-        config_.enforce_limit = (value == "true");
+        config.enforce_limit = (value == "true");
       else if (key == "default_limit")
-        config_.default_limit = std::stoi(value);
+        config.default_limit = std::stoi(value);
       else if (key == "max_query_length") {
         int val = std::stoi(value);
         if (val > 0)
-          config_.max_query_length = val;
-      }
+          config.max_query_length = val;
+      } else if (key == "max_query_cost")
+        config.max_query_cost = std::stod(value);
+      else if (key == "plan_cache_size")
+        config.plan_cache_size = std::stoi(value);
+      else if (key == "template_fast_path")
+        config.template_fast_path = (value == "true");
+      else if (key == "template_min_confidence")
+        config.template_min_confidence = std::stod(value);
+      else if (key == "history_examples")
+        config.history_examples = std::stoi(value);
+      else if (key == "history_min_similarity")
+        config.history_min_similarity = std::stod(value);
+      else if (key == "history_match_threshold")
+        config.history_match_threshold = std::stod(value);
+      else if (key == "conversation_turns")
+        config.conversation_turns = std::stoi(value);
     } else if (current_section == constants::SECTION_RESPONSE) {
       if (key == "show_explanation")
-        config_.show_explanation = (value == "true");
+        config.show_explanation = (value == "true");
       else if (key == "show_warnings")
-        config_.show_warnings = (value == "true");
+        config.show_warnings = (value == "true");
       else if (key == "show_suggested_visualization")
-        config_.show_suggested_visualization = (value == "true");
+        config.show_suggested_visualization = (value == "true");
       else if (key == "use_formatted_response") {
-        config_.use_formatted_response = (value == "true");
+        config.use_formatted_response = (value == "true");
       }
     } else if (current_section == constants::SECTION_PROMPTS) {
       // Handle multi-line prompts - read the full value
@@ -241,9 +418,9 @@ bool ConfigManager::parseConfig(const std::string& content) {
           // Quoted string - use as-is
           std::string prompt_value = value.substr(1, value.length() - 2);
           if (key == "system_prompt")
-            config_.system_prompt = prompt_value;
+            config.system_prompt = prompt_value;
           else
-            config_.explain_system_prompt = prompt_value;
+            config.explain_system_prompt = prompt_value;
         } else if (!value.empty() && value[0] != '#') {
           // Unquoted value - check if it's a file path
           std::string file_path = value;
@@ -254,32 +431,28 @@ bool ConfigManager::parseConfig(const std::string& content) {
           auto file_result = utils::read_file(file_path);
           if (file_result.first) {
             if (key == "system_prompt")
-              config_.system_prompt = file_result.second;
+              config.system_prompt = file_result.second;
             else
-              config_.explain_system_prompt = file_result.second;
+              config.explain_system_prompt = file_result.second;
           } else {
             // Not a file, use as raw text
             if (key == "system_prompt")
-              config_.system_prompt = value;
+              config.system_prompt = value;
             else
-              config_.explain_system_prompt = value;
+              config.explain_system_prompt = value;
           }
         }
       }
     } else if (current_section == constants::SECTION_OPENAI) {
-      auto provider_config = getProviderConfigMutable(Provider::OPENAI);
-      if (!provider_config) {
-        ProviderConfig config;
-        config.provider = Provider::OPENAI;
-        config.default_model = constants::DEFAULT_OPENAI_MODEL;
-        config_.providers.push_back(config);
-        provider_config = &config_.providers.back();
-      }
+      auto provider_config =
+          &getOrCreateProviderConfig(config, Provider::OPENAI);
 
       if (key == "api_key")
         provider_config->api_key = value;
       else if (key == "default_model")
         provider_config->default_model = value;
+      else if (key == "fast_model")
+        provider_config->fast_model = value;
       else if (key == "max_tokens")
         provider_config->default_max_tokens = std::stoi(value);
       else if (key == "temperature")
@@ -288,21 +461,15 @@ bool ConfigManager::parseConfig(const std::string& content) {
         provider_config->api_endpoint = value;
 
     } else if (current_section == constants::SECTION_ANTHROPIC) {
-      auto provider_config = getProviderConfigMutable(Provider::ANTHROPIC);
-      if (!provider_config) {
-        ProviderConfig config;
-        config.provider = Provider::ANTHROPIC;
-        config.default_model = constants::DEFAULT_ANTHROPIC_MODEL;
-        config.default_max_tokens = constants::DEFAULT_ANTHROPIC_MAX_TOKENS;
-
-        config_.providers.push_back(config);
-        provider_config = &config_.providers.back();
-      }
+      auto provider_config =
+          &getOrCreateProviderConfig(config, Provider::ANTHROPIC);
 
       if (key == "api_key")
         provider_config->api_key = value;
       else if (key == "default_model")
         provider_config->default_model = value;
+      else if (key == "fast_model")
+        provider_config->fast_model = value;
       else if (key == "max_tokens")
         provider_config->default_max_tokens = std::stoi(value);
       else if (key == "temperature")
@@ -311,22 +478,15 @@ bool ConfigManager::parseConfig(const std::string& content) {
         provider_config->api_endpoint = value;
 
     } else if (current_section == constants::SECTION_GEMINI) {
-      auto provider_config = getProviderConfigMutable(Provider::GEMINI);
-      if (!provider_config) {
-        ProviderConfig config;
-        config.provider = Provider::GEMINI;
-        config.default_model = "gemini-2.5-flash";
-        config.default_max_tokens = constants::DEFAULT_MAX_TOKENS;
-        config.default_temperature = constants::DEFAULT_TEMPERATURE;
-
-        config_.providers.push_back(config);
-        provider_config = &config_.providers.back();
-      }
+      auto provider_config =
+          &getOrCreateProviderConfig(config, Provider::GEMINI);
 
       if (key == "api_key")
         provider_config->api_key = value;
       else if (key == "default_model")
         provider_config->default_model = value;
+      else if (key == "fast_model")
+        provider_config->fast_model = value;
       else if (key == "max_tokens")
         provider_config->default_max_tokens = std::stoi(value);
       else if (key == "temperature")
@@ -334,22 +494,13 @@ bool ConfigManager::parseConfig(const std::string& content) {
     }
   }
 
-  if (!config_.providers.empty()) {
-    config_.default_provider = config_.providers[0];
+  if (!config.providers.empty()) {
+    config.default_provider = config.providers[0];
   }
 
   return true;
 }
 
-ProviderConfig* ConfigManager::getProviderConfigMutable(Provider provider) {
-  for (auto& p : config_.providers) {
-    if (p.provider == provider) {
-      return &p;
-    }
-  }
-  return nullptr;
-}
-
 std::string ConfigManager::getHomeDirectory() {
   const char* home = std::getenv("HOME");
   if (home && home[0] != '\0') {
@@ -0,0 +1,121 @@
+#include "../include/conversation.hpp"
+
+#include "../include/keyword_scanner.hpp"
+
+namespace pg_ai {
+
+namespace {
+
+const KeywordScanner& followUpMarkers() {
+  static const KeywordScanner scanner(
+      {"that", "those", "these", "them", "same", "instead", "previous",
+       "earlier", "above", "now ", "also", "again", "as well"});
+  return scanner;
+}
+
+std::string qualifiedName(std::string_view schema_name,
+                          std::string_view table_name) {
+  std::string name(schema_name);
+  name += '.';
+  name += table_name;
+  return name;
+}
+
+}  // namespace
+
+bool Conversation::isFollowUp(std::string_view request,
+                              size_t mentioned_tables) const {
+  if (turns_.empty()) {
+    return false;
+  }
+  return mentioned_tables == 0 || followUpMarkers().containsAny(request);
+}
+
+void Conversation::recordTurn(std::string request,
+                              std::string sql,
+                              size_t max_turns) {
+  turns_.push_back(
+      ConversationTurn{.request = std::move(request), .sql = std::move(sql)});
+  while (turns_.size() > max_turns) {
+    turns_.pop_front();
+  }
+}
+
+void Conversation::addTable(const TableDetails& details) {
+  tables_.insert_or_assign(
+      qualifiedName(details.schema_name, details.table_name),
+      summarizeTable(details));
+}
+
+bool Conversation::hasTable(std::string_view schema_name,
+                            std::string_view table_name) const {
+  return tables_.find(qualifiedName(schema_name, table_name)) !=
+         tables_.end();
+}
+
+std::string Conversation::formatContext() const {
+  if (turns_.empty()) {
+    return "";
+  }
+
+  std::string context = "Earlier requests in this conversation:\n";
+  for (const auto& turn : turns_) {
+    context += "\nRequest: ";
+    context += turn.request;
+    context += "\nSQL: ";
+    context += turn.sql;
+    context += '\n';
+  }
+
+  if (!tables_.empty()) {
+    context += "\nTables used so far:\n";
+    for (const auto& [name, summary] : tables_) {
+      context += summary;
+      context += '\n';
+    }
+  }
+  return context;
+}
+
+void Conversation::reset() {
+  turns_.clear();
+  tables_.clear();
+}
+
+std::string Conversation::summarizeTable(const TableDetails& details) {
+  std::string summary = qualifiedName(details.schema_name, details.table_name);
+  summary += '(';
+  bool first = true;
+  for (const auto& column : details.columns) {
+    if (!first) {
+      summary += ", ";
+    }
+    first = false;
+    summary += column.column_name;
+    summary += ' ';
+    summary += column.data_type;
+    if (column.is_primary_key) {
+      summary += " PK";
+    }
+    if (column.is_foreign_key && !column.foreign_table.empty()) {
+      summary += " -> ";
+      summary += column.foreign_table;
+      summary += '.';
+      summary += column.foreign_column;
+    }
+  }
+  summary += ')';
+  return summary;
+}
+
+Conversation& Conversation::forRole(uint32_t role, uint64_t memberships) {
+  static Conversation conversation;
+  if (conversation.role_ != role || conversation.memberships_ != memberships) {
+    conversation.reset();
+    conversation.role_ = role;
+    conversation.memberships_ = memberships;
+  }
+  return conversation;
+}
+
+}  // namespace pg_ai
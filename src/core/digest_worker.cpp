@@ -0,0 +1,482 @@
+#include "../include/digest_worker.hpp"
+
+extern "C" {
+#include <postgres.h>
+
+#include <access/xact.h>
+#include <catalog/pg_type.h>
+#include <commands/extension.h>
+#include <executor/spi.h>
+#include <miscadmin.h>
+#include <pgstat.h>
+#include <postmaster/bgworker.h>
+#include <postmaster/interrupt.h>
+#include <storage/ipc.h>
+#include <storage/latch.h>
+#include <tcop/tcopprot.h>
+#include <utils/acl.h>
+#include <utils/builtins.h>
+#include <utils/guc.h>
+#include <utils/lsyscache.h>
+#include <utils/rls.h>
+#include <utils/snapmgr.h>
+}
+
+#include <algorithm>
+#include <charconv>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "../include/config.hpp"
+#include "../include/logger.hpp"
+#include "../include/output_budget.hpp"
+#include "../include/schema_digest.hpp"
+#include "../include/schema_snapshot.hpp"
+#include "../include/schema_version.hpp"
+#include "../include/spi_connection.hpp"
+
+extern "C" {
+PGDLLEXPORT void pg_ai_query_digest_main(Datum main_arg);
+}
+
+namespace pg_ai::digest_worker {
+
+namespace {
+
+/** How often the worker checks the schema version */
+constexpr long kNaptimeMs = 1000;
+
+// Schema-qualified name of the digest table, or an empty string when the
+// extension is not installed in this database
+std::string digestTable() {
+  Oid extension = get_extension_oid("pg_ai_query", true);
+  if (!OidIsValid(extension)) {
+    return "";
+  }
+  char* schema = get_namespace_name(get_extension_schema(extension));
+  if (schema == nullptr) {
+    return "";
+  }
+  return std::string(quote_identifier(schema)) + ".pg_ai_query_schema_digest";
+}
+
+// Snapshot file of the current database, relative to the data directory
+std::string snapshotPath() {
+  return "pg_ai_query_schema." + std::to_string(MyDatabaseId) + ".snap";
+}
+
+// Whether the current role can select from the table, as getDatabaseTables()
+// requires; data taken from the snapshot was read by the worker as superuser
+bool readableByRole(uint32_t relid) {
+  bool missing = false;
+  if (pg_class_aclcheck_ext(relid, GetUserId(), ACL_SELECT, &missing) ==
+      ACLCHECK_OK) {
+    return true;
+  }
+  return !missing && pg_attribute_aclcheck_all(relid, GetUserId(), ACL_SELECT,
+                                               ACLMASK_ANY) == ACLCHECK_OK;
+}
+
+// Drop the columns the current role can't select, as getTableDetails() does
+void dropUnreadableColumns(uint32_t relid, TableDetails& details) {
+  if (pg_class_aclcheck(relid, GetUserId(), ACL_SELECT) == ACLCHECK_OK) {
+    return;
+  }
+  std::erase_if(details.columns, [&](const ColumnInfo& column) {
+    AttrNumber attnum =
+        get_attnum(relid, std::string(column.column_name).c_str());
+    return attnum == InvalidAttrNumber ||
+           pg_attribute_aclcheck(relid, attnum, GetUserId(), ACL_SELECT) !=
+               ACLCHECK_OK;
+  });
+}
+
+// '{1,2,3}'::oid[]; OIDs are plain integers, safe to inline
+std::string oidArray(const std::vector<uint32_t>& relids) {
+  std::string array = "'{";
+  char buf[16];
+  for (size_t i = 0; i < relids.size(); ++i) {
+    if (i > 0) {
+      array += ',';
+    }
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), relids[i]);
+    array.append(buf, end);
+  }
+  array += "}'::oid[]";
+  return array;
+}
+
+// Changed tables plus the digested tables with foreign keys to them, whose
+// fragments name the changed tables
+std::vector<uint32_t> withReferencingTables(const std::string& table,
+                                            std::vector<uint32_t> relids) {
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    throw std::runtime_error(spi_conn.getErrorMessage());
+  }
+
+  std::string query =
+      "SELECT DISTINCT d.relid::int8 FROM " + table + " d, " + table +
+      " c, jsonb_array_elements(d.details->'columns') col"
+      " WHERE c.relid = ANY(" +
+      oidArray(relids) +
+      ") AND col->>'foreign_table' = c.table_name::text";
+  int ret = SPI_execute(query.c_str(), true, 0);
+  if (ret != SPI_OK_SELECT) {
+    throw std::runtime_error(SPI_result_code_string(ret));
+  }
+  for (uint64 i = 0; i < SPI_processed; ++i) {
+    relids.push_back(static_cast<uint32_t>(
+        SPIRow(SPI_tuptable->vals[i], SPI_tuptable->tupdesc).getInt64(1)));
+  }
+  std::sort(relids.begin(), relids.end());
+  relids.erase(std::unique(relids.begin(), relids.end()), relids.end());
+  return relids;
+}
+
+void writeRow(const std::string& table,
+              const TableInfo& info,
+              const TableDetails& details,
+              uint64_t version) {
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    throw std::runtime_error(spi_conn.getErrorMessage());
+  }
+
+  std::string details_json = SchemaDigest::toJson(details).dump();
+  auto fragment = QueryGenerator::formatTableDetailsForAI(details);
+  std::string upsert =
+      "INSERT INTO " + table +
+      " (relid, schema_name, table_name, schema_version, estimated_rows,"
+      " details, fragment, tokens)"
+      " VALUES ($1, $2, $3, $4, $5, $6::jsonb, $7, $8)"
+      " ON CONFLICT (relid) DO UPDATE SET"
+      " schema_name = excluded.schema_name,"
+      " table_name = excluded.table_name,"
+      " schema_version = excluded.schema_version,"
+      " estimated_rows = excluded.estimated_rows,"
+      " details = excluded.details, fragment = excluded.fragment,"
+      " tokens = excluded.tokens, refreshed_at = now()";
+  auto toText = [](std::string_view value) {
+    return PointerGetDatum(cstring_to_text_with_len(
+        value.data(), static_cast<int>(value.size())));
+  };
+  Oid arg_types[] = {OIDOID,  TEXTOID, TEXTOID, INT8OID,
+                     INT8OID, TEXTOID, TEXTOID, INT4OID};
+  Datum args[] = {ObjectIdGetDatum(info.relid),
+                  toText(info.schema_name),
+                  toText(info.table_name),
+                  Int64GetDatum(static_cast<int64>(version)),
+                  Int64GetDatum(info.estimated_rows),
+                  toText(details_json),
+                  toText(fragment),
+                  Int32GetDatum(OutputBudget::estimateTokens(fragment))};
+  int ret = SPI_execute_with_args(upsert.c_str(), 8, arg_types, args, nullptr,
+                                  false, 0);
+  if (ret != SPI_OK_INSERT) {
+    throw std::runtime_error(SPI_result_code_string(ret));
+  }
+}
+
+void deleteVanished(const std::string& table,
+                    const std::optional<std::vector<uint32_t>>& changed,
+                    const DatabaseSchema& schema) {
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    throw std::runtime_error(spi_conn.getErrorMessage());
+  }
+
+  std::vector<uint32_t> present;
+  present.reserve(schema.tables.size());
+  for (const auto& info : schema.tables) {
+    present.push_back(info.relid);
+  }
+  std::string query = "DELETE FROM " + table + " WHERE relid <> ALL(" +
+                      oidArray(present) + ")";
+  if (changed) {
+    query += " AND relid = ANY(" + oidArray(*changed) + ")";
+  }
+  int ret = SPI_execute(query.c_str(), false, 0);
+  if (ret != SPI_OK_DELETE) {
+    throw std::runtime_error(SPI_result_code_string(ret));
+  }
+}
+
+// Writes every table and the stored details of all but the skipped tables,
+// all current as of version
+void writeSnapshot(const std::string& table,
+                   uint64_t version,
+                   const DatabaseSchema& schema,
+                   const std::vector<uint32_t>& skipped) {
+  std::map<uint32_t, TableDetails> details;
+  {
+    SPIConnection spi_conn;
+    if (!spi_conn) {
+      throw std::runtime_error(spi_conn.getErrorMessage());
+    }
+    // Not read-only, so the rows just written are visible
+    std::string query = "SELECT relid::int8, details::text FROM " + table;
+    int ret = SPI_execute(query.c_str(), false, 0);
+    if (ret != SPI_OK_SELECT) {
+      throw std::runtime_error(SPI_result_code_string(ret));
+    }
+    for (uint64 i = 0; i < SPI_processed; ++i) {
+      SPIRow row(SPI_tuptable->vals[i], SPI_tuptable->tupdesc);
+      auto relid = static_cast<uint32_t>(row.getInt64(1));
+      if (std::find(skipped.begin(), skipped.end(), relid) != skipped.end()) {
+        continue;
+      }
+      if (auto stored = SchemaDigest::fromJson(row.getText(2))) {
+        details.emplace(relid, std::move(*stored));
+      }
+    }
+  }
+
+  if (!SchemaSnapshot::write(
+          snapshotPath(),
+          SchemaSnapshot::serialize(version, schema, details))) {
+    logger::Logger::warning("Could not write schema snapshot " +
+                            snapshotPath());
+  }
+}
+
+}  // namespace
+
+void registerWorker() {
+  if (!process_shared_preload_libraries_in_progress ||
+      config::ConfigManager::getConfig().digest_database.empty()) {
+    return;
+  }
+
+  BackgroundWorker worker;
+  memset(&worker, 0, sizeof(worker));
+  worker.bgw_flags =
+      BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+  worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+  worker.bgw_restart_time = 10;
+  snprintf(worker.bgw_library_name, BGW_MAXLEN, "pg_ai_query");
+  snprintf(worker.bgw_function_name, BGW_MAXLEN, "pg_ai_query_digest_main");
+  snprintf(worker.bgw_name, BGW_MAXLEN, "pg_ai_query schema digest");
+  snprintf(worker.bgw_type, BGW_MAXLEN, "pg_ai_query schema digest");
+  RegisterBackgroundWorker(&worker);
+}
+
+int refresh(const std::optional<std::vector<uint32_t>>& changed) {
+  std::string table = digestTable();
+  if (table.empty()) {
+    return -1;
+  }
+
+  // Read before the catalogs, so each row is at least this new
+  uint64_t version = schema_version::current().value_or(0);
+
+  if (changed && changed->empty()) {
+    return 0;
+  }
+
+  std::optional<std::vector<uint32_t>> relids;
+  if (changed) {
+    relids = withReferencingTables(table, *changed);
+  }
+  auto schema = relids ? QueryGenerator::getDatabaseTables(*relids)
+                       : QueryGenerator::getDatabaseTables();
+  if (!schema.success) {
+    throw std::runtime_error(schema.error_message);
+  }
+
+  deleteVanished(table, relids, schema);
+
+  int written = 0;
+  std::vector<uint32_t> skipped;
+  for (const auto& info : schema.tables) {
+    auto details = QueryGenerator::getTableDetails(
+        std::string(info.table_name), std::string(info.schema_name));
+    if (!details.success) {
+      logger::Logger::warning("Schema digest skipped " +
+                              std::string(info.schema_name) + "." +
+                              std::string(info.table_name) + ": " +
+                              details.error_message);
+      skipped.push_back(info.relid);
+      continue;
+    }
+    writeRow(table, info, details, version);
+    ++written;
+  }
+
+  // Versions are needed to tell which parts of the snapshot are current
+  if (schema_version::available()) {
+    if (!relids) {
+      writeSnapshot(table, version, schema, skipped);
+    } else if (auto all = QueryGenerator::getDatabaseTables(); all.success) {
+      writeSnapshot(table, version, all, skipped);
+    }
+  }
+  return written;
+}
+
+std::optional<TableDetails> lookup(uint32_t relid,
+                                   std::pmr::memory_resource* memory) {
+  if (!schema_version::available()) {
+    return std::nullopt;
+  }
+
+  if (auto details = snapshotDetails(relid, memory)) {
+    return details;
+  }
+
+  std::string table = digestTable();
+  if (table.empty()) {
+    return std::nullopt;
+  }
+
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    return std::nullopt;
+  }
+
+  std::string query = "SELECT schema_version, details::text FROM " + table +
+                      " WHERE relid = $1";
+  Oid arg_types[] = {OIDOID};
+  Datum args[] = {ObjectIdGetDatum(relid)};
+  int ret = SPI_execute_with_args(query.c_str(), 1, arg_types, args, nullptr,
+                                  false, 1);
+  if (ret != SPI_OK_SELECT || SPI_processed == 0) {
+    return std::nullopt;
+  }
+
+  SPIRow row(SPI_tuptable->vals[0], SPI_tuptable->tupdesc);
+  auto changed =
+      schema_version::changedSince(static_cast<uint64_t>(row.getInt64(1)));
+  if (!changed ||
+      std::binary_search(changed->begin(), changed->end(), relid)) {
+    return std::nullopt;
+  }
+  auto details = SchemaDigest::fromJson(row.getText(2), memory);
+  if (details) {
+    dropUnreadableColumns(relid, *details);
+  }
+  return details;
+}
+
+std::optional<TableDetails> snapshotDetails(
+    uint32_t relid,
+    std::pmr::memory_resource* memory) {
+  const auto* mapped = snapshot();
+  if (mapped == nullptr) {
+    return std::nullopt;
+  }
+  auto changed = schema_version::changedSince(mapped->version());
+  if (!changed ||
+      std::binary_search(changed->begin(), changed->end(), relid) ||
+      !readableByRole(relid)) {
+    return std::nullopt;
+  }
+  auto details = mapped->details(relid, memory);
+  if (details) {
+    dropUnreadableColumns(relid, *details);
+  }
+  return details;
+}
+
+const SchemaSnapshot* snapshot() {
+  static std::optional<SchemaSnapshot> mapped;
+  if (!schema_version::available()) {
+    return nullptr;
+  }
+  std::string path = snapshotPath();
+  if (!mapped || mapped->replaced(path)) {
+    mapped = SchemaSnapshot::open(path);
+  }
+  return mapped ? &*mapped : nullptr;
+}
+
+bool seedSchemaCache(SchemaCache& cache) {
+  const auto* mapped = snapshot();
+  if (mapped == nullptr) {
+    return false;
+  }
+  auto changed = schema_version::changedSince(mapped->version());
+  if (!changed) {
+    return false;
+  }
+
+  auto schema = mapped->tables();
+  std::erase_if(schema.tables, [&](const TableInfo& table) {
+    return !std::binary_search(changed->begin(), changed->end(),
+                               table.relid) &&
+           !readableByRole(table.relid);
+  });
+  // Row-level security depends on the role too
+  for (auto& table : schema.tables) {
+    table.row_security =
+        check_enable_rls(table.relid, InvalidOid, true) == RLS_ENABLED;
+  }
+  cache.storeTables(schema, *changed);
+  return cache.tables() != nullptr || !cache.staleTables().empty();
+}
+
+}  // namespace pg_ai::digest_worker
+
+/**
+ * pg_ai_query_digest_main()
+ *
+ * Background worker keeping pg_ai_query_schema_digest current in
+ * pg_ai_query.digest_database: a full refresh at start, then a refresh of
+ * the changed tables whenever the schema version advances.
+ */
+void pg_ai_query_digest_main(Datum /*main_arg*/) {
+  pqsignal(SIGHUP, SignalHandlerForConfigReload);
+  pqsignal(SIGTERM, die);
+  BackgroundWorkerUnblockSignals();
+
+  const auto& cfg = pg_ai::config::ConfigManager::getConfig();
+  BackgroundWorkerInitializeConnection(cfg.digest_database.c_str(), nullptr,
+                                       0);
+
+  // Version the digest was last refreshed at. A snapshot kept across a
+  // clean restart is still current except for the changes since.
+  std::optional<uint64_t> refreshed;
+  if (const auto* mapped = pg_ai::digest_worker::snapshot();
+      mapped != nullptr &&
+      pg_ai::schema_version::changedSince(mapped->version())) {
+    refreshed = mapped->version();
+  }
+  for (;;) {
+    CHECK_FOR_INTERRUPTS();
+    if (ConfigReloadPending) {
+      ConfigReloadPending = false;
+      ProcessConfigFile(PGC_SIGHUP);
+    }
+
+    auto version = pg_ai::schema_version::current();
+    if (version && version != refreshed) {
+      auto changed = refreshed
+                         ? pg_ai::schema_version::changedSince(*refreshed)
+                         : std::nullopt;
+
+      SetCurrentStatementStartTimestamp();
+      StartTransactionCommand();
+      PushActiveSnapshot(GetTransactionSnapshot());
+      pgstat_report_activity(STATE_RUNNING, "refreshing schema digest");
+      try {
+        int written = pg_ai::digest_worker::refresh(changed);
+        if (written >= 0) {
+          pg_ai::logger::Logger::debug("Schema digest refreshed " +
+                                       std::to_string(written) + " tables");
+        }
+      } catch (const std::exception& e) {
+        ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                        errmsg("Schema digest refresh failed: %s", e.what())));
+      }
+      PopActiveSnapshot();
+      CommitTransactionCommand();
+      pgstat_report_activity(STATE_IDLE, nullptr);
+      refreshed = version;
+    }
+
+    (void)WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+                    pg_ai::digest_worker::kNaptimeMs, PG_WAIT_EXTENSION);
+    ResetLatch(MyLatch);
+  }
+}
@@ -0,0 +1,111 @@
+#include "../include/glossary.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <utility>
+
+namespace pg_ai {
+
+namespace {
+
+bool isWordByte(unsigned char c) {
+  return std::isalnum(c) || c == '_' || c >= 0x80;
+}
+
+// Lower-cased words of a text, split on anything but letters, digits and
+// underscores
+std::vector<std::string> wordsOf(std::string_view text) {
+  std::vector<std::string> words;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    while (pos < text.size() &&
+           !isWordByte(static_cast<unsigned char>(text[pos]))) {
+      ++pos;
+    }
+    size_t end = pos;
+    while (end < text.size() &&
+           isWordByte(static_cast<unsigned char>(text[end]))) {
+      ++end;
+    }
+    if (end == pos) {
+      break;
+    }
+    std::string word(text.substr(pos, end - pos));
+    for (auto& c : word) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    words.push_back(std::move(word));
+    pos = end;
+  }
+  return words;
+}
+
+// Plural endings a text word may add to a term word: "customers" and
+// "addresses" match "customer" and "address"
+constexpr std::string_view kEndings[] = {"", "s", "es"};
+
+bool wordMatches(std::string_view text_word, std::string_view term_word) {
+  return text_word.starts_with(term_word) &&
+         std::find(std::begin(kEndings), std::end(kEndings),
+                   text_word.substr(term_word.size())) != std::end(kEndings);
+}
+
+}  // namespace
+
+Glossary::Glossary(std::vector<GlossaryEntry> entries)
+    : entries_(std::move(entries)) {
+  words_.reserve(entries_.size());
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    words_.push_back(wordsOf(entries_[i].term));
+    if (!words_.back().empty()) {
+      by_first_word_[words_.back().front()].push_back(i);
+    }
+  }
+}
+
+std::vector<const GlossaryEntry*> Glossary::find(std::string_view text) const {
+  std::vector<const GlossaryEntry*> found;
+  if (entries_.empty()) {
+    return found;
+  }
+
+  auto words = wordsOf(text);
+  std::vector<bool> seen(entries_.size(), false);
+  auto matchAt = [&](size_t pos, size_t entry) {
+    const auto& term = words_[entry];
+    if (pos + term.size() > words.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < term.size(); ++i) {
+      if (!wordMatches(words[pos + i], term[i])) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  for (size_t pos = 0; pos < words.size(); ++pos) {
+    // The first word may carry a plural ending too
+    std::string_view word = words[pos];
+    for (std::string_view ending : kEndings) {
+      if (!word.ends_with(ending)) {
+        continue;
+      }
+      std::string_view key = word.substr(0, word.size() - ending.size());
+      auto it = by_first_word_.find(std::string(key));
+      if (it == by_first_word_.end()) {
+        continue;
+      }
+      for (size_t entry : it->second) {
+        if (!seen[entry] && matchAt(pos, entry)) {
+          seen[entry] = true;
+          found.push_back(&entries_[entry]);
+        }
+      }
+    }
+  }
+  return found;
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,786 @@
+#include "../include/guc.hpp"
+
+extern "C" {
+#include <postgres.h>
+
+#include <utils/guc.h>
+#include <utils/timestamp.h>
+}
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <string>
+#include <utility>
+
+#include "../include/config.hpp"
+#include "../include/logger.hpp"
+
+namespace pg_ai::guc {
+
+namespace {
+
+using config::ConfigManager;
+using config::Configuration;
+using config::Provider;
+using config::ProviderConfig;
+
+constexpr int kMaxTokensLimit = 1000000;
+constexpr double kMaxTemperature = 2.0;
+constexpr double kMaxQueryCost = 1e15;
+
+// Values at library load (config file or built-in defaults). String GUCs keep
+// pointers to their boot values, so this copy is never modified afterwards.
+Configuration boot_config;
+
+// ----------------------------------------------------------------------------
+// Config file tracking
+//
+// PgReloadTime is updated by every process when it handles SIGHUP, so a
+// changed value at request start means pg_reload_conf() ran since the file
+// was last considered. The file is then re-read only if its size or mtime
+// changed. Both are inherited from the postmaster by fork(), but the
+// postmaster itself never runs reloadIfNeeded(): there is no extension hook
+// in its SIGHUP path. Backends forked after a reload therefore start from the
+// stamp taken at server start, and each parses a changed file once.
+// ----------------------------------------------------------------------------
+
+struct FileStamp {
+  bool exists = false;
+  std::uintmax_t size = 0;
+  std::filesystem::file_time_type mtime;
+
+  bool operator==(const FileStamp&) const = default;
+};
+
+std::string config_path;
+FileStamp config_stamp;
+TimestampTz config_reload_time = 0;
+
+FileStamp stampFile(const std::string& path) {
+  FileStamp stamp;
+  std::error_code ec;
+  if (path.empty() || !std::filesystem::exists(path, ec)) {
+    return stamp;
+  }
+  stamp.exists = true;
+  stamp.size = std::filesystem::file_size(path, ec);
+  stamp.mtime = std::filesystem::last_write_time(path, ec);
+  return stamp;
+}
+
+// ----------------------------------------------------------------------------
+// GUC storage
+//
+// PostgreSQL owns these values; the assign hooks mirror every change into
+// ConfigManager's Configuration, which the rest of the extension reads.
+// ----------------------------------------------------------------------------
+
+struct ProviderVariables {
+  char* api_key = nullptr;
+  char* default_model = nullptr;
+  char* fast_model = nullptr;
+  int max_tokens = 0;
+  double temperature = 0;
+  char* api_endpoint = nullptr;
+};
+
+ProviderVariables openai_vars;
+ProviderVariables anthropic_vars;
+ProviderVariables gemini_vars;
+
+int log_level = 0;
+bool enable_logging = false;
+int request_timeout_ms = 0;
+int max_retries = 0;
+bool adaptive_max_tokens = false;
+bool enforce_limit = false;
+int default_limit = 0;
+int max_query_length = 0;
+double max_query_cost = 0;
+int plan_cache_size = 0;
+bool template_fast_path = false;
+double template_min_confidence = 0;
+int history_examples = 0;
+double history_min_similarity = 0;
+double history_match_threshold = 0;
+int conversation_turns = 0;
+bool show_explanation = false;
+bool show_warnings = false;
+bool show_suggested_visualization = false;
+bool use_formatted_response = false;
+char* system_prompt = nullptr;
+char* explain_system_prompt = nullptr;
+
+int profile_provider = 0;
+char* profile_model = nullptr;
+int profile_max_tokens = 0;
+double profile_temperature = 0;
+
+char* digest_database = nullptr;
+
+const struct config_enum_entry kProviderOptions[] = {
+    {"auto", static_cast<int>(Provider::UNKNOWN), false},
+    {"openai", static_cast<int>(Provider::OPENAI), false},
+    {"anthropic", static_cast<int>(Provider::ANTHROPIC), false},
+    {"gemini", static_cast<int>(Provider::GEMINI), false},
+    {nullptr, 0, false}};
+
+const struct config_enum_entry kLogLevelOptions[] = {
+    {"debug", static_cast<int>(logger::LogLevel::LOG_DEBUG), false},
+    {"info", static_cast<int>(logger::LogLevel::LOG_INFO), false},
+    {"warning", static_cast<int>(logger::LogLevel::LOG_WARNING), false},
+    {"error", static_cast<int>(logger::LogLevel::LOG_ERROR), false},
+    {nullptr, 0, false}};
+
+// ----------------------------------------------------------------------------
+// Assign hooks
+// ----------------------------------------------------------------------------
+
+// Only a changed value advances the configuration generation: SET of the
+// current value, and every reload, would otherwise rebuild derived state
+template <typename T>
+void assignValue(T& field, T value) {
+  if (field != value) {
+    field = std::move(value);
+    ConfigManager::markChanged();
+  }
+}
+
+template <bool Configuration::*Field>
+void assignBool(bool newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().*Field, newval);
+}
+
+template <int Configuration::*Field>
+void assignInt(int newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().*Field, newval);
+}
+
+template <double Configuration::*Field>
+void assignReal(double newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().*Field, newval);
+}
+
+template <std::string Configuration::*Field>
+void assignString(const char* newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().*Field,
+              std::string(newval ? newval : ""));
+}
+
+template <Provider P, std::string ProviderConfig::*Field>
+void assignProviderString(const char* newval, void*) {
+  assignValue(ConfigManager::getOrCreateProviderConfig(P).*Field,
+              std::string(newval ? newval : ""));
+}
+
+template <Provider P>
+void assignProviderMaxTokens(int newval, void*) {
+  assignValue(ConfigManager::getOrCreateProviderConfig(P).default_max_tokens,
+              newval);
+}
+
+template <Provider P>
+void assignProviderTemperature(double newval, void*) {
+  assignValue(ConfigManager::getOrCreateProviderConfig(P).default_temperature,
+              newval);
+}
+
+void assignProfileProvider(int newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().profile.provider,
+              static_cast<Provider>(newval));
+}
+
+void assignProfileModel(const char* newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().profile.model,
+              std::string(newval ? newval : ""));
+}
+
+void assignProfileMaxTokens(int newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().profile.max_tokens, newval);
+}
+
+void assignProfileTemperature(double newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().profile.temperature, newval);
+}
+
+void assignEnableLogging(bool newval, void*) {
+  assignValue(ConfigManager::getMutableConfig().enable_logging, newval);
+  logger::Logger::setLoggingEnabled(newval);
+}
+
+void assignLogLevel(int newval, void*) {
+  auto level = static_cast<logger::LogLevel>(newval);
+  logger::Logger::set_level(level);
+
+  std::string name;
+  switch (level) {
+    case logger::LogLevel::LOG_DEBUG:
+      name = "DEBUG";
+      break;
+    case logger::LogLevel::LOG_INFO:
+      name = "INFO";
+      break;
+    case logger::LogLevel::LOG_WARNING:
+      name = "WARNING";
+      break;
+    case logger::LogLevel::LOG_ERROR:
+      name = "ERROR";
+      break;
+  }
+  assignValue(ConfigManager::getMutableConfig().log_level, std::move(name));
+}
+
+// ----------------------------------------------------------------------------
+// Boot values
+// ----------------------------------------------------------------------------
+
+const ProviderConfig& bootProvider(Provider provider) {
+  for (const auto& p : boot_config.providers) {
+    if (p.provider == provider) {
+      return p;
+    }
+  }
+  // defineVariables() creates every provider before taking the snapshot
+  pg_unreachable();
+}
+
+int clampInt(int value, int min, int max) {
+  return std::clamp(value, min, max);
+}
+
+int bootMaxTokens(Provider provider) {
+  return clampInt(bootProvider(provider).default_max_tokens, 1,
+                  kMaxTokensLimit);
+}
+
+double bootTemperature(Provider provider) {
+  return std::clamp(bootProvider(provider).default_temperature, 0.0,
+                    kMaxTemperature);
+}
+
+void loadBootConfig() {
+  config_path = ConfigManager::getDefaultConfigPath();
+  config_stamp = stampFile(config_path);
+  config_reload_time = PgReloadTime;
+
+  try {
+    if (config_path.empty()) {
+      ConfigManager::loadConfigIfExists();
+    } else {
+      ConfigManager::loadConfigIfExists(config_path);
+    }
+  } catch (const std::exception& e) {
+    ereport(WARNING,
+            (errmsg("pg_ai_query: could not load configuration file, using "
+                    "defaults: %s",
+                    e.what())));
+    ConfigManager::reset();
+  }
+
+  // Assign hooks must never add a provider later: that would invalidate the
+  // ProviderConfig pointers handed out by getProviderConfig().
+  ConfigManager::getOrCreateProviderConfig(Provider::OPENAI);
+  ConfigManager::getOrCreateProviderConfig(Provider::ANTHROPIC);
+  ConfigManager::getOrCreateProviderConfig(Provider::GEMINI);
+
+  boot_config = ConfigManager::getMutableConfig();
+}
+
+// ----------------------------------------------------------------------------
+// Reload
+//
+// Re-read values become the parameters' defaults at PGC_S_DYNAMIC_DEFAULT
+// priority: they replace earlier file values, but anything set in
+// postgresql.conf, ALTER ... SET or SET keeps precedence. Errors are reported
+// as WARNINGs so a bad value never aborts the caller's query.
+// ----------------------------------------------------------------------------
+
+void setDefault(const char* name, const char* value) {
+  (void)set_config_option(name, value, PGC_SUSET, PGC_S_DYNAMIC_DEFAULT,
+                          GUC_ACTION_SET, true, WARNING, false);
+}
+
+void setDefault(const char* name, const std::string& value) {
+  setDefault(name, value.c_str());
+}
+
+void setDefault(const char* name, bool value) {
+  setDefault(name, value ? "on" : "off");
+}
+
+void setDefault(const char* name, int value) {
+  setDefault(name, std::to_string(value));
+}
+
+void setDefault(const char* name, double value) {
+  setDefault(name, std::to_string(value));
+}
+
+void applyFileDefaults(Configuration& file_config) {
+  const auto& openai =
+      ConfigManager::getOrCreateProviderConfig(file_config, Provider::OPENAI);
+  const auto& anthropic = ConfigManager::getOrCreateProviderConfig(
+      file_config, Provider::ANTHROPIC);
+  const auto& gemini =
+      ConfigManager::getOrCreateProviderConfig(file_config, Provider::GEMINI);
+
+  setDefault("pg_ai_query.openai_api_key", openai.api_key);
+  setDefault("pg_ai_query.openai_default_model", openai.default_model);
+  setDefault("pg_ai_query.openai_fast_model", openai.fast_model);
+  setDefault("pg_ai_query.openai_max_tokens", openai.default_max_tokens);
+  setDefault("pg_ai_query.openai_temperature", openai.default_temperature);
+  setDefault("pg_ai_query.openai_api_endpoint", openai.api_endpoint);
+
+  setDefault("pg_ai_query.anthropic_api_key", anthropic.api_key);
+  setDefault("pg_ai_query.anthropic_default_model", anthropic.default_model);
+  setDefault("pg_ai_query.anthropic_fast_model", anthropic.fast_model);
+  setDefault("pg_ai_query.anthropic_max_tokens", anthropic.default_max_tokens);
+  setDefault("pg_ai_query.anthropic_temperature",
+             anthropic.default_temperature);
+  setDefault("pg_ai_query.anthropic_api_endpoint", anthropic.api_endpoint);
+
+  setDefault("pg_ai_query.gemini_api_key", gemini.api_key);
+  setDefault("pg_ai_query.gemini_default_model", gemini.default_model);
+  setDefault("pg_ai_query.gemini_fast_model", gemini.fast_model);
+  setDefault("pg_ai_query.gemini_max_tokens", gemini.default_max_tokens);
+  setDefault("pg_ai_query.gemini_temperature", gemini.default_temperature);
+
+  setDefault("pg_ai_query.log_level", file_config.log_level);
+  setDefault("pg_ai_query.enable_logging", file_config.enable_logging);
+  setDefault("pg_ai_query.request_timeout_ms", file_config.request_timeout_ms);
+  setDefault("pg_ai_query.max_retries", file_config.max_retries);
+  setDefault("pg_ai_query.adaptive_max_tokens",
+             file_config.adaptive_max_tokens);
+
+  setDefault("pg_ai_query.enforce_limit", file_config.enforce_limit);
+  setDefault("pg_ai_query.default_limit", file_config.default_limit);
+  setDefault("pg_ai_query.max_query_length", file_config.max_query_length);
+  setDefault("pg_ai_query.max_query_cost", file_config.max_query_cost);
+  setDefault("pg_ai_query.plan_cache_size", file_config.plan_cache_size);
+  setDefault("pg_ai_query.template_fast_path", file_config.template_fast_path);
+  setDefault("pg_ai_query.template_min_confidence",
+             file_config.template_min_confidence);
+  setDefault("pg_ai_query.history_examples", file_config.history_examples);
+  setDefault("pg_ai_query.history_min_similarity",
+             file_config.history_min_similarity);
+  setDefault("pg_ai_query.history_match_threshold",
+             file_config.history_match_threshold);
+  setDefault("pg_ai_query.conversation_turns", file_config.conversation_turns);
+
+  setDefault("pg_ai_query.show_explanation", file_config.show_explanation);
+  setDefault("pg_ai_query.show_warnings", file_config.show_warnings);
+  setDefault("pg_ai_query.show_suggested_visualization",
+             file_config.show_suggested_visualization);
+  setDefault("pg_ai_query.use_formatted_response",
+             file_config.use_formatted_response);
+
+  setDefault("pg_ai_query.system_prompt", file_config.system_prompt);
+  setDefault("pg_ai_query.explain_system_prompt",
+             file_config.explain_system_prompt);
+}
+
+}  // namespace
+
+void defineVariables() {
+  loadBootConfig();
+
+  // Keep the level the config file selected as the boot value
+  int boot_log_level = static_cast<int>(logger::Logger::get_level());
+
+  // --------------------------------------------------------------------------
+  // [openai]
+  // --------------------------------------------------------------------------
+  DefineCustomStringVariable(
+      "pg_ai_query.openai_api_key", "API key for the OpenAI provider.",
+      nullptr, &openai_vars.api_key,
+      bootProvider(Provider::OPENAI).api_key.c_str(), PGC_SUSET,
+      GUC_SUPERUSER_ONLY, nullptr,
+      assignProviderString<Provider::OPENAI, &ProviderConfig::api_key>,
+      nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.openai_default_model", "Model used for OpenAI requests.",
+      nullptr, &openai_vars.default_model,
+      bootProvider(Provider::OPENAI).default_model.c_str(), PGC_SUSET, 0,
+      nullptr,
+      assignProviderString<Provider::OPENAI, &ProviderConfig::default_model>,
+      nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.openai_fast_model",
+      "Model tried first for simple OpenAI requests.",
+      "Empty sends every request to the default model.",
+      &openai_vars.fast_model,
+      bootProvider(Provider::OPENAI).fast_model.c_str(), PGC_SUSET, 0, nullptr,
+      assignProviderString<Provider::OPENAI, &ProviderConfig::fast_model>,
+      nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.openai_max_tokens",
+      "Maximum output tokens for OpenAI requests.", nullptr,
+      &openai_vars.max_tokens, bootMaxTokens(Provider::OPENAI), 1,
+      kMaxTokensLimit, PGC_SUSET, 0, nullptr,
+      assignProviderMaxTokens<Provider::OPENAI>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.openai_temperature",
+      "Sampling temperature for OpenAI requests.", nullptr,
+      &openai_vars.temperature, bootTemperature(Provider::OPENAI), 0.0,
+      kMaxTemperature, PGC_SUSET, 0, nullptr,
+      assignProviderTemperature<Provider::OPENAI>, nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.openai_api_endpoint",
+      "Custom OpenAI-compatible API endpoint URL.",
+      "Empty uses the default OpenAI endpoint.", &openai_vars.api_endpoint,
+      bootProvider(Provider::OPENAI).api_endpoint.c_str(), PGC_SUSET, 0,
+      nullptr,
+      assignProviderString<Provider::OPENAI, &ProviderConfig::api_endpoint>,
+      nullptr);
+
+  // --------------------------------------------------------------------------
+  // [anthropic]
+  // --------------------------------------------------------------------------
+  DefineCustomStringVariable(
+      "pg_ai_query.anthropic_api_key", "API key for the Anthropic provider.",
+      nullptr, &anthropic_vars.api_key,
+      bootProvider(Provider::ANTHROPIC).api_key.c_str(), PGC_SUSET,
+      GUC_SUPERUSER_ONLY, nullptr,
+      assignProviderString<Provider::ANTHROPIC, &ProviderConfig::api_key>,
+      nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.anthropic_default_model",
+      "Model used for Anthropic requests.", nullptr,
+      &anthropic_vars.default_model,
+      bootProvider(Provider::ANTHROPIC).default_model.c_str(), PGC_SUSET, 0,
+      nullptr,
+      assignProviderString<Provider::ANTHROPIC,
+                           &ProviderConfig::default_model>,
+      nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.anthropic_fast_model",
+      "Model tried first for simple Anthropic requests.",
+      "Empty sends every request to the default model.",
+      &anthropic_vars.fast_model,
+      bootProvider(Provider::ANTHROPIC).fast_model.c_str(), PGC_SUSET, 0,
+      nullptr,
+      assignProviderString<Provider::ANTHROPIC, &ProviderConfig::fast_model>,
+      nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.anthropic_max_tokens",
+      "Maximum output tokens for Anthropic requests.", nullptr,
+      &anthropic_vars.max_tokens, bootMaxTokens(Provider::ANTHROPIC), 1,
+      kMaxTokensLimit, PGC_SUSET, 0, nullptr,
+      assignProviderMaxTokens<Provider::ANTHROPIC>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.anthropic_temperature",
+      "Sampling temperature for Anthropic requests.", nullptr,
+      &anthropic_vars.temperature, bootTemperature(Provider::ANTHROPIC), 0.0,
+      kMaxTemperature, PGC_SUSET, 0, nullptr,
+      assignProviderTemperature<Provider::ANTHROPIC>, nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.anthropic_api_endpoint",
+      "Custom Anthropic-compatible API endpoint URL.",
+      "Empty uses the default Anthropic endpoint.",
+      &anthropic_vars.api_endpoint,
+      bootProvider(Provider::ANTHROPIC).api_endpoint.c_str(), PGC_SUSET, 0,
+      nullptr,
+      assignProviderString<Provider::ANTHROPIC,
+                           &ProviderConfig::api_endpoint>,
+      nullptr);
+
+  // --------------------------------------------------------------------------
+  // [gemini]
+  // --------------------------------------------------------------------------
+  DefineCustomStringVariable(
+      "pg_ai_query.gemini_api_key", "API key for the Gemini provider.",
+      nullptr, &gemini_vars.api_key,
+      bootProvider(Provider::GEMINI).api_key.c_str(), PGC_SUSET,
+      GUC_SUPERUSER_ONLY, nullptr,
+      assignProviderString<Provider::GEMINI, &ProviderConfig::api_key>,
+      nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.gemini_default_model", "Model used for Gemini requests.",
+      nullptr, &gemini_vars.default_model,
+      bootProvider(Provider::GEMINI).default_model.c_str(), PGC_SUSET, 0,
+      nullptr,
+      assignProviderString<Provider::GEMINI, &ProviderConfig::default_model>,
+      nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.gemini_fast_model",
+      "Model tried first for simple Gemini requests.",
+      "Empty sends every request to the default model.",
+      &gemini_vars.fast_model,
+      bootProvider(Provider::GEMINI).fast_model.c_str(), PGC_SUSET, 0, nullptr,
+      assignProviderString<Provider::GEMINI, &ProviderConfig::fast_model>,
+      nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.gemini_max_tokens",
+      "Maximum output tokens for Gemini requests.", nullptr,
+      &gemini_vars.max_tokens, bootMaxTokens(Provider::GEMINI), 1,
+      kMaxTokensLimit, PGC_SUSET, 0, nullptr,
+      assignProviderMaxTokens<Provider::GEMINI>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.gemini_temperature",
+      "Sampling temperature for Gemini requests.", nullptr,
+      &gemini_vars.temperature, bootTemperature(Provider::GEMINI), 0.0,
+      kMaxTemperature, PGC_SUSET, 0, nullptr,
+      assignProviderTemperature<Provider::GEMINI>, nullptr);
+
+  // --------------------------------------------------------------------------
+  // Session profile
+  //
+  // Overrides for the provider settings above, meant to be set per role or
+  // database (ALTER ROLE/DATABASE ... SET) so different workloads can use
+  // different models. The defaults leave the provider settings in effect.
+  // --------------------------------------------------------------------------
+  DefineCustomEnumVariable(
+      "pg_ai_query.provider",
+      "Provider used when a function is called with provider 'auto'.",
+      "auto picks the first provider with an API key.", &profile_provider,
+      static_cast<int>(Provider::UNKNOWN), kProviderOptions, PGC_SUSET, 0,
+      nullptr, assignProfileProvider, nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.model", "Model overriding the provider's default model.",
+      "Empty uses the provider's default model.", &profile_model, "",
+      PGC_SUSET, 0, nullptr, assignProfileModel, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.max_tokens",
+      "Maximum output tokens overriding the provider's setting.",
+      "0 uses the provider's setting.", &profile_max_tokens, 0, 0,
+      kMaxTokensLimit, PGC_SUSET, 0, nullptr, assignProfileMaxTokens,
+      nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.temperature",
+      "Sampling temperature overriding the provider's setting.",
+      "-1 uses the provider's setting.", &profile_temperature, -1.0, -1.0,
+      kMaxTemperature, PGC_SUSET, 0, nullptr, assignProfileTemperature,
+      nullptr);
+
+  // --------------------------------------------------------------------------
+  // Schema digest worker
+  //
+  // Only read at server start, with the library in shared_preload_libraries.
+  // --------------------------------------------------------------------------
+  DefineCustomStringVariable(
+      "pg_ai_query.digest_database",
+      "Database whose schema digest the background worker keeps current.",
+      "Empty starts no worker.", &digest_database, "", PGC_POSTMASTER, 0,
+      nullptr, assignString<&Configuration::digest_database>, nullptr);
+
+  // --------------------------------------------------------------------------
+  // [general]
+  // --------------------------------------------------------------------------
+  DefineCustomEnumVariable("pg_ai_query.log_level",
+                           "Minimum level of pg_ai_query log messages.",
+                           nullptr, &log_level, boot_log_level,
+                           kLogLevelOptions, PGC_SUSET, 0, nullptr,
+                           assignLogLevel, nullptr);
+
+  DefineCustomBoolVariable("pg_ai_query.enable_logging",
+                           "Emits pg_ai_query log messages.", nullptr,
+                           &enable_logging, boot_config.enable_logging,
+                           PGC_SUSET, 0, nullptr, assignEnableLogging,
+                           nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.request_timeout_ms", "Timeout for AI provider requests.",
+      nullptr, &request_timeout_ms,
+      clampInt(boot_config.request_timeout_ms, 0, INT_MAX), 0, INT_MAX,
+      PGC_SUSET, GUC_UNIT_MS, nullptr,
+      assignInt<&Configuration::request_timeout_ms>, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.max_retries", "Retries for failed AI provider requests.",
+      nullptr, &max_retries, clampInt(boot_config.max_retries, 0, 100), 0,
+      100, PGC_SUSET, 0, nullptr, assignInt<&Configuration::max_retries>,
+      nullptr);
+
+  DefineCustomBoolVariable(
+      "pg_ai_query.adaptive_max_tokens",
+      "Caps output tokens at recently observed completion lengths.",
+      "Truncated replies are retried once with the configured max_tokens.",
+      &adaptive_max_tokens, boot_config.adaptive_max_tokens, PGC_SUSET, 0,
+      nullptr, assignBool<&Configuration::adaptive_max_tokens>, nullptr);
+
+  // --------------------------------------------------------------------------
+  // [query]
+  // --------------------------------------------------------------------------
+  DefineCustomBoolVariable(
+      "pg_ai_query.enforce_limit",
+      "Adds a LIMIT clause to generated SELECT queries.", nullptr,
+      &enforce_limit, boot_config.enforce_limit, PGC_SUSET, 0, nullptr,
+      assignBool<&Configuration::enforce_limit>, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.default_limit", "LIMIT applied to generated queries.",
+      nullptr, &default_limit, clampInt(boot_config.default_limit, 1, INT_MAX),
+      1, INT_MAX, PGC_SUSET, 0, nullptr,
+      assignInt<&Configuration::default_limit>, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.max_query_length",
+      "Maximum characters in a natural language request.", nullptr,
+      &max_query_length, clampInt(boot_config.max_query_length, 1, INT_MAX),
+      1, INT_MAX, PGC_SUSET, 0, nullptr,
+      assignInt<&Configuration::max_query_length>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.max_query_cost",
+      "Highest planner cost estimate of a query ai_query() executes.",
+      "0 executes queries of any cost.", &max_query_cost,
+      std::clamp(boot_config.max_query_cost, 0.0, kMaxQueryCost), 0.0,
+      kMaxQueryCost, PGC_SUSET, 0, nullptr,
+      assignReal<&Configuration::max_query_cost>, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.plan_cache_size",
+      "Plans of executed generated queries kept per session.",
+      "Repeated queries run by ai_query() skip parsing and planning. "
+      "0 disables the cache.",
+      &plan_cache_size, clampInt(boot_config.plan_cache_size, 0, 10000), 0,
+      10000, PGC_SUSET, 0, nullptr,
+      assignInt<&Configuration::plan_cache_size>, nullptr);
+
+  DefineCustomBoolVariable(
+      "pg_ai_query.template_fast_path",
+      "Answers common request shapes locally without a provider call.",
+      "Counts, top-N by a column, recent rows and lookups by key.",
+      &template_fast_path, boot_config.template_fast_path, PGC_SUSET, 0,
+      nullptr, assignBool<&Configuration::template_fast_path>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.template_min_confidence",
+      "Lowest template confidence answered without a provider call.",
+      "Each word of the request a template does not understand halves its "
+      "confidence.",
+      &template_min_confidence,
+      std::clamp(boot_config.template_min_confidence, 0.0, 1.0), 0.0, 1.0,
+      PGC_SUSET, 0, nullptr,
+      assignReal<&Configuration::template_min_confidence>, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.history_examples",
+      "Accepted queries included in the prompt as examples.",
+      "0 disables retrieval from pg_ai_query_history.", &history_examples,
+      clampInt(boot_config.history_examples, 0, 20), 0, 20, PGC_SUSET, 0,
+      nullptr, assignInt<&Configuration::history_examples>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.history_min_similarity",
+      "Lowest trigram similarity of an accepted query used as example.",
+      nullptr, &history_min_similarity,
+      std::clamp(boot_config.history_min_similarity, 0.0, 1.0), 0.0, 1.0,
+      PGC_SUSET, 0, nullptr,
+      assignReal<&Configuration::history_min_similarity>, nullptr);
+
+  DefineCustomRealVariable(
+      "pg_ai_query.history_match_threshold",
+      "Similarity from which an accepted query is returned directly.",
+      "Matching requests skip the provider.", &history_match_threshold,
+      std::clamp(boot_config.history_match_threshold, 0.0, 1.0), 0.0, 1.0,
+      PGC_SUSET, 0, nullptr,
+      assignReal<&Configuration::history_match_threshold>, nullptr);
+
+  DefineCustomIntVariable(
+      "pg_ai_query.conversation_turns",
+      "Earlier requests kept as context for follow-up requests.",
+      "0 treats every request as a new conversation.", &conversation_turns,
+      clampInt(boot_config.conversation_turns, 0, 20), 0, 20, PGC_USERSET, 0,
+      nullptr, assignInt<&Configuration::conversation_turns>, nullptr);
+
+  // --------------------------------------------------------------------------
+  // [response]
+  // --------------------------------------------------------------------------
+  DefineCustomBoolVariable(
+      "pg_ai_query.show_explanation",
+      "Includes the explanation in generate_query output.", nullptr,
+      &show_explanation, boot_config.show_explanation, PGC_USERSET, 0,
+      nullptr, assignBool<&Configuration::show_explanation>, nullptr);
+
+  DefineCustomBoolVariable(
+      "pg_ai_query.show_warnings",
+      "Includes warnings in generate_query output.", nullptr, &show_warnings,
+      boot_config.show_warnings, PGC_USERSET, 0, nullptr,
+      assignBool<&Configuration::show_warnings>, nullptr);
+
+  DefineCustomBoolVariable(
+      "pg_ai_query.show_suggested_visualization",
+      "Includes the suggested visualization in generate_query output.",
+      nullptr, &show_suggested_visualization,
+      boot_config.show_suggested_visualization, PGC_USERSET, 0, nullptr,
+      assignBool<&Configuration::show_suggested_visualization>, nullptr);
+
+  DefineCustomBoolVariable(
+      "pg_ai_query.use_formatted_response",
+      "Returns generate_query output as JSON.", nullptr,
+      &use_formatted_response, boot_config.use_formatted_response,
+      PGC_USERSET, 0, nullptr,
+      assignBool<&Configuration::use_formatted_response>, nullptr);
+
+  // --------------------------------------------------------------------------
+  // [prompts]
+  // --------------------------------------------------------------------------
+  DefineCustomStringVariable(
+      "pg_ai_query.system_prompt", "System prompt for generate_query.",
+      "Empty uses the built-in prompt.", &system_prompt,
+      boot_config.system_prompt.c_str(), PGC_SUSET, 0, nullptr,
+      assignString<&Configuration::system_prompt>, nullptr);
+
+  DefineCustomStringVariable(
+      "pg_ai_query.explain_system_prompt", "System prompt for explain_query.",
+      "Empty uses the built-in prompt.", &explain_system_prompt,
+      boot_config.explain_system_prompt.c_str(), PGC_SUSET, 0, nullptr,
+      assignString<&Configuration::explain_system_prompt>, nullptr);
+
+#if PG_VERSION_NUM >= 150000
+  MarkGUCPrefixReserved("pg_ai_query");
+#else
+  EmitWarningsOnPlaceholders("pg_ai_query");
+#endif
+}
+
+void reloadIfNeeded() {
+  if (PgReloadTime == config_reload_time) {
+    return;
+  }
+  config_reload_time = PgReloadTime;
+
+  FileStamp stamp = stampFile(config_path);
+  if (stamp == config_stamp) {
+    return;
+  }
+  config_stamp = stamp;
+
+  // A removed file reverts to the built-in defaults
+  Configuration file_config;
+  try {
+    if (stamp.exists) {
+      ConfigManager::readConfigFile(config_path, file_config);
+    }
+  } catch (const std::exception& e) {
+    ereport(WARNING,
+            (errmsg("pg_ai_query: could not reload configuration file, "
+                    "keeping current settings: %s",
+                    e.what())));
+    return;
+  }
+
+  logger::Logger::info("Reloading configuration from: " + config_path);
+  applyFileDefaults(file_config);
+}
+
+}  // namespace pg_ai::guc
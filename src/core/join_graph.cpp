@@ -0,0 +1,130 @@
+#include "../include/join_graph.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_set>
+#include <utility>
+
+namespace pg_ai {
+
+JoinGraph::JoinGraph(std::vector<ForeignKey> keys) : keys_(std::move(keys)) {
+  for (size_t i = 0; i < keys_.size(); ++i) {
+    // A self-reference never bridges two tables
+    if (keys_[i].relid == keys_[i].referenced_relid) {
+      continue;
+    }
+    edges_[keys_[i].relid].push_back(i);
+    edges_[keys_[i].referenced_relid].push_back(i);
+  }
+}
+
+std::vector<BridgeTable> JoinGraph::connect(
+    const std::vector<uint32_t>& relids,
+    const std::function<bool(uint32_t)>& usable) const {
+  std::vector<BridgeTable> bridges;
+  if (edges_.empty()) {
+    return bridges;
+  }
+
+  std::unordered_set<uint32_t> mentioned(relids.begin(), relids.end());
+  std::unordered_set<uint32_t> connected;
+  std::unordered_map<uint32_t, size_t> bridge_of;
+  auto addKey = [&](uint32_t relid, const ForeignKey* key) {
+    auto [it, inserted] = bridge_of.try_emplace(relid, bridges.size());
+    if (inserted) {
+      bridges.push_back(BridgeTable{.relid = relid, .keys = {}});
+    }
+    auto& keys = bridges[it->second].keys;
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+      keys.push_back(key);
+    }
+  };
+
+  for (uint32_t start : relids) {
+    if (connected.empty() || connected.count(start) != 0) {
+      connected.insert(start);
+      continue;
+    }
+
+    // Breadth-first from start until any connected table is reached; each
+    // visited table remembers the key it was reached by
+    std::unordered_map<uint32_t, size_t> reached_by;
+    std::vector<uint32_t> frontier{start};
+    std::optional<uint32_t> found;
+    for (size_t depth = 0; depth < kMaxJoins && !found && !frontier.empty();
+         ++depth) {
+      std::vector<uint32_t> next;
+      for (uint32_t table : frontier) {
+        auto edges = edges_.find(table);
+        if (edges == edges_.end()) {
+          continue;
+        }
+        for (size_t key : edges->second) {
+          uint32_t other = keys_[key].relid == table
+                               ? keys_[key].referenced_relid
+                               : keys_[key].relid;
+          if (other == start || reached_by.count(other) != 0 ||
+              !usable(other)) {
+            continue;
+          }
+          reached_by.emplace(other, key);
+          if (connected.count(other) != 0) {
+            found = other;
+            break;
+          }
+          next.push_back(other);
+        }
+        if (found) {
+          break;
+        }
+      }
+      frontier = std::move(next);
+    }
+
+    connected.insert(start);
+    if (!found) {
+      continue;
+    }
+
+    // Walk back to start; every table in between bridges the two
+    uint32_t table = *found;
+    const ForeignKey* later = nullptr;
+    while (table != start) {
+      const ForeignKey* key = &keys_[reached_by.at(table)];
+      if (later != nullptr && mentioned.count(table) == 0) {
+        addKey(table, key);
+        addKey(table, later);
+      }
+      connected.insert(table);
+      later = key;
+      table = key->relid == table ? key->referenced_relid : key->relid;
+    }
+  }
+  return bridges;
+}
+
+std::string JoinGraph::formatBridge(const BridgeTable& bridge) {
+  std::string text;
+  if (bridge.keys.empty()) {
+    return text;
+  }
+  const ForeignKey& first = *bridge.keys.front();
+  text += "Join through ";
+  text += first.relid == bridge.relid ? first.table : first.referenced_table;
+  text += ":\n";
+  for (const ForeignKey* key : bridge.keys) {
+    text += "  ";
+    for (size_t i = 0;
+         i < key->columns.size() && i < key->referenced_columns.size(); ++i) {
+      if (i > 0) {
+        text += " AND ";
+      }
+      text += key->table + "." + key->columns[i] + " = " +
+              key->referenced_table + "." + key->referenced_columns[i];
+    }
+    text += '\n';
+  }
+  return text;
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,257 @@
+#include "../include/keyword_scanner.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef PG_AI_KEYWORD_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+namespace pg_ai {
+
+namespace {
+
+constexpr size_t kMaxKeywords = 64;
+
+inline uint8_t foldByte(uint8_t c) {
+  return static_cast<uint8_t>(c - 'A') < 26 ? c | 0x20 : c;
+}
+
+}  // namespace
+
+KeywordScanner::KeywordScanner(
+    std::initializer_list<std::string_view> keywords) {
+  if (keywords.size() > kMaxKeywords) {
+    throw std::invalid_argument("KeywordScanner supports at most 64 keywords");
+  }
+
+  keywords_.reserve(keywords.size());
+  for (std::string_view keyword : keywords) {
+    if (keyword.empty()) {
+      throw std::invalid_argument("KeywordScanner keywords must be non-empty");
+    }
+
+    Keyword kw;
+    kw.folded.reserve(keyword.size());
+    for (char c : keyword) {
+      kw.folded += static_cast<char>(foldByte(static_cast<uint8_t>(c)));
+    }
+    kw.first = static_cast<uint8_t>(kw.folded.front());
+    kw.second = static_cast<uint8_t>(kw.folded[kw.folded.size() > 1 ? 1 : 0]);
+    kw.last = static_cast<uint8_t>(kw.folded.back());
+
+    max_length_ = std::max(max_length_, kw.folded.size());
+    keywords_.push_back(std::move(kw));
+  }
+}
+
+uint64_t KeywordScanner::scan(std::string_view text) const {
+  return scanImpl(text, false);
+}
+
+bool KeywordScanner::containsAny(std::string_view text) const {
+  return scanImpl(text, true) != 0;
+}
+
+uint64_t KeywordScanner::scanImpl(std::string_view text,
+                                  bool stop_at_first) const {
+  if (keywords_.empty()) {
+    return 0;
+  }
+
+#ifdef PG_AI_KEYWORD_SCANNER_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2 ? scanAVX2(text, stop_at_first)
+                  : scanSSE2(text, stop_at_first);
+#else
+  return scanScalar(text, 0, 0, stop_at_first);
+#endif
+}
+
+bool KeywordScanner::matchesAt(std::string_view text,
+                               size_t pos,
+                               const Keyword& kw) const {
+  if (pos + kw.folded.size() > text.size()) {
+    return false;
+  }
+  for (size_t j = 0; j < kw.folded.size(); ++j) {
+    if (foldByte(static_cast<uint8_t>(text[pos + j])) !=
+        static_cast<uint8_t>(kw.folded[j])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t KeywordScanner::scanScalar(std::string_view text,
+                                    size_t from,
+                                    uint64_t found,
+                                    bool stop_at_first) const {
+  const uint64_t all = keywords_.size() == kMaxKeywords
+                           ? ~uint64_t{0}
+                           : (uint64_t{1} << keywords_.size()) - 1;
+
+  for (size_t pos = from; pos < text.size() && found != all; ++pos) {
+    uint8_t c = foldByte(static_cast<uint8_t>(text[pos]));
+    for (size_t k = 0; k < keywords_.size(); ++k) {
+      const uint64_t bit = uint64_t{1} << k;
+      if ((found & bit) || keywords_[k].first != c) {
+        continue;
+      }
+      if (matchesAt(text, pos, keywords_[k])) {
+        found |= bit;
+        if (stop_at_first) {
+          return found;
+        }
+      }
+    }
+  }
+  return found;
+}
+
+#ifdef PG_AI_KEYWORD_SCANNER_X86
+
+// ----------------------------------------------------------------------------
+// SIMD candidate filter
+//
+// For a block of W text positions starting at i, three case-folded loads are
+// compared against every keyword: text[i..] with its first byte, text[i+1..]
+// with its second byte and text[i+len-1..] with its last byte. ANDing the
+// three byte masks leaves very few candidate positions, which are verified
+// with matchesAt(). The two leading loads are shared by all keywords, so the
+// text is streamed through once regardless of the number of keywords.
+//
+// Blocks are processed while every load stays in bounds; the remaining tail
+// (shorter than W + longest keyword) is finished by the scalar loop.
+// ----------------------------------------------------------------------------
+
+namespace {
+
+inline __m128i fold16(__m128i v) {
+  const __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8('A'));
+  const __m128i is_upper =
+      _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(25)), offset);
+  return _mm_or_si128(v, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2"))) inline __m256i fold32(__m256i v) {
+  const __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8('A'));
+  const __m256i is_upper = _mm256_cmpeq_epi8(
+      _mm256_min_epu8(offset, _mm256_set1_epi8(25)), offset);
+  return _mm256_or_si256(v,
+                         _mm256_and_si256(is_upper, _mm256_set1_epi8(0x20)));
+}
+
+}  // namespace
+
+uint64_t KeywordScanner::scanSSE2(std::string_view text,
+                                  bool stop_at_first) const {
+  constexpr size_t W = 16;
+  const size_t n = text.size();
+  const size_t span = W + std::max<size_t>(max_length_, 2) - 1;
+  const char* data = text.data();
+
+  uint64_t found = 0;
+  size_t i = 0;
+
+  for (; i + span <= n; i += W) {
+    const __m128i b0 = fold16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    const __m128i b1 = fold16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1)));
+
+    for (size_t k = 0; k < keywords_.size(); ++k) {
+      const uint64_t bit = uint64_t{1} << k;
+      if (found & bit) {
+        continue;
+      }
+
+      const Keyword& kw = keywords_[k];
+      const size_t len = kw.folded.size();
+      __m128i mask = _mm_cmpeq_epi8(b0, _mm_set1_epi8(kw.first));
+      if (len > 1) {
+        const __m128i bl = fold16(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i + len - 1)));
+        mask = _mm_and_si128(
+            mask, _mm_and_si128(_mm_cmpeq_epi8(b1, _mm_set1_epi8(kw.second)),
+                                _mm_cmpeq_epi8(bl, _mm_set1_epi8(kw.last))));
+      }
+
+      unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(mask));
+      while (bits != 0) {
+        if (matchesAt(text, i + __builtin_ctz(bits), kw)) {
+          found |= bit;
+          if (stop_at_first) {
+            return found;
+          }
+          break;
+        }
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  if (stop_at_first && found) {
+    return found;
+  }
+  return scanScalar(text, i, found, stop_at_first);
+}
+
+__attribute__((target("avx2"))) uint64_t KeywordScanner::scanAVX2(
+    std::string_view text,
+    bool stop_at_first) const {
+  constexpr size_t W = 32;
+  const size_t n = text.size();
+  const size_t span = W + std::max<size_t>(max_length_, 2) - 1;
+  const char* data = text.data();
+
+  uint64_t found = 0;
+  size_t i = 0;
+
+  for (; i + span <= n; i += W) {
+    const __m256i b0 = fold32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    const __m256i b1 = fold32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1)));
+
+    for (size_t k = 0; k < keywords_.size(); ++k) {
+      const uint64_t bit = uint64_t{1} << k;
+      if (found & bit) {
+        continue;
+      }
+
+      const Keyword& kw = keywords_[k];
+      const size_t len = kw.folded.size();
+      __m256i mask = _mm256_cmpeq_epi8(b0, _mm256_set1_epi8(kw.first));
+      if (len > 1) {
+        const __m256i bl = fold32(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i + len - 1)));
+        mask = _mm256_and_si256(
+            mask,
+            _mm256_and_si256(_mm256_cmpeq_epi8(b1, _mm256_set1_epi8(kw.second)),
+                             _mm256_cmpeq_epi8(bl, _mm256_set1_epi8(kw.last))));
+      }
+
+      unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(mask));
+      while (bits != 0) {
+        if (matchesAt(text, i + __builtin_ctz(bits), kw)) {
+          found |= bit;
+          if (stop_at_first) {
+            return found;
+          }
+          break;
+        }
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  if (stop_at_first && found) {
+    return found;
+  }
+  return scanScalar(text, i, found, stop_at_first);
+}
+
+#endif  // PG_AI_KEYWORD_SCANNER_X86
+
+}  // namespace pg_ai
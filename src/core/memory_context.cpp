@@ -0,0 +1,50 @@
+#include "../include/memory_context.hpp"
+
+#include <new>
+
+namespace pg_ai {
+
+void* MemoryContextResource::do_allocate(std::size_t bytes,
+                                         std::size_t alignment) {
+  // palloc chunks are MAXALIGN'd; over-aligned requests get padded and are
+  // only released with the context.
+  std::size_t padded = alignment > MAXIMUM_ALIGNOF ? bytes + alignment : bytes;
+
+  // MCXT_ALLOC_NO_OOM turns an out-of-memory ERROR into a NULL return so the
+  // failure surfaces as a C++ exception instead of a longjmp.
+  void* p = MemoryContextAllocExtended(context_, padded,
+                                       MCXT_ALLOC_HUGE | MCXT_ALLOC_NO_OOM);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  if (alignment > MAXIMUM_ALIGNOF) {
+    return reinterpret_cast<void*>(TYPEALIGN(alignment, p));
+  }
+  return p;
+}
+
+void MemoryContextResource::do_deallocate(void* p,
+                                          std::size_t /*bytes*/,
+                                          std::size_t alignment) {
+  if (p != nullptr && alignment <= MAXIMUM_ALIGNOF) {
+    pfree(p);
+  }
+}
+
+bool MemoryContextResource::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept {
+  const auto* that = dynamic_cast<const MemoryContextResource*>(&other);
+  return that != nullptr && that->context_ == context_;
+}
+
+RequestMemoryContext::RequestMemoryContext()
+    : resource_(AllocSetContextCreate(CurrentMemoryContext,
+                                      "pg_ai_query request",
+                                      ALLOCSET_DEFAULT_SIZES)) {}
+
+RequestMemoryContext::~RequestMemoryContext() {
+  MemoryContextDelete(resource_.context());
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,134 @@
+#include "../include/model_routing.hpp"
+
+#include <algorithm>
+
+#include <nlohmann/json.hpp>
+
+#include "../include/keyword_scanner.hpp"
+
+namespace pg_ai {
+
+namespace {
+
+// Keywords are grouped by signal; each group contributes at most one point.
+// Group boundaries are indexes into the scanner's bitmask.
+constexpr size_t kAggregationEnd = 12;
+constexpr size_t kTimeEnd = 25;
+constexpr size_t kRankingEnd = 34;
+
+const KeywordScanner& complexityKeywords() {
+  static const KeywordScanner scanner({
+      // Aggregation
+      "average", "avg", "sum ", "total", "group", " per ", "each ",
+      "breakdown", "distribution", "median", "percent", "how many",
+      // Time ranges
+      "last ", "month", "week", "year", "daily", "hourly", "quarter",
+      "since", "between", "trend", "over time", "yesterday", " ago",
+      // Ranking
+      "top ", "rank", "highest", "lowest", "most ", "least ", "best ",
+      "worst ", "largest",
+      // Comparison and set logic
+      "compare", "versus", " vs", "ratio", "growth", "difference",
+      "without", "never", "cohort", "retention", "cumulative",
+      "running ", "moving ", "both ", "except"});
+  return scanner;
+}
+
+constexpr uint64_t groupMask(size_t begin, size_t end) {
+  return ((uint64_t{1} << end) - 1) & ~((uint64_t{1} << begin) - 1);
+}
+
+size_t countWords(std::string_view text) {
+  size_t words = 0;
+  bool in_word = false;
+  for (char c : text) {
+    bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    if (!space && !in_word) {
+      ++words;
+    }
+    in_word = !space;
+  }
+  return words;
+}
+
+double hitRate(const RoutingStats::Tier& tier) {
+  return tier.requests == 0 ? 0.0
+                            : static_cast<double>(tier.accepted) /
+                                  static_cast<double>(tier.requests);
+}
+
+}  // namespace
+
+ComplexityEstimate ComplexityEstimator::estimate(
+    std::string_view natural_language,
+    size_t mentioned_tables) {
+  const KeywordScanner& keywords = complexityKeywords();
+  uint64_t found = keywords.scan(natural_language);
+
+  ComplexityEstimate estimate;
+  const uint64_t groups[] = {
+      groupMask(0, kAggregationEnd), groupMask(kAggregationEnd, kTimeEnd),
+      groupMask(kTimeEnd, kRankingEnd),
+      groupMask(kRankingEnd, keywords.size())};
+  for (uint64_t group : groups) {
+    if (found & group) {
+      ++estimate.score;
+    }
+  }
+
+  if (mentioned_tables > 1) {
+    estimate.score +=
+        static_cast<int>(std::min<size_t>(mentioned_tables - 1, 3));
+  }
+
+  size_t words = countWords(natural_language);
+  if (words > 40) {
+    estimate.score += 2;
+  } else if (words > 20) {
+    estimate.score += 1;
+  }
+
+  estimate.tier = estimate.score >= kStrongThreshold ? ModelTier::kStrong
+                                                     : ModelTier::kFast;
+  return estimate;
+}
+
+RoutingStats::Tier RoutingStats::fast_;
+RoutingStats::Tier RoutingStats::strong_;
+
+void RoutingStats::record(ModelTier tier, bool accepted) {
+  Tier& counters = tier == ModelTier::kFast ? fast_ : strong_;
+  ++counters.requests;
+  if (accepted) {
+    ++counters.accepted;
+  }
+}
+
+const RoutingStats::Tier& RoutingStats::fast() {
+  return fast_;
+}
+
+const RoutingStats::Tier& RoutingStats::strong() {
+  return strong_;
+}
+
+std::string RoutingStats::toJson() {
+  nlohmann::json json = {
+      {"fast",
+       {{"requests", fast_.requests},
+        {"accepted", fast_.accepted},
+        {"escalated", fast_.requests - fast_.accepted},
+        {"hit_rate", hitRate(fast_)}}},
+      {"strong",
+       {{"requests", strong_.requests},
+        {"accepted", strong_.accepted},
+        {"hit_rate", hitRate(strong_)}}}};
+  return json.dump(2);
+}
+
+void RoutingStats::reset() {
+  fast_ = Tier{};
+  strong_ = Tier{};
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,56 @@
+#include "../include/output_budget.hpp"
+
+#include <algorithm>
+
+namespace pg_ai {
+
+namespace {
+
+// Budgets are rounded up to a multiple of this, so small shifts in the
+// observed lengths do not change the request.
+constexpr int kBudgetGranularity = 64;
+
+}  // namespace
+
+int OutputBudget::budget(RequestKind kind, int cap) const {
+  const Window& w = window(kind);
+  if (w.count < kMinSamples || cap <= kMinBudget) {
+    return cap;
+  }
+
+  std::array<int, kWindow> sorted = w.tokens;
+  auto end = sorted.begin() + w.count;
+  auto p95 = sorted.begin() + (w.count * 95 + 99) / 100 - 1;
+  std::nth_element(sorted.begin(), p95, end);
+
+  int budget = *p95 + *p95 / 2;
+  budget = (budget + kBudgetGranularity - 1) / kBudgetGranularity *
+           kBudgetGranularity;
+  return std::clamp(budget, kMinBudget, cap);
+}
+
+void OutputBudget::record(RequestKind kind, int completion_tokens) {
+  if (completion_tokens <= 0) {
+    return;
+  }
+
+  Window& w = windows_[static_cast<size_t>(kind)];
+  w.tokens[w.next] = completion_tokens;
+  w.next = (w.next + 1) % kWindow;
+  w.count = std::min(w.count + 1, kWindow);
+}
+
+size_t OutputBudget::samples(RequestKind kind) const {
+  return window(kind).count;
+}
+
+int OutputBudget::estimateTokens(std::string_view text) {
+  return static_cast<int>((text.size() + 3) / 4);
+}
+
+OutputBudget& OutputBudget::forProcess() {
+  static OutputBudget budgets;
+  return budgets;
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,49 @@
+#include "../include/plan_cache.hpp"
+
+#include <utility>
+
+namespace pg_ai {
+
+PlanCache::PlanCache(std::function<void(Plan)> release)
+    : release_(std::move(release)) {}
+
+PlanCache::Plan PlanCache::find(std::string_view sql) {
+  auto it = index_.find(sql);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->plan;
+}
+
+void PlanCache::insert(std::string sql, Plan plan, size_t capacity) {
+  erase(sql);
+  entries_.push_front(Entry{.sql = std::move(sql), .plan = plan});
+  index_.emplace(entries_.front().sql, entries_.begin());
+  evict(capacity);
+}
+
+void PlanCache::erase(std::string_view sql) {
+  auto it = index_.find(sql);
+  if (it == index_.end()) {
+    return;
+  }
+  auto entry = it->second;
+  index_.erase(it);
+  release_(entry->plan);
+  entries_.erase(entry);
+}
+
+void PlanCache::clear() {
+  evict(0);
+}
+
+void PlanCache::evict(size_t capacity) {
+  while (entries_.size() > capacity) {
+    index_.erase(entries_.back().sql);
+    release_(entries_.back().plan);
+    entries_.pop_back();
+  }
+}
+
+}  // namespace pg_ai
@@ -5,8 +5,8 @@
 namespace pg_ai {
 
 ProviderSelectionResult ProviderSelector::selectProvider(
-    const std::string& api_key,
-    const std::string& provider_preference) {
+    std::string_view api_key,
+    std::string_view provider_preference) {
   if (provider_preference == "openai") {
     return selectExplicitProvider(api_key, config::Provider::OPENAI);
   }
@@ -19,15 +19,22 @@ ProviderSelectionResult ProviderSelector::selectProvider(
     return selectExplicitProvider(api_key, config::Provider::GEMINI);
   }
 
+  // 'auto' uses the session's pg_ai_query.provider when one is set
+  config::Provider profile_provider =
+      config::ConfigManager::getConfig().profile.provider;
+  if (profile_provider != config::Provider::UNKNOWN) {
+    return selectExplicitProvider(api_key, profile_provider);
+  }
+
   return autoSelectProvider(api_key);
 }
 
 ProviderSelectionResult ProviderSelector::selectExplicitProvider(
-    const std::string& api_key,
+    std::string_view api_key,
     config::Provider provider) {
   ProviderSelectionResult result;
   result.provider = provider;
-  result.config = config::ConfigManager::getProviderConfig(provider);
+  result.config = config::ConfigManager::getEffectiveProviderConfig(provider);
   result.success = true;
 
   std::string provider_name = config::ConfigManager::providerToString(provider);
@@ -48,20 +55,22 @@ ProviderSelectionResult ProviderSelector::selectExplicitProvider(
     result.success = false;
     result.error_message = "No API key available for " + provider_name +
                            " provider. Please provide API key as parameter "
-                           "or configure it in ~/.pg_ai.config.";
+                           "or configure it in ~/.pg_ai.config or "
+                           "pg_ai_query." +
+                           provider_name + "_api_key.";
   }
 
   return result;
 }
 
 ProviderSelectionResult ProviderSelector::autoSelectProvider(
-    const std::string& api_key) {
+    std::string_view api_key) {
   ProviderSelectionResult result;
 
   if (!api_key.empty()) {
     result.provider = config::Provider::OPENAI;
-    result.config =
-        config::ConfigManager::getProviderConfig(config::Provider::OPENAI);
+    result.config = config::ConfigManager::getEffectiveProviderConfig(
+        config::Provider::OPENAI);
     result.api_key = api_key;
     result.api_key_source = "parameter";
     result.success = true;
@@ -71,8 +80,8 @@ ProviderSelectionResult ProviderSelector::autoSelectProvider(
     return result;
   }
 
-  const auto* openai_config =
-      config::ConfigManager::getProviderConfig(config::Provider::OPENAI);
+  const auto* openai_config = config::ConfigManager::getEffectiveProviderConfig(
+      config::Provider::OPENAI);
   if (openai_config && !openai_config->api_key.empty()) {
     logger::Logger::info(
         "Auto-selecting OpenAI provider based on configuration");
@@ -85,7 +94,8 @@ ProviderSelectionResult ProviderSelector::autoSelectProvider(
   }
 
   const auto* anthropic_config =
-      config::ConfigManager::getProviderConfig(config::Provider::ANTHROPIC);
+      config::ConfigManager::getEffectiveProviderConfig(
+          config::Provider::ANTHROPIC);
   if (anthropic_config && !anthropic_config->api_key.empty()) {
     logger::Logger::info(
         "Auto-selecting Anthropic provider based on configuration");
@@ -97,8 +107,8 @@ ProviderSelectionResult ProviderSelector::autoSelectProvider(
     return result;
   }
 
-  const auto* gemini_config =
-      config::ConfigManager::getProviderConfig(config::Provider::GEMINI);
+  const auto* gemini_config = config::ConfigManager::getEffectiveProviderConfig(
+      config::Provider::GEMINI);
   if (gemini_config && !gemini_config->api_key.empty()) {
     logger::Logger::info(
         "Auto-selecting Gemini provider based on configuration");
@@ -114,7 +124,8 @@ ProviderSelectionResult ProviderSelector::autoSelectProvider(
   result.success = false;
   result.error_message =
       "API key required. Pass as parameter or set OpenAI, "
-      "Anthropic, or Gemini API key in ~/.pg_ai.config.";
+      "Anthropic, or Gemini API key in ~/.pg_ai.config or "
+      "pg_ai_query.<provider>_api_key.";
   return result;
 }
 
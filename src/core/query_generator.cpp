@@ -3,15 +3,31 @@
 extern "C" {
 #include <postgres.h>
 
+#include <access/xact.h>
+#include <catalog/pg_type.h>
+#include <commands/extension.h>
+#include <miscadmin.h>
 #include <utils/builtins.h>
+#include <utils/lsyscache.h>
 
 #include <executor/spi.h>
+#include <nodes/parsenodes.h>
+#include <nodes/plannodes.h>
+#include <optimizer/optimizer.h>
+#include <utils/plancache.h>
+#include <utils/portal.h>
+#include <utils/tuplestore.h>
 }
 
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cmath>
+#include <iterator>
 #include <optional>
-#include <sstream>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "../include/gemini_client.h"
@@ -21,10 +37,22 @@ extern "C" {
 
 #include "../include/ai_client_factory.hpp"
 #include "../include/config.hpp"
+#include "../include/conversation.hpp"
+#include "../include/digest_worker.hpp"
+#include "../include/glossary.hpp"
+#include "../include/join_graph.hpp"
 #include "../include/logger.hpp"
+#include "../include/model_routing.hpp"
+#include "../include/output_budget.hpp"
+#include "../include/plan_cache.hpp"
 #include "../include/prompts.hpp"
 #include "../include/provider_selector.hpp"
+#include "../include/query_history.hpp"
 #include "../include/query_parser.hpp"
+#include "../include/query_templates.hpp"
+#include "../include/schema_cache.hpp"
+#include "../include/schema_index.hpp"
+#include "../include/schema_version.hpp"
 #include "../include/spi_connection.hpp"
 #include "../include/utils.hpp"
 
@@ -32,7 +60,836 @@ using namespace pg_ai::logger;
 
 namespace pg_ai {
 
-QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
+namespace {
+
+// Comments are clipped so a verbose one can't crowd the schema out of the
+// prompt: about 20 tokens per listed table, 50 per column or described table
+constexpr size_t kListedCommentLength = 80;
+constexpr size_t kCommentLength = 200;
+
+void appendInt(std::pmr::string& out, int64_t value) {
+  char buf[24];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, end);
+}
+
+// What the output budget needs from a finished provider call
+struct Completion {
+  bool truncated;
+  int tokens;
+};
+
+std::optional<Completion> completionOf(const ai::GenerateResult& result) {
+  if (!result) {
+    return std::nullopt;
+  }
+  int tokens = result.usage.completion_tokens > 0
+                   ? result.usage.completion_tokens
+                   : OutputBudget::estimateTokens(result.text);
+  return Completion{
+      .truncated = result.finish_reason == ai::kFinishReasonLength,
+      .tokens = tokens};
+}
+
+std::optional<Completion> completionOf(const gemini::GeminiResponse& result) {
+  if (!result.success) {
+    return std::nullopt;
+  }
+  int tokens = result.output_tokens > 0
+                   ? result.output_tokens
+                   : OutputBudget::estimateTokens(result.text);
+  return Completion{.truncated = result.truncated, .tokens = tokens};
+}
+
+// Runs call(max_tokens) with the adaptive output budget for `kind`. A reply
+// cut off at the budget is requested once more with the configured
+// max_tokens; failed calls are returned as-is and not recorded.
+template <typename Call>
+auto callWithOutputBudget(RequestKind kind,
+                          std::optional<int> max_tokens,
+                          Call&& call) {
+  if (!max_tokens.has_value() ||
+      !config::ConfigManager::getConfig().adaptive_max_tokens) {
+    return call(max_tokens);
+  }
+
+  auto& budgets = OutputBudget::forProcess();
+  int budget = budgets.budget(kind, *max_tokens);
+  auto result = call(std::optional<int>(budget));
+
+  auto completion = completionOf(result);
+  if (completion && completion->truncated && budget < *max_tokens) {
+    logger::Logger::info("Reply reached output budget of " +
+                         std::to_string(budget) +
+                         " tokens, retrying with max_tokens=" +
+                         std::to_string(*max_tokens));
+    result = call(max_tokens);
+    completion = completionOf(result);
+  }
+
+  if (completion) {
+    budgets.record(kind, completion->tokens);
+  }
+  return result;
+}
+
+// An answer worth returning: parsed, with SQL, and not a refusal
+bool isUsable(const QueryResult& result) {
+  return result.success && !result.generated_query.empty() &&
+         !QueryParser::hasErrorIndicators(result.explanation, result.warnings);
+}
+
+// Base tables the current user can read, optionally narrowed by an extra
+// WHERE condition on pg_class c. information_schema also lists tables with
+// only other privileges, which generated queries could not select from.
+DatabaseSchema readTables(std::string_view filter,
+                          std::pmr::memory_resource* memory) {
+  DatabaseSchema result{.tables = std::pmr::vector<TableInfo>(memory),
+                        .success = false};
+
+  try {
+    if (SPI_connect() != SPI_OK_CONNECT) {
+      result.error_message = "Failed to connect to SPI";
+      return result;
+    }
+
+    std::string query = R"(
+            SELECT
+                t.table_name::name,
+                t.table_schema::name,
+                t.table_type::text,
+                COALESCE(pg_stat.n_tup_ins + pg_stat.n_tup_upd + pg_stat.n_tup_del, 0)::int8 as estimated_rows,
+                c.oid::int8 as relid,
+                pg_catalog.row_security_active(c.oid) as row_security,
+                COALESCE(d.description, '') as description
+            FROM information_schema.tables t
+            JOIN pg_catalog.pg_namespace n ON n.nspname = t.table_schema
+            JOIN pg_catalog.pg_class c ON c.relnamespace = n.oid
+                AND c.relname = t.table_name
+            LEFT JOIN pg_stat_user_tables pg_stat ON pg_stat.relid = c.oid
+            LEFT JOIN pg_catalog.pg_description d ON d.objoid = c.oid
+                AND d.classoid = 'pg_catalog.pg_class'::regclass
+                AND d.objsubid = 0
+            WHERE t.table_schema NOT IN ('information_schema', 'pg_catalog')
+                AND t.table_type = 'BASE TABLE'
+                AND (pg_catalog.has_table_privilege(c.oid, 'SELECT')
+                    OR pg_catalog.has_any_column_privilege(c.oid, 'SELECT'))
+                )";
+    query += filter;
+    query += R"(
+            ORDER BY t.table_schema, t.table_name
+        )";
+
+    // Not read-only: a fresh snapshot sees DDL committed before the
+    // schema version the result is cached under
+    int ret = SPI_execute(query.c_str(), false, 0);
+
+    if (ret != SPI_OK_SELECT) {
+      result.error_message = "Failed to execute query";
+      SPI_finish();
+      return result;
+    }
+
+    SPITupleTable* tuptable = SPI_tuptable;
+    TupleDesc tupdesc = tuptable->tupdesc;
+    result.tables.reserve(SPI_processed);
+
+    for (uint64 i = 0; i < SPI_processed; i++) {
+      SPIRow row(tuptable->vals[i], tupdesc);
+      result.tables.push_back(TableInfo{
+          .table_name = std::pmr::string(row.getName(1), memory),
+          .schema_name = std::pmr::string(row.getName(2), memory),
+          .table_type = std::pmr::string(row.getText(3), memory),
+          .estimated_rows = row.getInt64(4),
+          .relid = static_cast<uint32_t>(row.getInt64(5)),
+          .row_security = row.getBool(6),
+          .description = std::pmr::string(row.getText(7), memory)});
+    }
+
+    result.success = true;
+    SPI_finish();
+
+  } catch (const std::exception& e) {
+    result.error_message = std::string("Exception: ") + e.what();
+    SPI_finish();
+  }
+
+  return result;
+}
+
+// The current role's schema cache at the current schema version, or nullptr
+// when it can't be used: without the shared version (library not preloaded), or
+// when a transaction snapshot may predate that version.
+SchemaCache* syncSchemaCache() {
+  auto version = schema_version::current();
+  if (!version || IsolationUsesXactSnapshot()) {
+    return nullptr;
+  }
+  auto& cache = SchemaCache::forRole(GetUserId(),
+                                     schema_version::roleGeneration());
+  if (cache.version() != version) {
+    cache.advance(*version,
+                  cache.version()
+                      ? schema_version::changedSince(*cache.version())
+                      : std::nullopt);
+  }
+  return &cache;
+}
+
+// Copies of cached data in the request's memory resource. Copy construction
+// would allocate from the default resource, and an allocator-extended copy
+// of a vector does not reach the strings of its aggregate elements.
+DatabaseSchema copyTables(const DatabaseSchema& schema,
+                          std::pmr::memory_resource* memory) {
+  DatabaseSchema copy{.tables = std::pmr::vector<TableInfo>(memory),
+                      .success = schema.success,
+                      .error_message = schema.error_message};
+  copy.tables.reserve(schema.tables.size());
+  for (const auto& table : schema.tables) {
+    copy.tables.push_back(TableInfo{
+        .table_name = std::pmr::string(table.table_name, memory),
+        .schema_name = std::pmr::string(table.schema_name, memory),
+        .table_type = std::pmr::string(table.table_type, memory),
+        .estimated_rows = table.estimated_rows,
+        .relid = table.relid,
+        .row_security = table.row_security,
+        .description = std::pmr::string(table.description, memory)});
+  }
+  return copy;
+}
+
+TableDetails copyDetails(const TableDetails& details,
+                         std::pmr::memory_resource* memory) {
+  TableDetails copy{
+      .table_name = std::pmr::string(details.table_name, memory),
+      .schema_name = std::pmr::string(details.schema_name, memory),
+      .columns = std::pmr::vector<ColumnInfo>(memory),
+      .indexes = std::pmr::vector<std::pmr::string>(memory),
+      .success = details.success,
+      .error_message = details.error_message,
+      .description = std::pmr::string(details.description, memory)};
+  copy.columns.reserve(details.columns.size());
+  for (const auto& column : details.columns) {
+    copy.columns.push_back(ColumnInfo{
+        .column_name = std::pmr::string(column.column_name, memory),
+        .data_type = std::pmr::string(column.data_type, memory),
+        .is_nullable = column.is_nullable,
+        .column_default = std::pmr::string(column.column_default, memory),
+        .is_primary_key = column.is_primary_key,
+        .is_foreign_key = column.is_foreign_key,
+        .foreign_table = std::pmr::string(column.foreign_table, memory),
+        .foreign_column = std::pmr::string(column.foreign_column, memory),
+        .description = std::pmr::string(column.description, memory)});
+  }
+  copy.indexes.reserve(details.indexes.size());
+  for (const auto& index : details.indexes) {
+    copy.indexes.emplace_back(index);
+  }
+  return copy;
+}
+
+DatabaseSchema loadDatabaseTables(std::pmr::memory_resource* memory) {
+  SchemaCache* cache = syncSchemaCache();
+  if (cache != nullptr) {
+    if (cache->tables() == nullptr && cache->staleTables().empty()) {
+      digest_worker::seedSchemaCache(*cache);
+    }
+    // Read only the tables that changed since the list was cached
+    if (!cache->staleTables().empty()) {
+      cache->patchTables(
+          QueryGenerator::getDatabaseTables(cache->staleTables(), memory));
+    }
+    if (const auto* tables = cache->tables()) {
+      return copyTables(*tables, memory);
+    }
+  }
+  auto schema = QueryGenerator::getDatabaseTables(memory);
+  if (cache != nullptr) {
+    cache->storeTables(schema);
+  }
+  return schema;
+}
+
+// QueryHistory::schemaVersion() of every base table, readable by the current
+// role or not: accept_query runs as the extension owner and generate_query as
+// the caller, so the key must not depend on privileges. Remembered until the
+// schema version moves.
+std::string historyKey() {
+  static std::optional<uint64_t> key_version;
+  static std::string key;
+  auto version = schema_version::current();
+  bool cacheable = version && !IsolationUsesXactSnapshot();
+  if (cacheable && key_version == version) {
+    return key;
+  }
+
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    logger::Logger::warning("Query history unavailable: " +
+                            spi_conn.getErrorMessage());
+    return "";
+  }
+
+  // The tables information_schema.tables lists as BASE TABLE, in its order
+  constexpr const char* kTablesQuery = R"(
+      SELECT c.relname, n.nspname
+      FROM pg_catalog.pg_class c
+      JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+      WHERE c.relkind IN ('r', 'p')
+          AND c.relpersistence <> 't'
+          AND n.nspname NOT IN ('information_schema', 'pg_catalog')
+      ORDER BY n.nspname, c.relname
+  )";
+  // Not read-only, for the same reason as getDatabaseTables()
+  int ret = SPI_execute(kTablesQuery, false, 0);
+  if (ret != SPI_OK_SELECT) {
+    logger::Logger::warning("Failed to read tables for query history: " +
+                            std::string(SPI_result_code_string(ret)));
+    return "";
+  }
+
+  DatabaseSchema tables{.tables = {}, .success = true, .error_message = ""};
+  tables.tables.reserve(SPI_processed);
+  for (uint64 i = 0; i < SPI_processed; i++) {
+    SPIRow row(SPI_tuptable->vals[i], SPI_tuptable->tupdesc);
+    tables.tables.push_back(
+        TableInfo{.table_name = std::pmr::string(row.getName(1)),
+                  .schema_name = std::pmr::string(row.getName(2)),
+                  .table_type = "BASE TABLE",
+                  .estimated_rows = 0,
+                  .relid = 0,
+                  .row_security = false,
+                  .description = ""});
+  }
+
+  std::string fingerprint = QueryHistory::schemaVersion(tables);
+  if (cacheable) {
+    key_version = version;
+    key = fingerprint;
+  }
+  return fingerprint;
+}
+
+// Details of a listed table, read as schema_name.table_name: from the
+// session's schema cache, else the schema digest, else the catalogs
+TableDetails loadTableDetails(const TableInfo& table,
+                              const std::string& schema_name,
+                              std::pmr::memory_resource* memory) {
+  std::string table_name(table.table_name);
+  SchemaCache* cache = syncSchemaCache();
+  if (cache != nullptr) {
+    if (const auto* details = cache->details(schema_name, table_name)) {
+      return copyDetails(*details, memory);
+    }
+  }
+
+  // The digest is keyed by OID, which only identifies the listed table
+  std::optional<TableDetails> digested;
+  if (table.relid != 0 && std::string_view(table.schema_name) == schema_name) {
+    digested = digest_worker::lookup(table.relid, memory);
+  }
+  auto details =
+      digested ? std::move(*digested)
+               : QueryGenerator::getTableDetails(table_name, schema_name,
+                                                 memory);
+  if (cache != nullptr) {
+    cache->storeDetails(details);
+  }
+  return details;
+}
+
+// Columns of listed tables in one catalog read, for search_schema() when
+// neither the schema cache nor the snapshot has them. Only what the search
+// index uses: no defaults, comments or indexes.
+std::vector<TableDetails> readColumns(const DatabaseSchema& schema,
+                                      const std::vector<uint32_t>& relids,
+                                      std::pmr::memory_resource* memory) {
+  std::vector<TableDetails> details;
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    logger::Logger::warning("Columns unavailable for search: " +
+                            spi_conn.getErrorMessage());
+    return details;
+  }
+
+  std::string query = R"(
+      SELECT a.attrelid::int8,
+          a.attname,
+          pg_catalog.format_type(a.atttypid, a.atttypmod),
+          NOT a.attnotnull,
+          EXISTS (
+              SELECT 1 FROM pg_catalog.pg_index i
+              WHERE i.indrelid = a.attrelid AND i.indisprimary
+                  AND a.attnum = ANY (i.indkey)),
+          fk.relname,
+          fk.attname
+      FROM pg_catalog.pg_attribute a
+      LEFT JOIN LATERAL (
+          SELECT r.relname, ra.attname
+          FROM pg_catalog.pg_constraint k
+          JOIN pg_catalog.pg_class r ON r.oid = k.confrelid
+          JOIN pg_catalog.pg_attribute ra ON ra.attrelid = k.confrelid
+              AND ra.attnum = k.confkey[
+                  pg_catalog.array_position(k.conkey, a.attnum)]
+          WHERE k.conrelid = a.attrelid AND k.contype = 'f'
+              AND a.attnum = ANY (k.conkey)
+          ORDER BY k.conname
+          LIMIT 1
+      ) fk ON true
+      WHERE a.attrelid = ANY('{)";
+  for (size_t i = 0; i < relids.size(); ++i) {
+    if (i > 0) {
+      query += ',';
+    }
+    query += std::to_string(relids[i]);
+  }
+  query += R"(}'::oid[])
+          AND a.attnum > 0 AND NOT a.attisdropped
+          AND pg_catalog.has_column_privilege(a.attrelid, a.attnum, 'SELECT')
+      ORDER BY a.attrelid, a.attnum
+  )";
+
+  // Not read-only, for the same reason as getDatabaseTables()
+  int ret = SPI_execute(query.c_str(), false, 0);
+  if (ret != SPI_OK_SELECT) {
+    logger::Logger::warning("Failed to read columns for search: " +
+                            std::string(SPI_result_code_string(ret)));
+    return details;
+  }
+
+  std::unordered_map<uint32_t, const TableInfo*> tables;
+  for (const auto& table : schema.tables) {
+    tables.emplace(table.relid, &table);
+  }
+  uint32_t current = 0;
+  for (uint64 i = 0; i < SPI_processed; i++) {
+    SPIRow row(SPI_tuptable->vals[i], SPI_tuptable->tupdesc);
+    auto relid = static_cast<uint32_t>(row.getInt64(1));
+    auto table = tables.find(relid);
+    if (table == tables.end()) {
+      continue;
+    }
+    if (details.empty() || relid != current) {
+      current = relid;
+      details.push_back(TableDetails{
+          .table_name = std::pmr::string(table->second->table_name, memory),
+          .schema_name = std::pmr::string(table->second->schema_name, memory),
+          .columns = std::pmr::vector<ColumnInfo>(memory),
+          .indexes = std::pmr::vector<std::pmr::string>(memory),
+          .success = true,
+          .error_message = "",
+          .description = std::pmr::string(memory)});
+    }
+    details.back().columns.push_back(ColumnInfo{
+        .column_name = std::pmr::string(row.getName(2), memory),
+        .data_type = std::pmr::string(row.getText(3), memory),
+        .is_nullable = row.getBool(4),
+        .column_default = std::pmr::string(memory),
+        .is_primary_key = row.getBool(5),
+        .is_foreign_key = !row.isNull(6),
+        .foreign_table = std::pmr::string(row.getName(6), memory),
+        .foreign_column = std::pmr::string(row.getName(7), memory),
+        .description = std::pmr::string(memory)});
+  }
+  return details;
+}
+
+// Tables whose name appears in the request, then those of glossary terms
+// appearing in it
+std::pmr::vector<const TableInfo*> mentionedTables(
+    std::string_view natural_language,
+    const DatabaseSchema& schema,
+    const Glossary& glossary,
+    std::pmr::memory_resource* memory) {
+  std::pmr::vector<const TableInfo*> mentioned(memory);
+  for (const auto& table : schema.tables) {
+    if (natural_language.find(table.table_name) != std::string_view::npos) {
+      mentioned.push_back(&table);
+    }
+  }
+
+  for (const auto* term : glossary.find(natural_language)) {
+    auto table = std::find_if(
+        schema.tables.begin(), schema.tables.end(), [&](const auto& t) {
+          return std::string_view(t.schema_name) == term->schema_name &&
+                 std::string_view(t.table_name) == term->table_name;
+        });
+    if (table != schema.tables.end() &&
+        std::find(mentioned.begin(), mentioned.end(), &*table) ==
+            mentioned.end()) {
+      mentioned.push_back(&*table);
+    }
+  }
+  return mentioned;
+}
+
+// Answers a request naming a single table from a query template when the
+// template is confident enough; nullopt leaves it to the provider.
+std::optional<QueryResult> answerFromTemplate(
+    const QueryRequest& request,
+    const config::Configuration& cfg,
+    const std::pmr::vector<const TableInfo*>& mentioned,
+    std::pmr::memory_resource* memory) {
+  // Only shaped requests are worth a table lookup
+  if (!cfg.template_fast_path || mentioned.size() != 1 ||
+      QueryTemplates::detect(request.natural_language) ==
+          TemplateShape::kNone) {
+    return std::nullopt;
+  }
+
+  auto details = loadTableDetails(
+      *mentioned[0], std::string(mentioned[0]->schema_name), memory);
+  if (!details.success) {
+    return std::nullopt;
+  }
+
+  auto match = QueryTemplates::match(
+      request.natural_language, details,
+      cfg.enforce_limit ? std::optional<int>(cfg.default_limit)
+                        : std::nullopt);
+  if (!match) {
+    return std::nullopt;
+  }
+
+  std::string shape = QueryTemplates::shapeName(match->shape);
+  if (match->confidence < cfg.template_min_confidence) {
+    logger::Logger::debug("Template '" + shape + "' confidence " +
+                          std::to_string(match->confidence) +
+                          " below threshold, using provider");
+    return std::nullopt;
+  }
+
+  logger::Logger::info("Answered from template '" + shape +
+                       "' without a provider call");
+  return QueryResult{.generated_query = std::move(match->sql),
+                     .explanation = std::move(match->explanation),
+                     .warnings = {},
+                     .row_limit_applied = match->row_limit_applied,
+                     .suggested_visualization = "",
+                     .success = true,
+                     .error_message = "",
+                     .source = "template"};
+}
+
+// Schema-qualified name of one of the extension's tables, or an empty
+// string when the extension is not installed in this database
+std::string extensionTable(const char* name) {
+  Oid extension = get_extension_oid("pg_ai_query", true);
+  if (!OidIsValid(extension)) {
+    return "";
+  }
+  char* schema = get_namespace_name(get_extension_schema(extension));
+  if (schema == nullptr) {
+    return "";
+  }
+  return std::string(quote_identifier(schema)) + "." + name;
+}
+
+// OID of one of the extension's tables, or InvalidOid when the extension is
+// not installed in this database
+Oid extensionTableOid(const char* name) {
+  Oid extension = get_extension_oid("pg_ai_query", true);
+  if (!OidIsValid(extension)) {
+    return InvalidOid;
+  }
+  return get_relname_relid(name, get_extension_schema(extension));
+}
+
+std::string historyTable() {
+  return extensionTable("pg_ai_query_history");
+}
+
+// Business terms from pg_ai_query_glossary; empty when the extension is not
+// installed or the table can't be read. Sets relid to the table's OID.
+Glossary readGlossary(uint32_t* relid) {
+  *relid = extensionTableOid("pg_ai_query_glossary");
+  if (*relid == InvalidOid) {
+    return Glossary();
+  }
+  std::string table = extensionTable("pg_ai_query_glossary");
+
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    logger::Logger::warning("Glossary unavailable: " +
+                            spi_conn.getErrorMessage());
+    *relid = InvalidOid;
+    return Glossary();
+  }
+
+  std::string query =
+      "SELECT term, schema_name, table_name, column_name FROM " + table;
+  int ret = SPI_execute(query.c_str(), false, 0);
+  if (ret != SPI_OK_SELECT) {
+    logger::Logger::warning("Failed to read glossary: " +
+                            std::string(SPI_result_code_string(ret)));
+    *relid = InvalidOid;
+    return Glossary();
+  }
+
+  std::vector<GlossaryEntry> entries;
+  entries.reserve(SPI_processed);
+  for (uint64 i = 0; i < SPI_processed; i++) {
+    SPIRow row(SPI_tuptable->vals[i], SPI_tuptable->tupdesc);
+    entries.push_back(GlossaryEntry{
+        .term = std::string(row.getText(1)),
+        .schema_name = std::string(row.getName(2)),
+        .table_name = std::string(row.getName(3)),
+        .column_name =
+            row.isNull(4) ? std::string() : std::string(row.getName(4))});
+  }
+  return Glossary(std::move(entries));
+}
+
+// The glossary, from the schema cache while no change to it was committed
+Glossary loadGlossary() {
+  SchemaCache* cache = syncSchemaCache();
+  if (cache != nullptr && cache->glossary() != nullptr) {
+    return *cache->glossary();
+  }
+  uint32_t relid = 0;
+  auto glossary = readGlossary(&relid);
+  if (cache != nullptr && relid != 0) {
+    cache->storeGlossary(relid, glossary);
+  }
+  return glossary;
+}
+
+// Foreign keys between tables, with their column names in constraint order
+JoinGraph readForeignKeys() {
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    logger::Logger::warning("Foreign keys unavailable: " +
+                            spi_conn.getErrorMessage());
+    return JoinGraph();
+  }
+
+  // Keys cloned onto partitions repeat their parent's
+  static constexpr const char* kQuery = R"(
+      SELECT c.oid::int8, c.conrelid::int8, c.confrelid::int8,
+             rn.nspname || '.' || r.relname,
+             fn.nspname || '.' || f.relname,
+             a.attname, af.attname
+      FROM pg_catalog.pg_constraint c
+      JOIN pg_catalog.pg_class r ON r.oid = c.conrelid
+      JOIN pg_catalog.pg_namespace rn ON rn.oid = r.relnamespace
+      JOIN pg_catalog.pg_class f ON f.oid = c.confrelid
+      JOIN pg_catalog.pg_namespace fn ON fn.oid = f.relnamespace
+      CROSS JOIN LATERAL unnest(c.conkey, c.confkey)
+          WITH ORDINALITY AS k(attnum, fattnum, n)
+      JOIN pg_catalog.pg_attribute a
+          ON a.attrelid = c.conrelid AND a.attnum = k.attnum
+      JOIN pg_catalog.pg_attribute af
+          ON af.attrelid = c.confrelid AND af.attnum = k.fattnum
+      WHERE c.contype = 'f' AND c.conparentid = 0
+      ORDER BY c.oid, k.n
+  )";
+  // Not read-only, like the table list the graph is cached with
+  int ret = SPI_execute(kQuery, false, 0);
+  if (ret != SPI_OK_SELECT) {
+    logger::Logger::warning("Failed to read foreign keys: " +
+                            std::string(SPI_result_code_string(ret)));
+    return JoinGraph();
+  }
+
+  std::vector<ForeignKey> keys;
+  int64_t constraint = 0;
+  for (uint64 i = 0; i < SPI_processed; i++) {
+    SPIRow row(SPI_tuptable->vals[i], SPI_tuptable->tupdesc);
+    if (keys.empty() || row.getInt64(1) != constraint) {
+      constraint = row.getInt64(1);
+      keys.push_back(ForeignKey{
+          .relid = static_cast<uint32_t>(row.getInt64(2)),
+          .referenced_relid = static_cast<uint32_t>(row.getInt64(3)),
+          .table = std::string(row.getText(4)),
+          .referenced_table = std::string(row.getText(5)),
+          .columns = {},
+          .referenced_columns = {}});
+    }
+    keys.back().columns.emplace_back(row.getName(6));
+    keys.back().referenced_columns.emplace_back(row.getName(7));
+  }
+  return JoinGraph(std::move(keys));
+}
+
+// The foreign key graph, from the schema cache while no table changed
+JoinGraph loadJoinGraph() {
+  SchemaCache* cache = syncSchemaCache();
+  if (cache != nullptr && cache->joinGraph() != nullptr) {
+    return *cache->joinGraph();
+  }
+  auto graph = readForeignKeys();
+  if (cache != nullptr) {
+    cache->storeJoinGraph(graph);
+  }
+  return graph;
+}
+
+// Most recently accepted queries for a schema version, newest first
+std::vector<HistoryExample> loadHistory(const std::string& schema_version) {
+  std::vector<HistoryExample> history;
+  std::string table = historyTable();
+  if (table.empty() || schema_version.empty()) {
+    return history;
+  }
+
+  SPIConnection spi_conn;
+  if (!spi_conn) {
+    logger::Logger::warning("Query history unavailable: " +
+                            spi_conn.getErrorMessage());
+    return history;
+  }
+
+  std::string query =
+      "SELECT natural_language_query, query FROM " + table +
+      " WHERE schema_version = $1 ORDER BY accepted_at DESC LIMIT " +
+      std::to_string(QueryHistory::kMaxCandidates);
+  Oid arg_types[] = {TEXTOID};
+  Datum args[] = {CStringGetTextDatum(schema_version.c_str())};
+  int ret = SPI_execute_with_args(query.c_str(), 1, arg_types, args, nullptr,
+                                  true, 0);
+  if (ret != SPI_OK_SELECT) {
+    logger::Logger::warning("Failed to read query history: " +
+                            std::string(SPI_result_code_string(ret)));
+    return history;
+  }
+
+  history.reserve(SPI_processed);
+  for (uint64 i = 0; i < SPI_processed; i++) {
+    SPIRow row(SPI_tuptable->vals[i], SPI_tuptable->tupdesc);
+    history.push_back(HistoryExample{.natural_language =
+                                         std::string(row.getText(1)),
+                                     .query = std::string(row.getText(2))});
+  }
+  return history;
+}
+
+// Sends simple requests to fast_model first and escalates to model when its
+// answer is not usable; complex requests go to model directly.
+template <typename Generate>
+QueryResult routeByComplexity(const ComplexityEstimate& complexity,
+                              const std::string& fast_model,
+                              const std::string& model,
+                              Generate&& generate) {
+  if (complexity.tier == ModelTier::kFast && !fast_model.empty() &&
+      fast_model != model) {
+    logger::Logger::info("Complexity score " +
+                         std::to_string(complexity.score) +
+                         ", trying fast model: " + fast_model);
+    QueryResult result = generate(fast_model);
+    bool accepted = isUsable(result);
+    RoutingStats::record(ModelTier::kFast, accepted);
+    if (accepted) {
+      result.source = "provider";
+      return result;
+    }
+    logger::Logger::info("Fast model answer not usable, escalating to: " +
+                         model);
+  }
+
+  QueryResult result = generate(model);
+  RoutingStats::record(ModelTier::kStrong, isUsable(result));
+  result.source = "provider";
+  return result;
+}
+
+// Rows fetched from the executeQuery() cursor at a time
+constexpr long kFetchBatch = 1000;
+
+// The statement without trailing whitespace and semicolons, so it can be
+// nested as a subquery
+std::string_view trimStatement(std::string_view query) {
+  while (!query.empty() &&
+         (query.back() == ';' ||
+          std::isspace(static_cast<unsigned char>(query.back())))) {
+    query.remove_suffix(1);
+  }
+  return query;
+}
+
+// Saved plans of executed queries, keyed by their SQL. Plans are kept
+// with SPI_keepplan and freed when evicted.
+PlanCache& executedPlans() {
+  static PlanCache plans([](PlanCache::Plan plan) {
+    SPI_freeplan(static_cast<SPIPlanPtr>(plan));
+  });
+  return plans;
+}
+
+// A single plain SELECT: not DML, a utility statement (which includes
+// SELECT INTO), a data-modifying CTE or a locking clause
+bool isReadOnlySelect(SPIPlanPtr plan) {
+  List* sources = SPI_plan_get_plan_sources(plan);
+  if (list_length(sources) != 1) {
+    return false;
+  }
+  auto* source = static_cast<CachedPlanSource*>(linitial(sources));
+  if (list_length(source->query_list) != 1) {
+    return false;
+  }
+  Query* query = linitial_node(Query, source->query_list);
+  return query->commandType == CMD_SELECT && query->utilityStmt == nullptr &&
+         !query->hasModifyingCTE && query->rowMarks == NIL;
+}
+
+// Whether a statement calls a volatile function anywhere, including
+// subqueries, FROM functions and expanded views. Functions with side effects
+// (nextval(), setval(), dblink_exec(), pg_advisory_lock()) are volatile, and
+// some of their effects would outlast any rollback.
+bool callsVolatileFunctions(SPIPlanPtr plan) {
+  ListCell* source_cell;
+  foreach (source_cell, SPI_plan_get_plan_sources(plan)) {
+    auto* source = static_cast<CachedPlanSource*>(lfirst(source_cell));
+    ListCell* query_cell;
+    foreach (query_cell, source->query_list) {
+      if (contain_volatile_functions(static_cast<Node*>(lfirst(query_cell)))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Why a prepared statement may not be executed, or nullptr
+const char* rejectionOf(SPIPlanPtr plan) {
+  if (!isReadOnlySelect(plan)) {
+    return "Only a single read-only SELECT statement can be executed";
+  }
+  if (callsVolatileFunctions(plan)) {
+    return "Queries calling volatile functions cannot be executed";
+  }
+  return nullptr;
+}
+
+// Every relation a prepared statement reads, including those under its
+// views, as an oid[] literal
+std::string referencedRelations(SPIPlanPtr plan) {
+  std::vector<Oid> relids;
+  ListCell* source_cell;
+  foreach (source_cell, SPI_plan_get_plan_sources(plan)) {
+    auto* source = static_cast<CachedPlanSource*>(lfirst(source_cell));
+    ListCell* relid_cell;
+    foreach (relid_cell, source->relationOids) {
+      relids.push_back(lfirst_oid(relid_cell));
+    }
+  }
+  std::sort(relids.begin(), relids.end());
+  relids.erase(std::unique(relids.begin(), relids.end()), relids.end());
+
+  std::string literal = "{";
+  for (size_t i = 0; i < relids.size(); ++i) {
+    if (i > 0) {
+      literal += ',';
+    }
+    literal += std::to_string(relids[i]);
+  }
+  literal += '}';
+  return literal;
+}
+
+}  // namespace
+
+QueryResult QueryGenerator::generateQuery(const QueryRequest& request,
+                                          std::pmr::memory_resource* memory) {
   try {
     const auto& cfg = config::ConfigManager::getConfig();
 
@@ -50,7 +907,8 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
                            std::to_string(cfg.max_query_length) +
                            " characters allowed. Your query: " +
                            std::to_string(request.natural_language.length()) +
-                           " characters."};
+                           " characters.",
+          .source = ""};
     }
 
     // Validate empty or whitespace-only query
@@ -64,7 +922,62 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
                          .row_limit_applied = false,
                          .suggested_visualization = "",
                          .success = false,
-                         .error_message = "Query cannot be empty."};
+                         .error_message = "Query cannot be empty.",
+                         .source = ""};
+    }
+
+    // One catalog read serves the fast paths and the prompt
+    auto schema = loadDatabaseTables(memory);
+    auto mentioned = mentionedTables(request.natural_language, schema,
+                                     loadGlossary(), memory);
+
+    // A follow-up keeps the role's conversation; anything else starts a new
+    // one. Every answered request becomes a turn of it.
+    auto& conversation = Conversation::forRole(
+        GetUserId(), schema_version::roleGeneration());
+    bool follow_up =
+        cfg.conversation_turns > 0 &&
+        conversation.isFollowUp(request.natural_language, mentioned.size());
+    if (!follow_up) {
+      conversation.reset();
+    }
+    auto remember = [&](QueryResult result) {
+      if (cfg.conversation_turns > 0 && isUsable(result)) {
+        conversation.recordTurn(
+            std::string(request.natural_language), result.generated_query,
+            static_cast<size_t>(cfg.conversation_turns));
+      }
+      return result;
+    };
+
+    if (auto result = answerFromTemplate(request, cfg, mentioned, memory)) {
+      return remember(std::move(*result));
+    }
+
+    std::vector<HistoryExample> examples;
+    if (cfg.history_examples > 0) {
+      examples = QueryHistory::nearest(
+          request.natural_language,
+          loadHistory(historyKey()),
+          static_cast<size_t>(cfg.history_examples),
+          cfg.history_min_similarity);
+    }
+    // A follow-up depends on the earlier turns, so an identical request
+    // from another conversation is only an example
+    if (!follow_up && !examples.empty() &&
+        examples.front().similarity >= cfg.history_match_threshold) {
+      logger::Logger::info("Answered from query history without a provider "
+                           "call");
+      return remember(QueryResult{
+          .generated_query = std::move(examples.front().query),
+          .explanation = "Previously accepted query for \"" +
+                         examples.front().natural_language + "\".",
+          .warnings = {},
+          .row_limit_applied = false,
+          .suggested_visualization = "",
+          .success = true,
+          .error_message = "",
+          .source = "history"});
     }
 
     // Use ProviderSelector to determine the provider
@@ -78,24 +991,31 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
                          .row_limit_applied = false,
                          .suggested_visualization = "",
                          .success = false,
-                         .error_message = selection.error_message};
+                         .error_message = selection.error_message,
+                         .source = ""};
     }
 
+    std::string prompt =
+        buildPrompt(request, schema, mentioned,
+                    QueryHistory::formatExamples(examples), conversation,
+                    follow_up, memory);
+    auto complexity = ComplexityEstimator::estimate(request.natural_language,
+                                                    mentioned.size());
+    std::string fast_model =
+        selection.config ? selection.config->fast_model : std::string();
+
     // Handle Gemini separately as it uses a different client
     if (selection.provider == config::Provider::GEMINI) {
       std::string model_name =
           (selection.config && !selection.config->default_model.empty())
               ? selection.config->default_model
-              : "gemini-2.5-flash";
+              : config::constants::DEFAULT_GEMINI_MODEL;
       logger::Logger::info("Using Gemini model: " + model_name);
 
-      std::string system_prompt = prompts::getSystemPrompt();
-      std::string prompt = buildPrompt(request);
-
       gemini::GeminiClient gemini_client(selection.api_key);
       gemini::GeminiRequest gemini_request{
           .model = model_name,
-          .system_prompt = system_prompt,
+          .system_prompt = prompts::getSystemPrompt(),
           .user_prompt = prompt,
           .temperature =
               selection.config
@@ -105,16 +1025,34 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
               selection.config
                   ? std::optional<int>(selection.config->default_max_tokens)
                   : std::nullopt};
-
-      auto gemini_result = gemini_client.generate_text(gemini_request);
-
-      if (!gemini_result.success) {
-        return QueryResult{.success = false,
-                           .error_message = "Gemini API error: " +
-                                            gemini_result.error_message};
-      }
-
-      return QueryParser::parseQueryResponse(gemini_result.text);
+      const std::optional<int> max_tokens = gemini_request.max_tokens;
+
+      return remember(routeByComplexity(
+          complexity, fast_model, model_name,
+          [&](const std::string& model) -> QueryResult {
+            gemini_request.model = model;
+            auto gemini_result = callWithOutputBudget(
+                RequestKind::kGenerate, max_tokens,
+                [&](std::optional<int> budget) {
+                  gemini_request.max_tokens = budget;
+                  return gemini_client.generate_text(gemini_request);
+                });
+
+            if (!gemini_result.success) {
+              return QueryResult{
+                  .generated_query = "",
+                  .explanation = "",
+                  .warnings = {},
+                  .row_limit_applied = false,
+                  .suggested_visualization = "",
+                  .success = false,
+                  .error_message =
+                      "Gemini API error: " + gemini_result.error_message,
+                  .source = ""};
+            }
+
+            return QueryParser::parseQueryResponse(gemini_result.text);
+          }));
     }
 
     // Use AIClientFactory for OpenAI and Anthropic
@@ -128,12 +1066,12 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
                          .row_limit_applied = false,
                          .suggested_visualization = "",
                          .success = false,
-                         .error_message = client_result.error_message};
+                         .error_message = client_result.error_message,
+                         .source = ""};
     }
 
-    std::string prompt = buildPrompt(request);
     ai::GenerateOptions options(client_result.model_name,
-                                prompts::getSystemPrompt(), prompt);
+                                prompts::getSystemPrompt(), std::move(prompt));
 
     if (selection.config) {
       options.max_tokens = selection.config->default_max_tokens;
@@ -144,32 +1082,46 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
       logger::Logger::info("Using model: " + client_result.model_name +
                            " with default settings");
     }
-
-    auto result = client_result.client.generate_text(options);
-
-    if (!result) {
-      return QueryResult{
-          .generated_query = "",
-          .explanation = "",
-          .warnings = {},
-          .row_limit_applied = false,
-          .suggested_visualization = "",
-          .success = false,
-          .error_message =
-              "AI API error: " + utils::formatAPIError(result.error_message())};
-    }
-
-    if (result.text.empty()) {
-      return QueryResult{.generated_query = "",
-                         .explanation = "",
-                         .warnings = {},
-                         .row_limit_applied = false,
-                         .suggested_visualization = "",
-                         .success = false,
-                         .error_message = "Empty response from AI service"};
-    }
-
-    return QueryParser::parseQueryResponse(result.text);
+    const std::optional<int> max_tokens = options.max_tokens;
+
+    return remember(routeByComplexity(
+        complexity, fast_model, client_result.model_name,
+        [&](const std::string& model) -> QueryResult {
+          options.model = model;
+          auto result = callWithOutputBudget(
+              RequestKind::kGenerate, max_tokens,
+              [&](std::optional<int> budget) {
+                options.max_tokens = budget;
+                return client_result.client.generate_text(options);
+              });
+
+          if (!result) {
+            return QueryResult{
+                .generated_query = "",
+                .explanation = "",
+                .warnings = {},
+                .row_limit_applied = false,
+                .suggested_visualization = "",
+                .success = false,
+                .error_message = "AI API error: " +
+                                 utils::formatAPIError(result.error_message()),
+                .source = ""};
+          }
+
+          if (result.text.empty()) {
+            return QueryResult{.generated_query = "",
+                               .explanation = "",
+                               .warnings = {},
+                               .row_limit_applied = false,
+                               .suggested_visualization = "",
+                               .success = false,
+                               .error_message =
+                                   "Empty response from AI service",
+                               .source = ""};
+          }
+
+          return QueryParser::parseQueryResponse(result.text);
+        }));
   } catch (const std::exception& e) {
     return QueryResult{.generated_query = "",
                        .explanation = "",
@@ -177,35 +1129,69 @@ QueryResult QueryGenerator::generateQuery(const QueryRequest& request) {
                        .row_limit_applied = false,
                        .suggested_visualization = "",
                        .success = false,
-                       .error_message = std::string("Exception: ") + e.what()};
+                       .error_message = std::string("Exception: ") + e.what(),
+                       .source = ""};
   }
 }
 
-std::string QueryGenerator::buildPrompt(const QueryRequest& request) {
-  std::ostringstream prompt;
-  const auto& cfg = config::ConfigManager::getConfig();
-
-  prompt << "Generate a PostgreSQL query for this request:\n\n";
-  prompt << "Request: " << request.natural_language << "\n";
-
-  std::string schema_context;
+std::string QueryGenerator::buildPrompt(
+    const QueryRequest& request,
+    const DatabaseSchema& schema,
+    const std::pmr::vector<const TableInfo*>& mentioned,
+    std::string_view examples,
+    Conversation& conversation,
+    bool follow_up,
+    std::pmr::memory_resource* memory) {
+  static constexpr std::string_view kPromptHeader =
+      "Generate a PostgreSQL query for this request:\n\nRequest: ";
+  static constexpr std::string_view kSchemaHeader = "Schema info:\n";
+
+  // Taken before this request's tables are added: those that are new to
+  // the conversation are described in full below
+  std::string conversation_context =
+      follow_up ? conversation.formatContext() : std::string();
+
+  std::pmr::string schema_context(memory);
   try {
-    auto schema = getDatabaseTables();
     if (schema.success) {
-      schema_context = formatSchemaForAI(schema);
+      // A follow-up already has its tables in the conversation context
+      if (!follow_up) {
+        schema_context = formatSchemaForAI(schema, memory);
+      }
 
-      std::vector<std::string> mentioned_tables;
-      for (const auto& table : schema.tables) {
-        if (request.natural_language.find(table.table_name) !=
-            std::string::npos) {
-          mentioned_tables.push_back(table.table_name);
+      size_t described = std::min<size_t>(mentioned.size(), 3);
+      for (size_t i = 0; i < described; ++i) {
+        std::string schema_name(mentioned[i]->schema_name);
+        if (follow_up &&
+            conversation.hasTable(schema_name, mentioned[i]->table_name)) {
+          continue;
+        }
+        auto table_details =
+            loadTableDetails(*mentioned[i], schema_name, memory);
+        if (table_details.success) {
+          schema_context += '\n';
+          schema_context += formatTableDetailsForAI(table_details, memory);
+          conversation.addTable(table_details);
         }
       }
 
-      for (size_t i = 0; i < mentioned_tables.size() && i < 3; ++i) {
-        auto table_details = getTableDetails(mentioned_tables[i]);
-        if (table_details.success) {
-          schema_context += "\n" + formatTableDetailsForAI(table_details);
+      // Tables the described ones join through, with only their join keys;
+      // bridges must be visible to the role like the table list
+      if (described > 1) {
+        std::vector<uint32_t> relids;
+        std::unordered_set<uint32_t> visible;
+        for (size_t i = 0; i < described; ++i) {
+          relids.push_back(mentioned[i]->relid);
+        }
+        for (const auto& table : schema.tables) {
+          visible.insert(table.relid);
+        }
+        auto graph = loadJoinGraph();
+        for (const auto& bridge : graph.connect(relids, [&](uint32_t relid) {
+               return visible.count(relid) != 0;
+             })) {
+          schema_context += '\n';
+          schema_context += JoinGraph::formatBridge(bridge);
         }
       }
     }
@@ -214,11 +1200,34 @@ std::string QueryGenerator::buildPrompt(const QueryRequest& request) {
                             std::string(e.what()));
   }
 
+  // Size the prompt once; it is moved (never copied) into the provider
+  // request from here on.
+  std::string prompt;
+  prompt.reserve(kPromptHeader.size() + request.natural_language.size() +
+                 kSchemaHeader.size() + schema_context.size() +
+                 examples.size() + conversation_context.size() + 4);
+
+  prompt += kPromptHeader;
+  prompt += request.natural_language;
+  prompt += '\n';
+
   if (!schema_context.empty()) {
-    prompt << "Schema info:\n" << schema_context << "\n";
+    prompt += kSchemaHeader;
+    prompt += schema_context;
+    prompt += '\n';
+  }
+
+  if (!examples.empty()) {
+    prompt += '\n';
+    prompt += examples;
   }
 
-  return prompt.str();
+  if (!conversation_context.empty()) {
+    prompt += '\n';
+    prompt += conversation_context;
+  }
+
+  return prompt;
 }
 
 // Parsing logic has been moved to QueryParser class for testability
@@ -236,91 +1245,37 @@ void QueryGenerator::logModelSettings(const std::string& model_name,
   logger::Logger::info(log_msg);
 }
 
-DatabaseSchema QueryGenerator::getDatabaseTables() {
-  DatabaseSchema result;
-  result.success = false;
-
-  try {
-    if (SPI_connect() != SPI_OK_CONNECT) {
-      result.error_message = "Failed to connect to SPI";
-      return result;
-    }
-
-    const char* query = R"(
-            SELECT
-                t.table_name,
-                t.table_schema,
-                t.table_type,
-                COALESCE(pg_stat.n_tup_ins + pg_stat.n_tup_upd + pg_stat.n_tup_del, 0) as estimated_rows
-            FROM information_schema.tables t
-            LEFT JOIN pg_stat_user_tables pg_stat ON t.table_name = pg_stat.relname
-                AND t.table_schema = pg_stat.schemaname
-            WHERE t.table_schema NOT IN ('information_schema', 'pg_catalog')
-                AND t.table_type = 'BASE TABLE'
-            ORDER BY t.table_schema, t.table_name
-        )";
-
-    int ret = SPI_execute(query, true, 0);
-
-    if (ret != SPI_OK_SELECT) {
-      result.error_message = "Failed to execute query";
-      SPI_finish();
-      return result;
-    }
-
-    SPITupleTable* tuptable = SPI_tuptable;
-    TupleDesc tupdesc = tuptable->tupdesc;
-
-    for (uint64 i = 0; i < SPI_processed; i++) {
-      HeapTuple tuple = tuptable->vals[i];
-      TableInfo table_info;
-
-      char* table_name = SPI_getvalue(tuple, tupdesc, 1);
-      char* schema_name = SPI_getvalue(tuple, tupdesc, 2);
-      char* table_type = SPI_getvalue(tuple, tupdesc, 3);
-      char* estimated_rows_str = SPI_getvalue(tuple, tupdesc, 4);
-
-      if (table_name)
-        table_info.table_name = std::string(table_name);
-      if (schema_name)
-        table_info.schema_name = std::string(schema_name);
-      if (table_type)
-        table_info.table_type = std::string(table_type);
-      if (estimated_rows_str) {
-        table_info.estimated_rows = atoll(estimated_rows_str);
-      } else {
-        table_info.estimated_rows = 0;
-      }
-
-      result.tables.push_back(table_info);
+DatabaseSchema QueryGenerator::getDatabaseTables(
+    std::pmr::memory_resource* memory) {
+  return readTables("", memory);
+}
 
-      if (table_name)
-        pfree(table_name);
-      if (schema_name)
-        pfree(schema_name);
-      if (table_type)
-        pfree(table_type);
-      if (estimated_rows_str)
-        pfree(estimated_rows_str);
+DatabaseSchema QueryGenerator::getDatabaseTables(
+    const std::vector<uint32_t>& relids,
+    std::pmr::memory_resource* memory) {
+  // OIDs are plain integers, safe to inline as an array literal
+  std::pmr::string filter("AND c.oid = ANY('{", memory);
+  for (size_t i = 0; i < relids.size(); ++i) {
+    if (i > 0) {
+      filter += ',';
     }
-
-    result.success = true;
-    SPI_finish();
-
-  } catch (const std::exception& e) {
-    result.error_message = std::string("Exception: ") + e.what();
-    SPI_finish();
+    appendInt(filter, relids[i]);
   }
-
-  return result;
+  filter += "}'::oid[])";
+  return readTables(filter, memory);
 }
 
-TableDetails QueryGenerator::getTableDetails(const std::string& table_name,
-                                             const std::string& schema_name) {
-  TableDetails result;
-  result.success = false;
-  result.table_name = table_name;
-  result.schema_name = schema_name;
+TableDetails QueryGenerator::getTableDetails(
+    const std::string& table_name,
+    const std::string& schema_name,
+    std::pmr::memory_resource* memory) {
+  TableDetails result{.table_name = std::pmr::string(table_name, memory),
+                      .schema_name = std::pmr::string(schema_name, memory),
+                      .columns = std::pmr::vector<ColumnInfo>(memory),
+                      .indexes = std::pmr::vector<std::pmr::string>(memory),
+                      .success = false,
+                      .error_message = "",
+                      .description = std::pmr::string(memory)};
 
   try {
     if (SPI_connect() != SPI_OK_CONNECT) {
@@ -328,17 +1283,32 @@ TableDetails QueryGenerator::getTableDetails(const std::string& table_name,
       return result;
     }
 
-    std::string column_query = R"(
+    // Names are passed as parameters, never spliced into the SQL
+    Oid arg_types[] = {TEXTOID, TEXTOID};
+    Datum args[] = {CStringGetTextDatum(table_name.c_str()),
+                    CStringGetTextDatum(schema_name.c_str())};
+
+    const char* column_query = R"(
             SELECT
-                c.column_name,
-                c.data_type,
-                c.is_nullable,
-                c.column_default,
+                c.column_name::name,
+                c.data_type::text,
+                (c.is_nullable = 'YES') as is_nullable,
+                c.column_default::text,
                 CASE WHEN pk.column_name IS NOT NULL THEN true ELSE false END as is_primary_key,
                 CASE WHEN fk.column_name IS NOT NULL THEN true ELSE false END as is_foreign_key,
-                fk.foreign_table_name,
-                fk.foreign_column_name
+                fk.foreign_table_name::name,
+                fk.foreign_column_name::name,
+                COALESCE(cd.description, '') as column_description
             FROM information_schema.columns c
+            JOIN pg_catalog.pg_namespace n ON n.nspname = c.table_schema
+            JOIN pg_catalog.pg_class r
+                ON r.relnamespace = n.oid AND r.relname = c.table_name
+            JOIN pg_catalog.pg_attribute a
+                ON a.attrelid = r.oid AND a.attname = c.column_name
+            LEFT JOIN pg_catalog.pg_description cd
+                ON cd.classoid = 'pg_catalog.pg_class'::regclass
+                AND cd.objoid = r.oid
+                AND cd.objsubid = a.attnum
             LEFT JOIN (
                 SELECT kcu.column_name, kcu.table_name, kcu.table_schema
                 FROM information_schema.table_constraints tc
@@ -367,14 +1337,15 @@ TableDetails QueryGenerator::getTableDetails(const std::string& table_name,
             ) fk ON c.column_name = fk.column_name
                 AND c.table_name = fk.table_name
                 AND c.table_schema = fk.table_schema
-            WHERE c.table_name = ')" +
-                               table_name + R"('
-                AND c.table_schema = ')" +
-                               schema_name + R"('
+            WHERE c.table_name = $1
+                AND c.table_schema = $2
+                AND pg_catalog.has_column_privilege(r.oid, a.attnum, 'SELECT')
             ORDER BY c.ordinal_position
         )";
 
-    int ret = SPI_execute(column_query.c_str(), true, 0);
+    // Not read-only, for the same reason as getDatabaseTables()
+    int ret = SPI_execute_with_args(column_query, 2, arg_types, args,
+                                    nullptr, false, 0);
 
     if (ret != SPI_OK_SELECT) {
       result.error_message = "Failed to execute column query";
@@ -384,86 +1355,60 @@ TableDetails QueryGenerator::getTableDetails(const std::string& table_name,
 
     SPITupleTable* tuptable = SPI_tuptable;
     TupleDesc tupdesc = tuptable->tupdesc;
+    result.columns.reserve(SPI_processed);
 
     for (uint64 i = 0; i < SPI_processed; i++) {
-      HeapTuple tuple = tuptable->vals[i];
-      ColumnInfo column_info;
-
-      char* column_name = SPI_getvalue(tuple, tupdesc, 1);
-      char* data_type = SPI_getvalue(tuple, tupdesc, 2);
-      char* is_nullable = SPI_getvalue(tuple, tupdesc, 3);
-      char* column_default = SPI_getvalue(tuple, tupdesc, 4);
-      char* is_primary_key = SPI_getvalue(tuple, tupdesc, 5);
-      char* is_foreign_key = SPI_getvalue(tuple, tupdesc, 6);
-      char* foreign_table = SPI_getvalue(tuple, tupdesc, 7);
-      char* foreign_column = SPI_getvalue(tuple, tupdesc, 8);
-
-      if (column_name)
-        column_info.column_name = std::string(column_name);
-      if (data_type)
-        column_info.data_type = std::string(data_type);
-      if (is_nullable)
-        column_info.is_nullable = (std::string(is_nullable) == "YES");
-      if (column_default)
-        column_info.column_default = std::string(column_default);
-      if (is_primary_key)
-        column_info.is_primary_key = (std::string(is_primary_key) == "t");
-      if (is_foreign_key)
-        column_info.is_foreign_key = (std::string(is_foreign_key) == "t");
-      if (foreign_table)
-        column_info.foreign_table = std::string(foreign_table);
-      if (foreign_column)
-        column_info.foreign_column = std::string(foreign_column);
-
-      result.columns.push_back(column_info);
-
-      if (column_name)
-        pfree(column_name);
-      if (data_type)
-        pfree(data_type);
-      if (is_nullable)
-        pfree(is_nullable);
-      if (column_default)
-        pfree(column_default);
-      if (is_primary_key)
-        pfree(is_primary_key);
-      if (is_foreign_key)
-        pfree(is_foreign_key);
-      if (foreign_table)
-        pfree(foreign_table);
-      if (foreign_column)
-        pfree(foreign_column);
-    }
-
-    std::string index_query = R"(
-            SELECT indexname, indexdef
+      SPIRow row(tuptable->vals[i], tupdesc);
+      result.columns.push_back(ColumnInfo{
+          .column_name = std::pmr::string(row.getName(1), memory),
+          .data_type = std::pmr::string(row.getText(2), memory),
+          .is_nullable = row.getBool(3),
+          .column_default = std::pmr::string(row.getText(4), memory),
+          .is_primary_key = row.getBool(5),
+          .is_foreign_key = row.getBool(6),
+          .foreign_table = std::pmr::string(row.getName(7), memory),
+          .foreign_column = std::pmr::string(row.getName(8), memory),
+          .description = std::pmr::string(row.getText(9), memory)});
+    }
+
+    // Read on its own, so it is kept when no column is visible
+    const char* description_query = R"(
+            SELECT pg_catalog.obj_description(r.oid, 'pg_class')
+            FROM pg_catalog.pg_class r
+            JOIN pg_catalog.pg_namespace n ON n.oid = r.relnamespace
+            WHERE r.relname = $1
+                AND n.nspname = $2
+        )";
+
+    ret = SPI_execute_with_args(description_query, 2, arg_types, args,
+                                nullptr, false, 0);
+
+    if (ret == SPI_OK_SELECT && SPI_processed > 0) {
+      SPIRow row(SPI_tuptable->vals[0], SPI_tuptable->tupdesc);
+      result.description = std::pmr::string(row.getText(1), memory);
+    }
+
+    const char* index_query = R"(
+            SELECT indexdef
             FROM pg_indexes
-            WHERE tablename = ')" +
-                              table_name + R"('
-                AND schemaname = ')" +
-                              schema_name + R"('
+            WHERE tablename = $1
+                AND schemaname = $2
             ORDER BY indexname
         )";
 
-    ret = SPI_execute(index_query.c_str(), true, 0);
+    ret = SPI_execute_with_args(index_query, 2, arg_types, args, nullptr,
+                                false, 0);
 
     if (ret == SPI_OK_SELECT) {
       tuptable = SPI_tuptable;
       tupdesc = tuptable->tupdesc;
+      result.indexes.reserve(SPI_processed);
 
       for (uint64 i = 0; i < SPI_processed; i++) {
-        HeapTuple tuple = tuptable->vals[i];
-        char* indexname = SPI_getvalue(tuple, tupdesc, 1);
-        char* indexdef = SPI_getvalue(tuple, tupdesc, 2);
-
-        if (indexdef) {
-          result.indexes.push_back(std::string(indexdef));
+        SPIRow row(tuptable->vals[i], tupdesc);
+        if (!row.isNull(1)) {
+          result.indexes.emplace_back(row.getText(1));
         }
-
-        if (indexname)
-          pfree(indexname);
-        if (indexdef)
-          pfree(indexdef);
       }
     }
 
@@ -478,59 +1423,152 @@ TableDetails QueryGenerator::getTableDetails(const std::string& table_name,
   return result;
 }
 
-std::string QueryGenerator::formatSchemaForAI(const DatabaseSchema& schema) {
-  std::ostringstream result;
-  result << "=== DATABASE SCHEMA ===\n";
-  result
-      << "IMPORTANT: These are the ONLY tables available in this database:\n\n";
+std::pmr::string QueryGenerator::formatSchemaForAI(
+    const DatabaseSchema& schema,
+    std::pmr::memory_resource* memory) {
+  std::pmr::string result(memory);
+  result += "=== DATABASE SCHEMA ===\n";
+  result +=
+      "IMPORTANT: These are the ONLY tables available in this database:\n\n";
 
   for (const auto& table : schema.tables) {
-    result << "- " << table.schema_name << "." << table.table_name << " ("
-           << table.table_type << ", ~" << table.estimated_rows << " rows)\n";
+    result += "- ";
+    result += table.schema_name;
+    result += '.';
+    result += table.table_name;
+    result += " (";
+    result += table.table_type;
+    result += ", ~";
+    appendInt(result, table.estimated_rows);
+    result += " rows";
+    if (table.row_security) {
+      result += ", row-level security: only some rows visible";
+    }
+    result += ')';
+    if (!table.description.empty()) {
+      result += " -- ";
+      result += utils::oneLine(table.description, kListedCommentLength);
+    }
+    result += '\n';
   }
 
   if (schema.tables.empty()) {
-    result << "- No user tables found in database\n";
+    result += "- No user tables found in database\n";
   }
 
-  result << "\nCRITICAL: If user asks for tables not listed above, return an "
-            "error with available table names.\n";
-  result << "Do NOT query information_schema or pg_catalog tables.\n";
-  return result.str();
+  result +=
+      "\nCRITICAL: If user asks for tables not listed above, return an "
+      "error with available table names.\n";
+  result += "Do NOT query information_schema or pg_catalog tables.\n";
+  return result;
 }
 
-std::string QueryGenerator::formatTableDetailsForAI(
-    const TableDetails& details) {
-  std::ostringstream result;
-  result << "=== TABLE: " << details.schema_name << "." << details.table_name
-         << " ===\n\n";
+std::pmr::string QueryGenerator::formatTableDetailsForAI(
+    const TableDetails& details,
+    std::pmr::memory_resource* memory) {
+  std::pmr::string result(memory);
+  result += "=== TABLE: ";
+  result += details.schema_name;
+  result += '.';
+  result += details.table_name;
+  result += " ===\n\n";
+
+  if (!details.description.empty()) {
+    result += "DESCRIPTION: ";
+    result += utils::oneLine(details.description, kCommentLength);
+    result += "\n\n";
+  }
 
-  result << "COLUMNS:\n";
+  result += "COLUMNS:\n";
   for (const auto& col : details.columns) {
-    result << "- " << col.column_name << " (" << col.data_type << ")";
+    result += "- ";
+    result += col.column_name;
+    result += " (";
+    result += col.data_type;
+    result += ')';
 
     if (col.is_primary_key)
-      result << " [PRIMARY KEY]";
+      result += " [PRIMARY KEY]";
     if (col.is_foreign_key) {
-      result << " [FK -> " << col.foreign_table << "." << col.foreign_column
-             << "]";
+      result += " [FK -> ";
+      result += col.foreign_table;
+      result += '.';
+      result += col.foreign_column;
+      result += ']';
     }
     if (!col.is_nullable)
-      result << " [NOT NULL]";
+      result += " [NOT NULL]";
     if (!col.column_default.empty()) {
-      result << " [DEFAULT: " << col.column_default << "]";
+      result += " [DEFAULT: ";
+      result += col.column_default;
+      result += ']';
     }
-    result << "\n";
+    if (!col.description.empty()) {
+      result += " -- ";
+      result += utils::oneLine(col.description, kCommentLength);
+    }
+    result += '\n';
   }
 
   if (!details.indexes.empty()) {
-    result << "\nINDEXES:\n";
+    result += "\nINDEXES:\n";
     for (const auto& idx : details.indexes) {
-      result << "- " << idx << "\n";
+      result += "- ";
+      result += idx;
+      result += '\n';
     }
   }
 
-  return result.str();
+  return result;
+}
+
+std::vector<SchemaMatch> QueryGenerator::searchSchema(std::string_view query,
+                                                      size_t k) {
+  auto* memory = std::pmr::get_default_resource();
+  auto schema = loadDatabaseTables(memory);
+  if (!schema.success) {
+    throw std::runtime_error(schema.error_message);
+  }
+
+  // Index, and the schema version, snapshot version, role and role
+  // memberships it was built for; only reused while the schema cache is
+  static std::optional<SchemaIndex> index;
+  static std::tuple<uint64_t, uint64_t, Oid, uint64_t> indexed_for;
+
+  SchemaCache* cache = syncSchemaCache();
+  const SchemaSnapshot* snapshot = digest_worker::snapshot();
+  std::tuple<uint64_t, uint64_t, Oid, uint64_t> key{
+      cache != nullptr ? cache->version().value_or(0) : 0,
+      snapshot != nullptr ? snapshot->version() : 0, GetUserId(),
+      schema_version::roleGeneration()};
+  if (cache == nullptr || !index || indexed_for != key) {
+    std::vector<TableDetails> details;
+    std::vector<uint32_t> unread;
+    for (const auto& table : schema.tables) {
+      const TableDetails* cached =
+          cache != nullptr
+              ? cache->details(table.schema_name, table.table_name)
+              : nullptr;
+      if (cached != nullptr) {
+        details.push_back(*cached);
+      } else if (auto mapped =
+                     digest_worker::snapshotDetails(table.relid, memory)) {
+        details.push_back(std::move(*mapped));
+      } else if (table.relid != 0) {
+        unread.push_back(table.relid);
+      }
+    }
+    // A cold cache costs one catalog read for all remaining columns, not
+    // one per table
+    if (!unread.empty()) {
+      auto read = readColumns(schema, unread, memory);
+      details.insert(details.end(), std::make_move_iterator(read.begin()),
+                     std::make_move_iterator(read.end()));
+    }
+    index.emplace(schema, details, loadGlossary());
+    indexed_for = key;
+  }
+  return index->search(query, k);
 }
 
 ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
@@ -550,9 +1588,12 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
       return result;
     }
 
-    std::string explain_query =
-        "EXPLAIN (ANALYZE, VERBOSE, COSTS, SETTINGS, BUFFERS, FORMAT JSON) " +
-        request.query_text;
+    static constexpr std::string_view kExplainPrefix =
+        "EXPLAIN (ANALYZE, VERBOSE, COSTS, SETTINGS, BUFFERS, FORMAT JSON) ";
+    std::string explain_query;
+    explain_query.reserve(kExplainPrefix.size() + request.query_text.size());
+    explain_query += kExplainPrefix;
+    explain_query += request.query_text;
 
     int ret = SPI_execute(explain_query.c_str(), false, 0);
 
@@ -597,16 +1638,24 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
       return result;
     }
 
-    std::string prompt =
-        "Please analyze this PostgreSQL EXPLAIN ANALYZE output:\n\nQuery:\n" +
-        request.query_text + "\n\nEXPLAIN Output:\n" + result.explain_output;
+    static constexpr std::string_view kExplainPromptHeader =
+        "Please analyze this PostgreSQL EXPLAIN ANALYZE output:\n\nQuery:\n";
+    static constexpr std::string_view kExplainOutputHeader =
+        "\n\nEXPLAIN Output:\n";
+    std::string prompt;
+    prompt.reserve(kExplainPromptHeader.size() + request.query_text.size() +
+                   kExplainOutputHeader.size() + result.explain_output.size());
+    prompt += kExplainPromptHeader;
+    prompt += request.query_text;
+    prompt += kExplainOutputHeader;
+    prompt += result.explain_output;
 
     // Handle Gemini separately as it uses a different client
     if (selection.provider == config::Provider::GEMINI) {
       std::string model_name =
           (selection.config && !selection.config->default_model.empty())
               ? selection.config->default_model
-              : "gemini-2.5-flash";
+              : config::constants::DEFAULT_GEMINI_MODEL;
       logger::Logger::info("Using Gemini model for explain: " + model_name);
 
       gemini::GeminiClient gemini_client(selection.api_key);
@@ -623,7 +1672,12 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
                   ? std::optional<int>(selection.config->default_max_tokens)
                   : std::nullopt};
 
-      auto gemini_result = gemini_client.generate_text(gemini_request);
+      auto gemini_result = callWithOutputBudget(
+          RequestKind::kExplain, gemini_request.max_tokens,
+          [&](std::optional<int> max_tokens) {
+            gemini_request.max_tokens = max_tokens;
+            return gemini_client.generate_text(gemini_request);
+          });
 
       if (!gemini_result.success) {
         result.error_message =
@@ -636,7 +1690,7 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
         return result;
       }
 
-      result.ai_explanation = gemini_result.text;
+      result.ai_explanation = std::move(gemini_result.text);
       result.success = true;
       return result;
     }
@@ -651,14 +1705,20 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
     }
 
     ai::GenerateOptions options(client_result.model_name,
-                                prompts::getExplainSystemPrompt(), prompt);
+                                prompts::getExplainSystemPrompt(),
+                                std::move(prompt));
 
     if (selection.config) {
       options.max_tokens = selection.config->default_max_tokens;
       options.temperature = selection.config->default_temperature;
     }
 
-    auto ai_result = client_result.client.generate_text(options);
+    auto ai_result = callWithOutputBudget(
+        RequestKind::kExplain, options.max_tokens,
+        [&](std::optional<int> max_tokens) {
+          options.max_tokens = max_tokens;
+          return client_result.client.generate_text(options);
+        });
 
     if (!ai_result) {
       result.error_message =
@@ -671,7 +1731,7 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
       return result;
     }
 
-    result.ai_explanation = ai_result.text;
+    result.ai_explanation = std::move(ai_result.text);
     result.success = true;
     return result;
 
@@ -681,4 +1741,206 @@ ExplainResult QueryGenerator::explainQuery(const ExplainRequest& request) {
   }
 }
 
+ExecuteResult QueryGenerator::executeQuery(const ExecuteRequest& request,
+                                           Tuplestorestate* rows) {
+  ExecuteResult result{.rows = 0,
+                       .truncated = false,
+                       .estimated_cost = 0.0,
+                       .success = false};
+
+  try {
+    std::string_view query = trimStatement(request.query);
+    if (query.empty()) {
+      result.error_message = "Query text cannot be empty";
+      return result;
+    }
+
+    SPIConnection spi_conn;
+    if (!spi_conn) {
+      result.error_message = spi_conn.getErrorMessage();
+      return result;
+    }
+
+    // Only queries that passed the read-only and volatility checks are
+    // saved; they are checked again whenever a saved plan is reused
+    const auto& cfg = config::ConfigManager::getConfig();
+    auto& plans = executedPlans();
+    size_t plan_cache_size =
+        cfg.plan_cache_size > 0 ? static_cast<size_t>(cfg.plan_cache_size) : 0;
+    if (plan_cache_size == 0) {
+      plans.clear();
+    }
+    auto rows_plan = static_cast<SPIPlanPtr>(plans.find(query));
+    bool reused = rows_plan != nullptr;
+
+    if (rows_plan == nullptr) {
+      std::string statement(query);
+      SPIPlanPtr plan = SPI_prepare(statement.c_str(), 0, nullptr);
+      if (plan == nullptr) {
+        result.error_message =
+            "Failed to prepare query: " +
+            std::string(SPI_result_code_string(SPI_result));
+        return result;
+      }
+      if (const char* rejection = rejectionOf(plan)) {
+        result.error_message = rejection;
+        return result;
+      }
+
+      // One jsonb per row keeps column names and types without a column
+      // definition list at the call site
+      static constexpr std::string_view kRowsPrefix =
+          "SELECT to_jsonb(ai_query_row) FROM (\n";
+      static constexpr std::string_view kRowsSuffix = "\n) AS ai_query_row";
+      std::string rows_query;
+      rows_query.reserve(kRowsPrefix.size() + query.size() +
+                         kRowsSuffix.size());
+      rows_query += kRowsPrefix;
+      rows_query += query;
+      rows_query += kRowsSuffix;
+
+      rows_plan = SPI_prepare(rows_query.c_str(), 0, nullptr);
+      if (rows_plan == nullptr) {
+        result.error_message =
+            "Failed to prepare query: " +
+            std::string(SPI_result_code_string(SPI_result));
+        return result;
+      }
+
+      if (plan_cache_size > 0 && SPI_keepplan(rows_plan) == 0) {
+        plans.insert(std::move(statement), rows_plan, plan_cache_size);
+      }
+    } else {
+      logger::Logger::info("Reusing saved plan for generated query");
+    }
+
+    Portal portal = SPI_cursor_open(nullptr, rows_plan, nullptr, nullptr,
+                                    true);
+
+    // Opening revalidates a saved plan: after DDL, CREATE OR REPLACE VIEW or
+    // FUNCTION, or a search_path change PostgreSQL analyzes the same text
+    // again, so the checks are repeated on the statement it now runs. No
+    // row has been computed yet.
+    if (reused) {
+      if (const char* rejection = rejectionOf(rows_plan)) {
+        SPI_cursor_close(portal);
+        plans.erase(query);
+        result.error_message = rejection;
+        return result;
+      }
+    }
+    result.estimated_cost =
+        linitial_node(PlannedStmt, portal->stmts)->planTree->total_cost;
+    if (request.max_cost > 0 && result.estimated_cost > request.max_cost) {
+      SPI_cursor_close(portal);
+      result.error_message =
+          "Estimated cost " +
+          std::to_string(std::llround(result.estimated_cost)) +
+          " exceeds pg_ai_query.max_query_cost (" +
+          std::to_string(std::llround(request.max_cost)) + ")";
+      return result;
+    }
+
+    // Rows go from each fetched batch straight into the tuplestore; one
+    // row past max_rows tells a capped result from an exact fit
+    while (true) {
+      long batch = kFetchBatch;
+      if (request.max_rows > 0) {
+        batch = static_cast<long>(
+            std::min<int64_t>(batch, request.max_rows - result.rows + 1));
+      }
+      SPI_cursor_fetch(portal, true, batch);
+      uint64 fetched = SPI_processed;
+      for (uint64 i = 0; i < fetched; ++i) {
+        if (request.max_rows > 0 && result.rows == request.max_rows) {
+          result.truncated = true;
+          break;
+        }
+        tuplestore_puttuple(rows, SPI_tuptable->vals[i]);
+        ++result.rows;
+      }
+      SPI_freetuptable(SPI_tuptable);
+      if (result.truncated || fetched < static_cast<uint64>(batch)) {
+        break;
+      }
+    }
+    SPI_cursor_close(portal);
+
+    result.success = true;
+  } catch (const std::exception& e) {
+    result.error_message = std::string("Exception: ") + e.what();
+  }
+
+  return result;
+}
+
+AcceptResult QueryGenerator::acceptQuery(std::string_view natural_language,
+                                         std::string_view query) {
+  AcceptResult result{.id = 0, .success = false};
+
+  try {
+    if (natural_language.empty() || query.empty()) {
+      result.error_message = "Request and query cannot be empty";
+      return result;
+    }
+
+    std::string table = historyTable();
+    if (table.empty()) {
+      result.error_message = "pg_ai_query extension is not installed";
+      return result;
+    }
+
+    std::string schema_version = historyKey();
+    if (schema_version.empty()) {
+      result.error_message = "Failed to read database schema";
+      return result;
+    }
+
+    SPIConnection spi_conn;
+    if (!spi_conn) {
+      result.error_message = spi_conn.getErrorMessage();
+      return result;
+    }
+
+    // The relations it reads decide which roles see it as an example
+    std::string statement(trimStatement(query));
+    SPIPlanPtr plan = SPI_prepare(statement.c_str(), 0, nullptr);
+    if (plan == nullptr) {
+      result.error_message =
+          "Failed to prepare query: " +
+          std::string(SPI_result_code_string(SPI_result));
+      return result;
+    }
+    std::string relids = referencedRelations(plan);
+    SPI_freeplan(plan);
+
+    std::string insert =
+        "INSERT INTO " + table +
+        " (schema_version, natural_language_query, query, relids)"
+        " VALUES ($1, $2, $3, $4::pg_catalog.oid[]) RETURNING id";
+    auto toText = [](std::string_view value) {
+      return PointerGetDatum(cstring_to_text_with_len(
+          value.data(), static_cast<int>(value.size())));
+    };
+    Oid arg_types[] = {TEXTOID, TEXTOID, TEXTOID, TEXTOID};
+    Datum args[] = {toText(schema_version), toText(natural_language),
+                    toText(query), toText(relids)};
+    int ret = SPI_execute_with_args(insert.c_str(), 4, arg_types, args,
+                                    nullptr, false, 1);
+    if (ret != SPI_OK_INSERT_RETURNING || SPI_processed != 1) {
+      result.error_message = "Failed to record accepted query: " +
+                             std::string(SPI_result_code_string(ret));
+      return result;
+    }
+
+    result.id =
+        SPIRow(SPI_tuptable->vals[0], SPI_tuptable->tupdesc).getInt64(1);
+    result.success = true;
+  } catch (const std::exception& e) {
+    result.error_message = std::string("Exception: ") + e.what();
+  }
+
+  return result;
+}
+
 }  // namespace pg_ai
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "../include/query_history.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+namespace pg_ai {
+
+namespace {
+
+// Letters, digits and any non-ASCII byte, so UTF-8 letters stay in words
+bool isWordByte(unsigned char c) {
+  return std::isalnum(c) || c >= 0x80;
+}
+
+uint32_t packTrigram(unsigned char a, unsigned char b, unsigned char c) {
+  return (uint32_t{a} << 16) | (uint32_t{b} << 8) | uint32_t{c};
+}
+
+}  // namespace
+
+TrigramSet::TrigramSet(std::string_view text) {
+  std::string padded;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    while (pos < text.size() &&
+           !isWordByte(static_cast<unsigned char>(text[pos]))) {
+      ++pos;
+    }
+    size_t end = pos;
+    while (end < text.size() &&
+           isWordByte(static_cast<unsigned char>(text[end]))) {
+      ++end;
+    }
+    if (end == pos) {
+      break;
+    }
+
+    padded.assign("  ");
+    for (size_t i = pos; i < end; ++i) {
+      padded += static_cast<char>(
+          std::tolower(static_cast<unsigned char>(text[i])));
+    }
+    padded += ' ';
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+      trigrams_.push_back(packTrigram(padded[i], padded[i + 1],
+                                      padded[i + 2]));
+    }
+    pos = end;
+  }
+
+  std::sort(trigrams_.begin(), trigrams_.end());
+  trigrams_.erase(std::unique(trigrams_.begin(), trigrams_.end()),
+                  trigrams_.end());
+}
+
+double TrigramSet::similarity(const TrigramSet& other) const {
+  if (trigrams_.empty() || other.trigrams_.empty()) {
+    return 0.0;
+  }
+
+  size_t shared = 0;
+  auto a = trigrams_.begin();
+  auto b = other.trigrams_.begin();
+  while (a != trigrams_.end() && b != other.trigrams_.end()) {
+    if (*a < *b) {
+      ++a;
+    } else if (*b < *a) {
+      ++b;
+    } else {
+      ++shared;
+      ++a;
+      ++b;
+    }
+  }
+  return static_cast<double>(shared) /
+         static_cast<double>(trigrams_.size() + other.trigrams_.size() -
+                             shared);
+}
+
+std::vector<HistoryExample> QueryHistory::nearest(
+    std::string_view natural_language,
+    std::vector<HistoryExample> candidates,
+    size_t k,
+    double min_similarity) {
+  TrigramSet request(natural_language);
+  for (auto& candidate : candidates) {
+    candidate.similarity =
+        request.similarity(TrigramSet(candidate.natural_language));
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const HistoryExample& a, const HistoryExample& b) {
+                     return a.similarity > b.similarity;
+                   });
+
+  std::vector<HistoryExample> examples;
+  std::unordered_set<std::string> seen;
+  for (auto& candidate : candidates) {
+    if (examples.size() >= k || candidate.similarity < min_similarity) {
+      break;
+    }
+    if (seen.insert(candidate.natural_language).second) {
+      examples.push_back(std::move(candidate));
+    }
+  }
+  return examples;
+}
+
+std::string QueryHistory::formatExamples(
+    const std::vector<HistoryExample>& examples) {
+  if (examples.empty()) {
+    return "";
+  }
+
+  std::string result = "Previously accepted queries for similar requests:\n";
+  for (const auto& example : examples) {
+    result += "\nRequest: ";
+    result += example.natural_language;
+    result += "\nSQL: ";
+    result += example.query;
+    result += '\n';
+  }
+  return result;
+}
+
+std::string QueryHistory::schemaVersion(const DatabaseSchema& schema) {
+  if (!schema.success) {
+    return "";
+  }
+
+  // 64-bit FNV-1a over "schema.table\n" for every table
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](std::string_view bytes) {
+    for (unsigned char c : bytes) {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+  };
+  for (const auto& table : schema.tables) {
+    mix(table.schema_name);
+    mix(".");
+    mix(table.table_name);
+    mix("\n");
+  }
+
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string version(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    version[i] = kHex[hash & 0xf];
+    hash >>= 4;
+  }
+  return version;
+}
+
+}  // namespace pg_ai
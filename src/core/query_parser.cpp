@@ -1,44 +1,253 @@
 #include "../include/query_parser.hpp"
 
 #include <algorithm>
-#include <regex>
+#include <cctype>
+#include <optional>
+#include <string_view>
 
+#include "../include/keyword_scanner.hpp"
 #include "../include/logger.hpp"
 #include "../include/query_generator.hpp"
 
 namespace pg_ai {
 
-nlohmann::json QueryParser::extractSQLFromResponse(const std::string& text) {
-  // ------------------------------------------------------------
-  // Attempt to extract JSON embedded in markdown code blocks.
-  //
-  // AI/LLM responses often wrap structured output like JSON
-  // inside markdown fences, e.g.:
-  //
-  // ```json
-  // {
-  //   "sql": "SELECT * FROM users",
-  //   "explanation": "Fetch all users"
-  // }
-  // ```
-  //
-  // Regex explanation:
-  // ```              -> opening markdown fence
-  // (?:json)?        -> optional "json" language identifier
-  // \s*              -> optional whitespace/newlines
-  // (\{[\s\S]*?\})   -> CAPTURE GROUP: JSON object {...}
-  // \s*
-  // ```              -> closing markdown fence
-  //
-  // This allows us to safely extract the raw JSON for parsing.
-  // ------------------------------------------------------------
-  std::regex json_block(R"(```(?:json)?\s*(\{[\s\S]*?\})\s*```)",
-                        std::regex::icase);
-  std::smatch match;
+namespace {
+
+constexpr std::string_view kRawOutputExplanation =
+    "Raw LLM output (no JSON detected)";
+
+bool isSpace(char c) {
+  return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+// ------------------------------------------------------------
+// Locate JSON embedded in a markdown code block.
+//
+// AI/LLM responses often wrap structured output like JSON
+// inside markdown fences, e.g.:
+//
+// ```json
+// {
+//   "sql": "SELECT * FROM users",
+//   "explanation": "Fetch all users"
+// }
+// ```
+//
+// Matches what the regex
+//   ```(?:json)?\s*(\{[\s\S]*?\})\s*```      (json case-insensitive)
+// would capture: an opening fence, an optional "json" language
+// identifier, whitespace, then the shortest {...} followed by
+// optional whitespace and a closing fence. Scanning by hand
+// returns a view into the response instead of a copy, and avoids
+// std::regex's recursion on very long responses.
+// ------------------------------------------------------------
+std::optional<std::string_view> findMarkdownJsonBlock(std::string_view text) {
+  constexpr std::string_view kFence = "```";
+  constexpr std::string_view kJson = "json";
+
+  for (size_t fence = text.find(kFence); fence != std::string_view::npos;
+       fence = text.find(kFence, fence + 1)) {
+    size_t open = fence + kFence.size();
+    if (text.size() - open >= kJson.size() &&
+        std::equal(kJson.begin(), kJson.end(), text.begin() + open,
+                   [](char a, char b) {
+                     return a == std::tolower(static_cast<unsigned char>(b));
+                   })) {
+      open += kJson.size();
+    }
+    while (open < text.size() && isSpace(text[open])) {
+      ++open;
+    }
+    if (open >= text.size() || text[open] != '{') {
+      continue;
+    }
+
+    // The first closing fence preceded by '}' and optional whitespace
+    // ends the shortest match. Later opening fences only see a subset of
+    // these closing fences, so there is nothing left to try on failure.
+    for (size_t close = text.find(kFence, open + 1);
+         close != std::string_view::npos;
+         close = text.find(kFence, close + 1)) {
+      size_t end = close;
+      while (end > open + 1 && isSpace(text[end - 1])) {
+        --end;
+      }
+      if (end > open + 1 && text[end - 1] == '}') {
+        return text.substr(open, end - open);
+      }
+    }
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+// Fields of a structured query response
+struct ResponseFields {
+  std::string sql;
+  std::string explanation;
+  std::vector<std::string> warnings;
+  bool row_limit_applied = false;
+  std::optional<std::string> suggested_visualization;
+};
+
+// ------------------------------------------------------------
+// SAX handler extracting the top-level response fields.
+//
+// Strings are moved out of the lexer buffer straight into
+// ResponseFields; nested values and unknown keys are skipped
+// without building a JSON DOM. Fields with an unexpected type
+// are treated as absent, and a repeated key overrides the
+// earlier value.
+// ------------------------------------------------------------
+class ResponseFieldsHandler : public nlohmann::json_sax<nlohmann::json> {
+ public:
+  explicit ResponseFieldsHandler(ResponseFields& fields) : fields_(fields) {}
+
+  bool isObject() const { return root_is_object_; }
+  const std::string& error() const { return error_; }
+
+  bool null() override { return true; }
+
+  bool boolean(bool val) override {
+    if (depth_ == 1 && field_ == Field::kRowLimitApplied) {
+      fields_.row_limit_applied = val;
+    }
+    return true;
+  }
+
+  bool number_integer(number_integer_t) override { return true; }
+  bool number_unsigned(number_unsigned_t) override { return true; }
+  bool number_float(number_float_t, const string_t&) override { return true; }
+  bool binary(binary_t&) override { return true; }
+
+  bool string(string_t& val) override {
+    if (depth_ == 2 && in_warnings_) {
+      fields_.warnings.push_back(std::move(val));
+      return true;
+    }
+    if (depth_ != 1) {
+      return true;
+    }
+    switch (field_) {
+      case Field::kSql:
+        fields_.sql = std::move(val);
+        break;
+      case Field::kExplanation:
+        fields_.explanation = std::move(val);
+        break;
+      case Field::kWarnings:
+        fields_.warnings.push_back(std::move(val));
+        break;
+      case Field::kSuggestedVisualization:
+        fields_.suggested_visualization = std::move(val);
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+
+  bool start_object(std::size_t) override {
+    if (depth_ == 0) {
+      root_is_object_ = true;
+    }
+    ++depth_;
+    return true;
+  }
 
-  if (std::regex_search(text, match, json_block)) {
+  bool key(string_t& val) override {
+    if (depth_ != 1) {
+      return true;
+    }
+    field_ = Field::kOther;
+    if (val == "sql") {
+      field_ = Field::kSql;
+      fields_.sql.clear();
+    } else if (val == "explanation") {
+      field_ = Field::kExplanation;
+      fields_.explanation.clear();
+    } else if (val == "warnings") {
+      field_ = Field::kWarnings;
+      fields_.warnings.clear();
+    } else if (val == "row_limit_applied") {
+      field_ = Field::kRowLimitApplied;
+      fields_.row_limit_applied = false;
+    } else if (val == "suggested_visualization") {
+      field_ = Field::kSuggestedVisualization;
+      fields_.suggested_visualization.reset();
+    }
+    return true;
+  }
+
+  bool end_object() override {
+    --depth_;
+    return true;
+  }
+
+  bool start_array(std::size_t) override {
+    // Supported warnings formats:
+    // 1. Array:   "warnings": ["msg1", "msg2"]
+    // 2. String:  "warnings": "single warning"
+    if (depth_ == 1 && field_ == Field::kWarnings) {
+      in_warnings_ = true;
+    }
+    ++depth_;
+    return true;
+  }
+
+  bool end_array() override {
+    if (--depth_ == 1) {
+      in_warnings_ = false;
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t,
+                   const std::string&,
+                   const nlohmann::detail::exception& ex) override {
+    error_ = ex.what();
+    return false;
+  }
+
+ private:
+  enum class Field {
+    kOther,
+    kSql,
+    kExplanation,
+    kWarnings,
+    kRowLimitApplied,
+    kSuggestedVisualization
+  };
+
+  ResponseFields& fields_;
+  Field field_ = Field::kOther;
+  int depth_ = 0;
+  bool root_is_object_ = false;
+  bool in_warnings_ = false;
+  std::string error_;
+};
+
+// Parse a JSON object into fields; false if text is not a JSON object
+bool parseResponseFields(std::string_view text,
+                         ResponseFields& fields,
+                         const char* source) {
+  fields = ResponseFields{};
+  ResponseFieldsHandler handler(fields);
+  if (!nlohmann::json::sax_parse(text.data(), text.data() + text.size(),
+                                 &handler)) {
+    logger::Logger::debug(std::string("JSON parse error (") + source +
+                          "): " + handler.error());
+    return false;
+  }
+  return handler.isObject();
+}
+
+}  // namespace
+
+nlohmann::json QueryParser::extractSQLFromResponse(const std::string& text) {
+  if (auto block = findMarkdownJsonBlock(text)) {
     try {
-      return nlohmann::json::parse(match[1].str());
+      return nlohmann::json::parse(block->begin(), block->end());
     } catch (const nlohmann::json::parse_error& e) {
       logger::Logger::debug("JSON parse error in markdown block: " +
                             std::string(e.what()));
@@ -65,7 +274,7 @@ nlohmann::json QueryParser::extractSQLFromResponse(const std::string& text) {
   // This ensures we still return a usable structure even when
   // the AI output is not valid JSON.
   // ------------------------------------------------------------
-  return {{"sql", text}, {"explanation", "Raw LLM output (no JSON detected)"}};
+  return {{"sql", text}, {"explanation", kRawOutputExplanation}};
 }
 
 bool QueryParser::accessesSystemTables(const std::string& sql) {
@@ -81,11 +290,9 @@ bool QueryParser::accessesSystemTables(const std::string& sql) {
   // - INFORMATION_SCHEMA (SQL-standard metadata)
   // - PG_CATALOG (PostgreSQL internal catalog)
   // ------------------------------------------------------------
-  std::string upper_sql = sql;
-  std::transform(upper_sql.begin(), upper_sql.end(), upper_sql.begin(),
-                 ::toupper);
-  return upper_sql.find("INFORMATION_SCHEMA") != std::string::npos ||
-         upper_sql.find("PG_CATALOG") != std::string::npos;
+  static const KeywordScanner kSystemSchemas(
+      {"information_schema", "pg_catalog"});
+  return kSystemSchemas.containsAny(sql);
 }
 
 bool QueryParser::hasErrorIndicators(const std::string& explanation,
@@ -95,27 +302,25 @@ bool QueryParser::hasErrorIndicators(const std::string& explanation,
   // query generation failure.
   //
   // These keywords are based on common LLM failure responses
-  // and database-style error messages.
+  // and database-style error messages. Matching is
+  // case-insensitive and done in one pass over the text.
   // ------------------------------------------------------------
-  std::string lower_explanation = explanation;
-  std::transform(lower_explanation.begin(), lower_explanation.end(),
-                 lower_explanation.begin(), ::tolower);
-
-  bool has_error =
+  static const KeywordScanner kExplanationErrors({
       // Explicit AI failure statements
-      lower_explanation.find("cannot generate query") != std::string::npos ||
-      lower_explanation.find("cannot create query") != std::string::npos ||
-      lower_explanation.find("unable to generate") != std::string::npos ||
+      "cannot generate query",
+      "cannot create query",
+      "unable to generate",
       // Missing schema elements
-      lower_explanation.find("does not exist") != std::string::npos ||
-      lower_explanation.find("do not exist") != std::string::npos ||
+      "does not exist",
+      "do not exist",
       // Database-style error messages
-      lower_explanation.find("table not found") != std::string::npos ||
-      lower_explanation.find("column not found") != std::string::npos ||
-      lower_explanation.find("no such table") != std::string::npos ||
-      lower_explanation.find("no such column") != std::string::npos;
+      "table not found",
+      "column not found",
+      "no such table",
+      "no such column",
+  });
 
-  if (has_error) {
+  if (kExplanationErrors.containsAny(explanation)) {
     return true;
   }
   // ------------------------------------------------------------
@@ -124,13 +329,10 @@ bool QueryParser::hasErrorIndicators(const std::string& explanation,
   // Some LLMs place failure signals inside warnings instead of
   // the main explanation field.
   // ------------------------------------------------------------
+  static const KeywordScanner kWarningErrors(
+      {"error:", "does not exist", "do not exist"});
   for (const auto& warning : warnings) {
-    std::string lower_warning = warning;
-    std::transform(lower_warning.begin(), lower_warning.end(),
-                   lower_warning.begin(), ::tolower);
-    if (lower_warning.find("error:") != std::string::npos ||
-        lower_warning.find("does not exist") != std::string::npos ||
-        lower_warning.find("do not exist") != std::string::npos) {
+    if (kWarningErrors.containsAny(warning)) {
       return true;
     }
   }
@@ -139,59 +341,50 @@ bool QueryParser::hasErrorIndicators(const std::string& explanation,
 }
 
 QueryResult QueryParser::parseQueryResponse(const std::string& response_text) {
-  // Parse SQL, explanation, and metadata from the AI response
-  nlohmann::json j = extractSQLFromResponse(response_text);
-  std::string sql = j.value("sql", "");
-  std::string explanation = j.value("explanation", "");
-
-  std::vector<std::string> warnings_vec;
-  try {
-    // ------------------------------------------------------------
-    // Extract warnings from JSON.
-    //
-    // Supported formats:
-    // 1. Array:   "warnings": ["msg1", "msg2"]
-    // 2. String:  "warnings": "single warning"
-    //
-    // This flexible handling improves robustness against
-    // varying AI output formats.
-    // ------------------------------------------------------------
-    if (j.contains("warnings")) {
-      if (j["warnings"].is_array()) {
-        warnings_vec = j["warnings"].get<std::vector<std::string>>();
-      } else if (j["warnings"].is_string()) {
-        warnings_vec.push_back(j["warnings"].get<std::string>());
-      }
-    }
-  } catch (const std::exception& e) {
-    logger::Logger::warning("Error parsing warnings from JSON: " +
-                            std::string(e.what()));
+  // ------------------------------------------------------------
+  // Stream the response through a SAX parser, moving only the
+  // fields we need into place. Same precedence as
+  // extractSQLFromResponse(): markdown block, then direct JSON,
+  // then the raw text as SQL.
+  // ------------------------------------------------------------
+  ResponseFields fields;
+  auto block = findMarkdownJsonBlock(response_text);
+  bool parsed = block && parseResponseFields(*block, fields, "markdown block");
+  if (!parsed) {
+    parsed = parseResponseFields(response_text, fields, "direct");
+  }
+  if (!parsed) {
+    fields = ResponseFields{};
+    fields.sql = response_text;
+    fields.explanation = kRawOutputExplanation;
   }
 
   // Check for error indicators in explanation/warnings
-  if (hasErrorIndicators(explanation, warnings_vec)) {
+  if (hasErrorIndicators(fields.explanation, fields.warnings)) {
     return QueryResult{.generated_query = "",
-                       .explanation = explanation,
-                       .warnings = warnings_vec,
+                       .explanation = fields.explanation,
+                       .warnings = std::move(fields.warnings),
                        .row_limit_applied = false,
                        .suggested_visualization = "",
                        .success = false,
-                       .error_message = explanation};
+                       .error_message = std::move(fields.explanation),
+                       .source = ""};
   }
 
   // Handle empty SQL (but not an error)
-  if (sql.empty()) {
+  if (fields.sql.empty()) {
     return QueryResult{.generated_query = "",
-                       .explanation = explanation,
-                       .warnings = warnings_vec,
+                       .explanation = std::move(fields.explanation),
+                       .warnings = std::move(fields.warnings),
                        .row_limit_applied = false,
                        .suggested_visualization = "",
                        .success = true,
-                       .error_message = ""};
+                       .error_message = "",
+                       .source = ""};
   }
 
   // Check for system table access
-  if (accessesSystemTables(sql)) {
+  if (accessesSystemTables(fields.sql)) {
     return QueryResult{
         .generated_query = "",
         .explanation = "",
@@ -201,18 +394,21 @@ QueryResult QueryParser::parseQueryResponse(const std::string& response_text) {
         .success = false,
         .error_message =
             "Generated query accesses system tables. Please query user "
-            "tables only."};
+            "tables only.",
+        .source = ""};
   }
 
   // Success case
   return QueryResult{
-      .generated_query = sql,
-      .explanation = explanation,
-      .warnings = warnings_vec,
-      .row_limit_applied = j.value("row_limit_applied", false),
-      .suggested_visualization = j.value("suggested_visualization", "table"),
+      .generated_query = std::move(fields.sql),
+      .explanation = std::move(fields.explanation),
+      .warnings = std::move(fields.warnings),
+      .row_limit_applied = fields.row_limit_applied,
+      .suggested_visualization =
+          std::move(fields.suggested_visualization).value_or("table"),
       .success = true,
-      .error_message = ""};
+      .error_message = "",
+      .source = ""};
 }
 
 }  // namespace pg_ai
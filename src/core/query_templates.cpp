@@ -0,0 +1,506 @@
+#include "../include/query_templates.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <vector>
+
+namespace pg_ai {
+
+namespace {
+
+struct Token {
+  /** As written, for literal values */
+  std::string text;
+  std::string lower;
+  /** Accounted for by the table, the shape or the filler list */
+  bool used = false;
+};
+
+struct ShapeAt {
+  TemplateShape shape = TemplateShape::kNone;
+  /** Index of the token that triggered the shape */
+  size_t at = 0;
+};
+
+// Words that never change the meaning of a single-table request
+constexpr std::array<std::string_view, 42> kFiller = {
+    "a",      "all",    "an",      "are",    "by",      "display",
+    "do",     "does",   "entries", "entry",  "exist",   "fetch",
+    "find",   "for",    "from",    "get",    "give",    "has",
+    "have",   "in",     "is",      "list",   "me",      "of",
+    "our",    "please", "record",  "records", "return", "row",
+    "rows",   "select", "show",    "table",  "that",    "the",
+    "there",  "was",    "we",      "were",   "what",    "which"};
+
+constexpr std::array<std::string_view, 6> kRecentWords = {
+    "added", "created", "during", "new", "since", "within"};
+
+constexpr std::array<std::string_view, 4> kLookupWords = {"=", "is", "where",
+                                                          "with"};
+
+// Timestamp columns used for "recent" requests that do not name one, in
+// order of preference
+constexpr std::array<std::string_view, 6> kRecentColumns = {
+    "created_at", "created_on", "inserted_at",
+    "created",    "timestamp",  "date"};
+
+constexpr std::string_view kTrimChars = "?.!,;:\"'()";
+
+template <size_t N>
+bool isOneOf(std::string_view word,
+             const std::array<std::string_view, N>& words) {
+  return std::find(words.begin(), words.end(), word) != words.end();
+}
+
+std::string toLower(std::string_view text) {
+  std::string lower(text);
+  for (char& c : lower) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return lower;
+}
+
+std::vector<Token> tokenize(std::string_view text) {
+  std::vector<Token> tokens;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t start = text.find_first_not_of(" \t\r\n", pos);
+    if (start == std::string_view::npos) {
+      break;
+    }
+    size_t end = text.find_first_of(" \t\r\n", start);
+    if (end == std::string_view::npos) {
+      end = text.size();
+    }
+    pos = end;
+
+    std::string_view word = text.substr(start, end - start);
+    size_t first = word.find_first_not_of(kTrimChars);
+    if (first == std::string_view::npos) {
+      continue;
+    }
+    word = word.substr(first, word.find_last_not_of(kTrimChars) - first + 1);
+    tokens.push_back(Token{.text = std::string(word), .lower = toLower(word)});
+  }
+  return tokens;
+}
+
+std::optional<int> positiveInt(std::string_view word) {
+  int value = 0;
+  auto [end, ec] = std::from_chars(word.data(), word.data() + word.size(),
+                                   value);
+  if (ec != std::errc() || end != word.data() + word.size() || value <= 0) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+bool isDigits(std::string_view word) {
+  return !word.empty() && word.size() <= 19 &&
+         std::all_of(word.begin(), word.end(),
+                     [](unsigned char c) { return std::isdigit(c); });
+}
+
+// Canonical interval unit for "day", "days", "hours", ...
+std::optional<std::string_view> intervalUnit(std::string_view word) {
+  static constexpr std::array<std::string_view, 6> kUnits = {
+      "minute", "hour", "day", "week", "month", "year"};
+  for (std::string_view unit : kUnits) {
+    if (word == unit || (word.size() == unit.size() + 1 &&
+                         word.substr(0, unit.size()) == unit &&
+                         word.back() == 's')) {
+      return unit;
+    }
+  }
+  return std::nullopt;
+}
+
+ShapeAt findShape(const std::vector<Token>& tokens) {
+  auto word = [&](size_t i) -> std::string_view {
+    return i < tokens.size() ? std::string_view(tokens[i].lower)
+                             : std::string_view();
+  };
+
+  // Most specific shapes first: "how many ... in the last 7 days" is a
+  // recent request with leftover words, not a plain count.
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if ((word(i) == "top" || word(i) == "bottom") && positiveInt(word(i + 1))) {
+      return {TemplateShape::kTopN, i};
+    }
+  }
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if ((word(i) == "last" || word(i) == "past") &&
+        ((positiveInt(word(i + 1)) && intervalUnit(word(i + 2))) ||
+         intervalUnit(word(i + 1)))) {
+      return {TemplateShape::kRecent, i};
+    }
+  }
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if (word(i) == "count" || (word(i) == "how" && word(i + 1) == "many") ||
+        (word(i) == "number" && word(i + 1) == "of")) {
+      return {TemplateShape::kCount, i};
+    }
+  }
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if (word(i) == "id" || (word(i).size() > 1 && word(i)[0] == '#') ||
+        (i + 1 == tokens.size() && isDigits(word(i)))) {
+      return {TemplateShape::kLookup, i};
+    }
+  }
+  return {};
+}
+
+// "user" and "users" both name the users table; so do "category" and
+// "categories"
+bool namesTable(std::string_view word, std::string_view table) {
+  if (word == table) {
+    return true;
+  }
+  if (table.size() == word.size() + 1 && table.back() == 's' &&
+      table.substr(0, word.size()) == word) {
+    return true;
+  }
+  if (table.size() == word.size() + 2 && table.substr(word.size()) == "es" &&
+      table.substr(0, word.size()) == word) {
+    return true;
+  }
+  return table.size() == word.size() + 2 && word.back() == 'y' &&
+         table.substr(table.size() - 3) == "ies" &&
+         table.substr(0, word.size() - 1) == word.substr(0, word.size() - 1);
+}
+
+bool isIntegerType(std::string_view type) {
+  return type == "smallint" || type == "integer" || type == "bigint";
+}
+
+bool isNumericType(std::string_view type) {
+  return isIntegerType(type) || type == "numeric" || type == "real" ||
+         type == "double precision" || type == "money";
+}
+
+bool isTemporalType(std::string_view type) {
+  return type == "date" || type.substr(0, 9) == "timestamp";
+}
+
+bool isTextType(std::string_view type) {
+  return type == "text" || type == "character varying" ||
+         type == "character" || type == "uuid";
+}
+
+std::string quoteIdent(std::string_view ident) {
+  std::string quoted = "\"";
+  for (char c : ident) {
+    quoted += c;
+    if (c == '"') {
+      quoted += '"';
+    }
+  }
+  quoted += '"';
+  return quoted;
+}
+
+std::string quoteLiteral(std::string_view value) {
+  std::string quoted = "'";
+  for (char c : value) {
+    quoted += c;
+    if (c == '\'') {
+      quoted += '\'';
+    }
+  }
+  quoted += '\'';
+  return quoted;
+}
+
+const ColumnInfo* findColumn(const TableDetails& table, std::string_view word) {
+  for (const auto& column : table.columns) {
+    if (toLower(column.column_name) == word) {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+
+// Sole primary key column, or nullptr for tables without a single-column key
+const ColumnInfo* primaryKey(const TableDetails& table) {
+  const ColumnInfo* key = nullptr;
+  for (const auto& column : table.columns) {
+    if (!column.is_primary_key) {
+      continue;
+    }
+    if (key && key->column_name != column.column_name) {
+      return nullptr;
+    }
+    key = &column;
+  }
+  return key;
+}
+
+// Timestamp column of a "recent" request: named in the request, the
+// table's only timestamp column, or the first of kRecentColumns present.
+const ColumnInfo* recentColumn(const TableDetails& table,
+                              std::vector<Token>& tokens,
+                              double& confidence) {
+  for (auto& token : tokens) {
+    const ColumnInfo* column = findColumn(table, token.lower);
+    if (column && isTemporalType(column->data_type)) {
+      token.used = true;
+      return column;
+    }
+  }
+
+  const ColumnInfo* only = nullptr;
+  size_t temporal = 0;
+  for (const auto& column : table.columns) {
+    if (isTemporalType(column.data_type)) {
+      only = &column;
+      ++temporal;
+    }
+  }
+  if (temporal == 1) {
+    return only;
+  }
+
+  for (std::string_view name : kRecentColumns) {
+    const ColumnInfo* column = findColumn(table, name);
+    if (column && isTemporalType(column->data_type)) {
+      confidence *= 0.9;
+      return column;
+    }
+  }
+  return nullptr;
+}
+
+// Key value of a lookup: "id 42", "id = 42", "#42" or "user 42"
+std::optional<std::string> lookupValue(std::vector<Token>& tokens,
+                                       const ColumnInfo& key,
+                                       std::string_view table) {
+  std::string key_name = toLower(key.column_name);
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    Token& token = tokens[i];
+    if (token.lower.size() > 1 && token.lower[0] == '#') {
+      token.used = true;
+      return token.text.substr(1);
+    }
+
+    bool names_key = token.lower == "id" || token.lower == key_name;
+    if (!names_key && !namesTable(token.lower, table)) {
+      continue;
+    }
+    size_t value = i + 1;
+    if (names_key && value < tokens.size() &&
+        (tokens[value].lower == "=" || tokens[value].lower == "is")) {
+      ++value;
+    }
+    if (value < tokens.size() &&
+        (names_key || isDigits(tokens[value].lower))) {
+      for (size_t j = i; j <= value; ++j) {
+        tokens[j].used = true;
+      }
+      return tokens[value].text;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string appendLimit(std::string sql, std::optional<int> row_limit) {
+  if (row_limit.has_value()) {
+    sql += " LIMIT " + std::to_string(*row_limit);
+  }
+  return sql;
+}
+
+}  // namespace
+
+TemplateShape QueryTemplates::detect(std::string_view natural_language) {
+  return findShape(tokenize(natural_language)).shape;
+}
+
+std::optional<TemplateMatch> QueryTemplates::match(
+    std::string_view natural_language,
+    const TableDetails& table,
+    std::optional<int> row_limit) {
+  std::vector<Token> tokens = tokenize(natural_language);
+  ShapeAt found = findShape(tokens);
+  if (found.shape == TemplateShape::kNone) {
+    return std::nullopt;
+  }
+
+  std::string table_name = toLower(table.table_name);
+  bool named = false;
+  for (auto& token : tokens) {
+    if (namesTable(token.lower, table_name)) {
+      token.used = named = true;
+    } else if (isOneOf(token.lower, kFiller)) {
+      token.used = true;
+    }
+  }
+  if (!named) {
+    return std::nullopt;
+  }
+
+  std::string relation = quoteIdent(table.table_name);
+  std::string display(table.table_name);
+  if (!table.schema_name.empty()) {
+    relation = quoteIdent(table.schema_name) + "." + relation;
+    display = std::string(table.schema_name) + "." + display;
+  }
+
+  TemplateMatch match{.shape = found.shape,
+                      .sql = {},
+                      .explanation = {},
+                      .row_limit_applied = false,
+                      .confidence = 1.0};
+  switch (found.shape) {
+    case TemplateShape::kCount: {
+      for (size_t i = found.at; i < tokens.size() && i < found.at + 2; ++i) {
+        if (tokens[i].lower == "count" || tokens[i].lower == "how" ||
+            tokens[i].lower == "many" || tokens[i].lower == "number") {
+          tokens[i].used = true;
+        }
+      }
+      for (auto& token : tokens) {
+        if (token.lower == "total") {
+          token.used = true;
+        }
+      }
+      match.sql = "SELECT COUNT(*) AS count FROM " + relation + ";";
+      match.explanation = "Counts the rows in " + display + ".";
+      break;
+    }
+
+    case TemplateShape::kTopN: {
+      bool top = tokens[found.at].lower == "top";
+      int limit = *positiveInt(tokens[found.at + 1].lower);
+      tokens[found.at].used = tokens[found.at + 1].used = true;
+
+      const ColumnInfo* column = nullptr;
+      for (size_t i = found.at + 2; i + 1 < tokens.size() && !column; ++i) {
+        if (tokens[i].lower != "by") {
+          continue;
+        }
+        column = findColumn(table, tokens[i + 1].lower);
+        if (column && (isNumericType(column->data_type) ||
+                       isTemporalType(column->data_type))) {
+          tokens[i + 1].used = true;
+        } else {
+          column = nullptr;
+        }
+      }
+      if (!column) {
+        return std::nullopt;
+      }
+
+      if (row_limit.has_value() && limit > *row_limit) {
+        limit = *row_limit;
+        match.row_limit_applied = true;
+      }
+      match.sql = "SELECT * FROM " + relation + " ORDER BY " +
+                  quoteIdent(column->column_name) +
+                  (top ? " DESC NULLS LAST" : " ASC") + " LIMIT " +
+                  std::to_string(limit) + ";";
+      match.explanation = "Returns the " + std::to_string(limit) +
+                          " rows of " + display + " with the " +
+                          (top ? "highest " : "lowest ") +
+                          std::string(column->column_name) + ".";
+      break;
+    }
+
+    case TemplateShape::kRecent: {
+      size_t unit_at = found.at + 1;
+      int amount = 1;
+      if (auto n = positiveInt(tokens[unit_at].lower)) {
+        amount = *n;
+        tokens[unit_at++].used = true;
+      }
+      std::string_view unit = *intervalUnit(tokens[unit_at].lower);
+      tokens[found.at].used = tokens[unit_at].used = true;
+      for (auto& token : tokens) {
+        if (isOneOf(token.lower, kRecentWords)) {
+          token.used = true;
+        }
+      }
+
+      const ColumnInfo* column =
+          recentColumn(table, tokens, match.confidence);
+      if (!column) {
+        return std::nullopt;
+      }
+
+      std::string interval = std::to_string(amount) + " " + std::string(unit) +
+                             (amount == 1 ? "" : "s");
+      std::string ident = quoteIdent(column->column_name);
+      match.sql = appendLimit("SELECT * FROM " + relation + " WHERE " + ident +
+                                  " >= now() - interval '" + interval +
+                                  "' ORDER BY " + ident + " DESC",
+                              row_limit) +
+                  ";";
+      match.row_limit_applied = row_limit.has_value();
+      match.explanation = "Returns the rows of " + display + " whose " +
+                          std::string(column->column_name) +
+                          " is within the last " + interval +
+                          ", newest first.";
+      break;
+    }
+
+    case TemplateShape::kLookup: {
+      const ColumnInfo* key = primaryKey(table);
+      if (!key) {
+        return std::nullopt;
+      }
+      auto value = lookupValue(tokens, *key, table_name);
+      if (!value) {
+        return std::nullopt;
+      }
+
+      std::string literal;
+      if (isIntegerType(key->data_type) && isDigits(*value)) {
+        literal = *value;
+      } else if (isTextType(key->data_type) && !value->empty()) {
+        literal = quoteLiteral(*value);
+      } else {
+        return std::nullopt;
+      }
+      for (auto& token : tokens) {
+        if (isOneOf(token.lower, kLookupWords)) {
+          token.used = true;
+        }
+      }
+
+      match.sql = "SELECT * FROM " + relation + " WHERE " +
+                  quoteIdent(key->column_name) + " = " + literal + ";";
+      match.explanation = "Returns the row of " + display + " with " +
+                          std::string(key->column_name) + " " + *value + ".";
+      break;
+    }
+
+    case TemplateShape::kNone:
+      return std::nullopt;
+  }
+
+  for (const auto& token : tokens) {
+    if (!token.used) {
+      match.confidence *= 0.5;
+    }
+  }
+  return match;
+}
+
+const char* QueryTemplates::shapeName(TemplateShape shape) {
+  switch (shape) {
+    case TemplateShape::kCount:
+      return "count";
+    case TemplateShape::kTopN:
+      return "top_n";
+    case TemplateShape::kRecent:
+      return "recent";
+    case TemplateShape::kLookup:
+      return "lookup";
+    case TemplateShape::kNone:
+      break;
+  }
+  return "none";
+}
+
+}  // namespace pg_ai
@@ -43,6 +43,10 @@ std::string ResponseFormatter::createJSONResponse(
     response["row_limit_applied"] = true;
   }
 
+  if (!result.source.empty()) {
+    response["source"] = result.source;
+  }
+
   return response.dump(2);  // Pretty print with 2-space indentation
 }
 
@@ -76,6 +80,14 @@ std::string ResponseFormatter::createPlainTextResponse(
               "for safety";
   }
 
+  if (result.source == "template") {
+    output << "\n\n-- Note: Generated locally from a query template, without "
+              "an AI provider call";
+  } else if (result.source == "history") {
+    output << "\n\n-- Note: Previously accepted query for a matching request, "
+              "returned without an AI provider call";
+  }
+
   return output.str();
 }
 
@@ -0,0 +1,195 @@
+#include "../include/schema_cache.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <tuple>
+#include <utility>
+
+namespace pg_ai {
+
+namespace {
+
+std::string qualifiedName(std::string_view schema_name,
+                          std::string_view table_name) {
+  std::string name(schema_name);
+  name += '.';
+  name += table_name;
+  return name;
+}
+
+}  // namespace
+
+void SchemaCache::advance(
+    uint64_t version,
+    const std::optional<std::vector<uint32_t>>& changed) {
+  if (version_ == version) {
+    return;
+  }
+  version_ = version;
+
+  if (!changed) {
+    tables_.reset();
+    stale_.clear();
+    details_.clear();
+    glossary_.reset();
+    join_graph_.reset();
+    return;
+  }
+  if (changed->empty()) {
+    return;
+  }
+
+  auto isChanged = [&](uint32_t relid) {
+    return std::binary_search(changed->begin(), changed->end(), relid);
+  };
+  if (isChanged(glossary_relid_)) {
+    glossary_.reset();
+  }
+  if (changed->size() > 1 || changed->front() != glossary_relid_) {
+    join_graph_.reset();
+  }
+
+  // Foreign keys name the table they reference, so details mentioning a
+  // changed (perhaps renamed) table go too
+  std::vector<std::string_view> changed_names;
+  if (tables_) {
+    for (const auto& table : tables_->tables) {
+      if (isChanged(table.relid)) {
+        changed_names.push_back(table.table_name);
+      }
+    }
+  }
+  auto referencesChanged = [&](const TableDetails& details) {
+    return std::any_of(
+        details.columns.begin(), details.columns.end(),
+        [&](const auto& column) {
+          return column.is_foreign_key &&
+                 std::find(changed_names.begin(), changed_names.end(),
+                           column.foreign_table) != changed_names.end();
+        });
+  };
+
+  for (auto it = details_.begin(); it != details_.end();) {
+    if (isChanged(it->second.relid) ||
+        referencesChanged(it->second.details)) {
+      it = details_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (tables_) {
+    std::vector<uint32_t> stale;
+    std::set_union(stale_.begin(), stale_.end(), changed->begin(),
+                   changed->end(), std::back_inserter(stale));
+    stale_ = std::move(stale);
+  }
+}
+
+const DatabaseSchema* SchemaCache::tables() const {
+  return tables_ && stale_.empty() ? &*tables_ : nullptr;
+}
+
+void SchemaCache::storeTables(const DatabaseSchema& schema) {
+  if (schema.success) {
+    tables_ = schema;
+    stale_.clear();
+  }
+}
+
+void SchemaCache::storeTables(const DatabaseSchema& schema,
+                              const std::vector<uint32_t>& stale) {
+  storeTables(schema);
+  if (tables_) {
+    stale_ = stale;
+  }
+}
+
+void SchemaCache::patchTables(const DatabaseSchema& fresh) {
+  if (!tables_ || !fresh.success) {
+    tables_.reset();
+    stale_.clear();
+    return;
+  }
+
+  auto& tables = tables_->tables;
+  std::erase_if(tables, [&](const TableInfo& table) {
+    return std::binary_search(stale_.begin(), stale_.end(), table.relid);
+  });
+  stale_.clear();
+
+  // Both lists are ordered like getDatabaseTables() returns them
+  auto before = [](const TableInfo& a, const TableInfo& b) {
+    return std::tie(a.schema_name, a.table_name) <
+           std::tie(b.schema_name, b.table_name);
+  };
+  for (const auto& table : fresh.tables) {
+    tables.insert(
+        std::upper_bound(tables.begin(), tables.end(), table, before), table);
+  }
+}
+
+const TableDetails* SchemaCache::details(std::string_view schema_name,
+                                         std::string_view table_name) const {
+  auto it = details_.find(qualifiedName(schema_name, table_name));
+  return it != details_.end() ? &it->second.details : nullptr;
+}
+
+void SchemaCache::storeDetails(const TableDetails& details) {
+  if (!details.success || !tables_) {
+    return;
+  }
+  auto table = std::find_if(
+      tables_->tables.begin(), tables_->tables.end(), [&](const auto& t) {
+        return t.schema_name == details.schema_name &&
+               t.table_name == details.table_name;
+      });
+  if (table == tables_->tables.end() || table->relid == 0) {
+    return;
+  }
+  details_.insert_or_assign(
+      qualifiedName(details.schema_name, details.table_name),
+      CachedDetails{.relid = table->relid, .details = details});
+}
+
+void SchemaCache::storeGlossary(uint32_t relid, Glossary glossary) {
+  glossary_ = std::move(glossary);
+  glossary_relid_ = relid;
+}
+
+void SchemaCache::storeJoinGraph(JoinGraph graph) {
+  join_graph_ = std::move(graph);
+}
+
+void SchemaCache::clear() {
+  version_.reset();
+  tables_.reset();
+  stale_.clear();
+  details_.clear();
+  glossary_.reset();
+  join_graph_.reset();
+}
+
+SchemaCache& SchemaCache::forRole(uint32_t role, uint64_t memberships) {
+  // Most recently used first
+  static std::list<std::pair<uint32_t, SchemaCache>> caches;
+  static uint64_t cached_memberships = 0;
+  if (memberships != cached_memberships) {
+    caches.clear();
+    cached_memberships = memberships;
+  }
+  auto it = std::find_if(caches.begin(), caches.end(),
+                         [&](const auto& entry) { return entry.first == role; });
+  if (it != caches.end()) {
+    caches.splice(caches.begin(), caches, it);
+  } else {
+    caches.emplace_front(role, SchemaCache());
+    if (caches.size() > kMaxRoles) {
+      caches.pop_back();
+    }
+  }
+  return caches.front().second;
+}
+
+}  // namespace pg_ai
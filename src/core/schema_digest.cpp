@@ -0,0 +1,100 @@
+#include "../include/schema_digest.hpp"
+
+namespace pg_ai {
+
+nlohmann::json SchemaDigest::toJson(const TableDetails& details) {
+  nlohmann::json json;
+  json["table_name"] = details.table_name;
+  json["schema_name"] = details.schema_name;
+  if (!details.description.empty()) {
+    json["description"] = details.description;
+  }
+
+  nlohmann::json columns = nlohmann::json::array();
+  for (const auto& column : details.columns) {
+    nlohmann::json column_json;
+    column_json["column_name"] = column.column_name;
+    column_json["data_type"] = column.data_type;
+    column_json["is_nullable"] = column.is_nullable;
+    column_json["column_default"] = column.column_default;
+    column_json["is_primary_key"] = column.is_primary_key;
+    column_json["is_foreign_key"] = column.is_foreign_key;
+    if (!column.foreign_table.empty()) {
+      column_json["foreign_table"] = column.foreign_table;
+      column_json["foreign_column"] = column.foreign_column;
+    }
+    if (!column.description.empty()) {
+      column_json["description"] = column.description;
+    }
+    columns.push_back(column_json);
+  }
+  json["columns"] = columns;
+
+  nlohmann::json indexes = nlohmann::json::array();
+  for (const auto& index : details.indexes) {
+    indexes.push_back(index);
+  }
+  json["indexes"] = indexes;
+  return json;
+}
+
+std::optional<TableDetails> SchemaDigest::fromJson(
+    std::string_view json,
+    std::pmr::memory_resource* memory) {
+  auto parsed = nlohmann::json::parse(json, nullptr, false);
+  if (parsed.is_discarded() || !parsed.is_object()) {
+    return std::nullopt;
+  }
+
+  auto text = [memory](const nlohmann::json& object, const char* key) {
+    auto it = object.find(key);
+    return std::pmr::string(
+        it != object.end() && it->is_string()
+            ? it->get_ref<const std::string&>()
+            : std::string(),
+        memory);
+  };
+  auto flag = [](const nlohmann::json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_boolean() && it->get<bool>();
+  };
+
+  auto columns = parsed.find("columns");
+  auto indexes = parsed.find("indexes");
+  if (columns == parsed.end() || !columns->is_array() ||
+      indexes == parsed.end() || !indexes->is_array()) {
+    return std::nullopt;
+  }
+
+  TableDetails details{.table_name = text(parsed, "table_name"),
+                       .schema_name = text(parsed, "schema_name"),
+                       .columns = std::pmr::vector<ColumnInfo>(memory),
+                       .indexes = std::pmr::vector<std::pmr::string>(memory),
+                       .success = true,
+                       .error_message = "",
+                       .description = text(parsed, "description")};
+  details.columns.reserve(columns->size());
+  for (const auto& column : *columns) {
+    if (!column.is_object()) {
+      return std::nullopt;
+    }
+    details.columns.push_back(
+        ColumnInfo{.column_name = text(column, "column_name"),
+                   .data_type = text(column, "data_type"),
+                   .is_nullable = flag(column, "is_nullable"),
+                   .column_default = text(column, "column_default"),
+                   .is_primary_key = flag(column, "is_primary_key"),
+                   .is_foreign_key = flag(column, "is_foreign_key"),
+                   .foreign_table = text(column, "foreign_table"),
+                   .foreign_column = text(column, "foreign_column"),
+                   .description = text(column, "description")});
+  }
+  for (const auto& index : *indexes) {
+    if (index.is_string()) {
+      details.indexes.emplace_back(index.get_ref<const std::string&>());
+    }
+  }
+  return details;
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,165 @@
+#include "../include/schema_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <tuple>
+#include <utility>
+
+namespace pg_ai {
+
+namespace {
+
+std::string lowered(std::string_view text) {
+  std::string result(text);
+  for (auto& c : result) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return result;
+}
+
+std::string_view trimmed(std::string_view text) {
+  while (!text.empty() &&
+         std::isspace(static_cast<unsigned char>(text.front()))) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() &&
+         std::isspace(static_cast<unsigned char>(text.back()))) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+std::string tableSnippet(const TableInfo& table) {
+  return std::string(table.table_type) + ", ~" +
+         std::to_string(table.estimated_rows) + " rows";
+}
+
+std::string columnSnippet(const ColumnInfo& column) {
+  std::string snippet(column.data_type);
+  if (column.is_primary_key) {
+    snippet += ", primary key";
+  }
+  if (column.is_foreign_key && !column.foreign_table.empty()) {
+    snippet += ", references " + std::string(column.foreign_table) + "(" +
+               std::string(column.foreign_column) + ")";
+  }
+  if (!column.is_nullable) {
+    snippet += ", not null";
+  }
+  return snippet;
+}
+
+}  // namespace
+
+SchemaIndex::SchemaIndex(const DatabaseSchema& schema,
+                         const std::vector<TableDetails>& details,
+                         const Glossary& glossary) {
+  for (const auto& table : schema.tables) {
+    SchemaMatch match{.schema_name = std::string(table.schema_name),
+                      .table_name = std::string(table.table_name),
+                      .column_name = "",
+                      .score = 0.0,
+                      .snippet = tableSnippet(table)};
+    entries_.push_back(Entry{.match = std::move(match),
+                             .name = lowered(table.table_name),
+                             .trigrams = TrigramSet(table.table_name)});
+  }
+
+  for (const auto& table : details) {
+    if (!table.success) {
+      continue;
+    }
+    std::string table_name(table.table_name);
+    for (const auto& column : table.columns) {
+      SchemaMatch match{.schema_name = std::string(table.schema_name),
+                        .table_name = table_name,
+                        .column_name = std::string(column.column_name),
+                        .score = 0.0,
+                        .snippet = columnSnippet(column)};
+      std::string name = lowered(match.column_name);
+      TrigramSet trigrams(table_name + " " + match.column_name);
+      entries_.push_back(Entry{.match = std::move(match),
+                               .name = std::move(name),
+                               .trigrams = std::move(trigrams)});
+    }
+  }
+
+  for (const auto& term : glossary.entries()) {
+    auto table = std::find_if(
+        schema.tables.begin(), schema.tables.end(), [&](const auto& t) {
+          return std::string_view(t.schema_name) == term.schema_name &&
+                 std::string_view(t.table_name) == term.table_name;
+        });
+    if (table == schema.tables.end()) {
+      continue;
+    }
+    SchemaMatch match{.schema_name = term.schema_name,
+                      .table_name = term.table_name,
+                      .column_name = term.column_name,
+                      .score = 0.0,
+                      .snippet = "glossary: " + term.term};
+    entries_.push_back(Entry{.match = std::move(match),
+                             .name = lowered(term.term),
+                             .trigrams = TrigramSet(term.term)});
+  }
+}
+
+std::vector<SchemaMatch> SchemaIndex::search(std::string_view query,
+                                             size_t k) const {
+  std::string needle = lowered(trimmed(query));
+  if (needle.empty() || k == 0) {
+    return {};
+  }
+  TrigramSet query_trigrams(needle);
+
+  std::vector<SchemaMatch> matches;
+  // A table or column reachable through several names is listed once, with
+  // its best score
+  std::map<std::tuple<std::string_view, std::string_view, std::string_view>,
+           size_t>
+      listed;
+  for (const auto& entry : entries_) {
+    double score = entry.trigrams.similarity(query_trigrams);
+    if (entry.name == needle) {
+      score = 1.0;
+    } else if (entry.name.starts_with(needle)) {
+      // Longer prefixes of shorter names rank higher
+      score = std::max(score, 0.5 + 0.5 * static_cast<double>(needle.size()) /
+                                        static_cast<double>(entry.name.size()));
+    }
+    if (score < kMinScore) {
+      continue;
+    }
+    const auto& match = entry.match;
+    auto [it, inserted] = listed.try_emplace(
+        {match.schema_name, match.table_name, match.column_name},
+        matches.size());
+    if (inserted) {
+      matches.push_back(match);
+      matches.back().score = score;
+    } else if (score > matches[it->second].score) {
+      matches[it->second] = match;
+      matches[it->second].score = score;
+    }
+  }
+
+  auto better = [](const SchemaMatch& a, const SchemaMatch& b) {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    return std::tie(a.column_name, a.schema_name, a.table_name) <
+           std::tie(b.column_name, b.schema_name, b.table_name);
+  };
+  if (matches.size() > k) {
+    std::partial_sort(matches.begin(),
+                      matches.begin() + static_cast<std::ptrdiff_t>(k),
+                      matches.end(), better);
+    matches.resize(k);
+  } else {
+    std::sort(matches.begin(), matches.end(), better);
+  }
+  return matches;
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,463 @@
+#include "../include/schema_snapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pg_ai {
+
+namespace {
+
+// Layout: Header, TableRecord[table_count], ColumnRecord[column_count],
+// StringRef[index_count] (index definitions), RelidEntry[table_count]
+// sorted by relid, then the string pool. Every record size is a multiple
+// of 8, so records stay aligned within the page-aligned mapping.
+
+constexpr uint32_t kMagic = 0x53414750;  // "PGAS", also detects byte order
+constexpr uint32_t kFormat = 2;
+
+struct StringRef {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct Header {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t version;
+  uint32_t table_count;
+  uint32_t column_count;
+  uint32_t index_count;
+  uint32_t pool_size;
+};
+
+struct TableRecord {
+  uint32_t relid;
+  uint32_t has_details;
+  int64_t estimated_rows;
+  StringRef schema_name;
+  StringRef table_name;
+  StringRef table_type;
+  StringRef description;
+  uint32_t first_column;
+  uint32_t column_count;
+  uint32_t first_index;
+  uint32_t index_count;
+};
+
+constexpr uint32_t kNullable = 1;
+constexpr uint32_t kPrimaryKey = 2;
+constexpr uint32_t kForeignKey = 4;
+
+struct ColumnRecord {
+  StringRef column_name;
+  StringRef data_type;
+  StringRef column_default;
+  StringRef foreign_table;
+  StringRef foreign_column;
+  StringRef description;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+struct RelidEntry {
+  uint32_t relid;
+  uint32_t table;
+};
+
+static_assert(sizeof(Header) == 32 && sizeof(TableRecord) == 64 &&
+              sizeof(ColumnRecord) == 56 && sizeof(RelidEntry) == 8);
+static_assert(std::is_trivially_copyable_v<TableRecord> &&
+              std::is_trivially_copyable_v<ColumnRecord>);
+
+// Byte offsets of each section, given the header counts
+struct Sections {
+  uint64_t tables;
+  uint64_t columns;
+  uint64_t indexes;
+  uint64_t relids;
+  uint64_t pool;
+  uint64_t end;
+};
+
+Sections sectionsOf(const Header& header) {
+  Sections sections{};
+  sections.tables = sizeof(Header);
+  sections.columns =
+      sections.tables + uint64_t{header.table_count} * sizeof(TableRecord);
+  sections.indexes =
+      sections.columns + uint64_t{header.column_count} * sizeof(ColumnRecord);
+  sections.relids =
+      sections.indexes + uint64_t{header.index_count} * sizeof(StringRef);
+  sections.pool =
+      sections.relids + uint64_t{header.table_count} * sizeof(RelidEntry);
+  sections.end = sections.pool + header.pool_size;
+  return sections;
+}
+
+template <typename T>
+const T* at(const std::byte* data, uint64_t offset) {
+  return reinterpret_cast<const T*>(data + offset);
+}
+
+// Interns strings into the pool, storing repeated ones (data types, schema
+// names) once
+class PoolBuilder {
+ public:
+  StringRef add(std::string_view text) {
+    auto [it, inserted] =
+        offsets_.try_emplace(std::string(text),
+                             static_cast<uint32_t>(pool_.size()));
+    if (inserted) {
+      pool_.append(text);
+    }
+    return StringRef{.offset = it->second,
+                     .length = static_cast<uint32_t>(text.size())};
+  }
+
+  const std::string& pool() const { return pool_; }
+
+ private:
+  std::string pool_;
+  std::unordered_map<std::string, uint32_t> offsets_;
+};
+
+template <typename T>
+void append(std::string& out, const std::vector<T>& records) {
+  out.append(reinterpret_cast<const char*>(records.data()),
+             records.size() * sizeof(T));
+}
+
+bool validRef(const StringRef& ref, const Header& header) {
+  return uint64_t{ref.offset} + ref.length <= header.pool_size;
+}
+
+// Checks every reference once at open, so lookups need no bounds checks
+bool validate(const std::byte* data, size_t size) {
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  const auto& header = *at<Header>(data, 0);
+  if (header.magic != kMagic || header.format != kFormat) {
+    return false;
+  }
+  Sections sections = sectionsOf(header);
+  if (sections.end != size) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header.table_count; ++i) {
+    const auto& table = at<TableRecord>(data, sections.tables)[i];
+    if (!validRef(table.schema_name, header) ||
+        !validRef(table.table_name, header) ||
+        !validRef(table.table_type, header) ||
+        !validRef(table.description, header) ||
+        uint64_t{table.first_column} + table.column_count >
+            header.column_count ||
+        uint64_t{table.first_index} + table.index_count >
+            header.index_count) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header.column_count; ++i) {
+    const auto& column = at<ColumnRecord>(data, sections.columns)[i];
+    if (!validRef(column.column_name, header) ||
+        !validRef(column.data_type, header) ||
+        !validRef(column.column_default, header) ||
+        !validRef(column.foreign_table, header) ||
+        !validRef(column.foreign_column, header) ||
+        !validRef(column.description, header)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header.index_count; ++i) {
+    if (!validRef(at<StringRef>(data, sections.indexes)[i], header)) {
+      return false;
+    }
+  }
+  const auto* relids = at<RelidEntry>(data, sections.relids);
+  for (uint32_t i = 0; i < header.table_count; ++i) {
+    if (relids[i].table >= header.table_count ||
+        (i > 0 && relids[i - 1].relid > relids[i].relid)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::string SchemaSnapshot::serialize(
+    uint64_t version,
+    const DatabaseSchema& schema,
+    const std::map<uint32_t, TableDetails>& details) {
+  PoolBuilder pool;
+  std::vector<TableRecord> tables;
+  std::vector<ColumnRecord> columns;
+  std::vector<StringRef> indexes;
+  std::vector<RelidEntry> relids;
+  tables.reserve(schema.tables.size());
+  relids.reserve(schema.tables.size());
+
+  for (const auto& info : schema.tables) {
+    TableRecord table{
+        .relid = info.relid,
+        .has_details = 0,
+        .estimated_rows = info.estimated_rows,
+        .schema_name = pool.add(info.schema_name),
+        .table_name = pool.add(info.table_name),
+        .table_type = pool.add(info.table_type),
+        .description = pool.add(info.description),
+        .first_column = static_cast<uint32_t>(columns.size()),
+        .column_count = 0,
+        .first_index = static_cast<uint32_t>(indexes.size()),
+        .index_count = 0};
+
+    auto found = details.find(info.relid);
+    if (found != details.end() && found->second.success) {
+      const auto& table_details = found->second;
+      table.has_details = 1;
+      table.column_count =
+          static_cast<uint32_t>(table_details.columns.size());
+      table.index_count =
+          static_cast<uint32_t>(table_details.indexes.size());
+      for (const auto& column : table_details.columns) {
+        columns.push_back(ColumnRecord{
+            .column_name = pool.add(column.column_name),
+            .data_type = pool.add(column.data_type),
+            .column_default = pool.add(column.column_default),
+            .foreign_table = pool.add(column.foreign_table),
+            .foreign_column = pool.add(column.foreign_column),
+            .description = pool.add(column.description),
+            .flags = (column.is_nullable ? kNullable : 0) |
+                     (column.is_primary_key ? kPrimaryKey : 0) |
+                     (column.is_foreign_key ? kForeignKey : 0),
+            .reserved = 0});
+      }
+      for (const auto& index : table_details.indexes) {
+        indexes.push_back(pool.add(index));
+      }
+    }
+
+    relids.push_back(RelidEntry{
+        .relid = info.relid, .table = static_cast<uint32_t>(tables.size())});
+    tables.push_back(table);
+  }
+
+  // A table listed twice resolves to its first record
+  std::stable_sort(relids.begin(), relids.end(),
+                   [](const RelidEntry& a, const RelidEntry& b) {
+                     return a.relid < b.relid;
+                   });
+
+  Header header{.magic = kMagic,
+                .format = kFormat,
+                .version = version,
+                .table_count = static_cast<uint32_t>(tables.size()),
+                .column_count = static_cast<uint32_t>(columns.size()),
+                .index_count = static_cast<uint32_t>(indexes.size()),
+                .pool_size = static_cast<uint32_t>(pool.pool().size())};
+
+  std::string out;
+  out.reserve(sectionsOf(header).end);
+  out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  append(out, tables);
+  append(out, columns);
+  append(out, indexes);
+  append(out, relids);
+  out.append(pool.pool());
+  return out;
+}
+
+bool SchemaSnapshot::write(const std::string& path,
+                           std::string_view contents) {
+  std::string temp = path + ".tmp";
+  int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+
+  const char* next = contents.data();
+  size_t left = contents.size();
+  while (left > 0) {
+    ssize_t written = ::write(fd, next, left);
+    if (written <= 0) {
+      ::close(fd);
+      ::unlink(temp.c_str());
+      return false;
+    }
+    next += written;
+    left -= static_cast<size_t>(written);
+  }
+  if (::close(fd) != 0 || std::rename(temp.c_str(), path.c_str()) != 0) {
+    ::unlink(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::optional<SchemaSnapshot> SchemaSnapshot::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    ::close(fd);
+    return std::nullopt;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return std::nullopt;
+  }
+
+  const auto* data = static_cast<const std::byte*>(mapped);
+  if (!validate(data, size)) {
+    ::munmap(mapped, size);
+    return std::nullopt;
+  }
+  return SchemaSnapshot(data, size, static_cast<uint64_t>(st.st_dev),
+                        static_cast<uint64_t>(st.st_ino));
+}
+
+SchemaSnapshot::SchemaSnapshot(const std::byte* data,
+                               size_t size,
+                               uint64_t device,
+                               uint64_t inode)
+    : data_(data), size_(size), device_(device), inode_(inode) {}
+
+SchemaSnapshot::SchemaSnapshot(SchemaSnapshot&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      device_(other.device_),
+      inode_(other.inode_) {}
+
+SchemaSnapshot& SchemaSnapshot::operator=(SchemaSnapshot&& other) noexcept {
+  if (this != &other) {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    device_ = other.device_;
+    inode_ = other.inode_;
+  }
+  return *this;
+}
+
+SchemaSnapshot::~SchemaSnapshot() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<std::byte*>(data_), size_);
+  }
+}
+
+uint64_t SchemaSnapshot::version() const {
+  return at<Header>(data_, 0)->version;
+}
+
+size_t SchemaSnapshot::tableCount() const {
+  return at<Header>(data_, 0)->table_count;
+}
+
+bool SchemaSnapshot::replaced(const std::string& path) const {
+  struct stat st;
+  return ::stat(path.c_str(), &st) != 0 ||
+         static_cast<uint64_t>(st.st_dev) != device_ ||
+         static_cast<uint64_t>(st.st_ino) != inode_;
+}
+
+DatabaseSchema SchemaSnapshot::tables(
+    std::pmr::memory_resource* memory) const {
+  const auto& header = *at<Header>(data_, 0);
+  Sections sections = sectionsOf(header);
+  const char* pool = reinterpret_cast<const char*>(data_ + sections.pool);
+  auto text = [&](const StringRef& ref) {
+    return std::pmr::string(pool + ref.offset, ref.length, memory);
+  };
+
+  DatabaseSchema schema{.tables = std::pmr::vector<TableInfo>(memory),
+                        .success = true,
+                        .error_message = ""};
+  schema.tables.reserve(header.table_count);
+  const auto* records = at<TableRecord>(data_, sections.tables);
+  for (uint32_t i = 0; i < header.table_count; ++i) {
+    schema.tables.push_back(
+        TableInfo{.table_name = text(records[i].table_name),
+                  .schema_name = text(records[i].schema_name),
+                  .table_type = text(records[i].table_type),
+                  .estimated_rows = records[i].estimated_rows,
+                  .relid = records[i].relid,
+                  .row_security = false,
+                  .description = text(records[i].description)});
+  }
+  return schema;
+}
+
+std::optional<TableDetails> SchemaSnapshot::details(
+    uint32_t relid,
+    std::pmr::memory_resource* memory) const {
+  const auto& header = *at<Header>(data_, 0);
+  Sections sections = sectionsOf(header);
+  const auto* relids = at<RelidEntry>(data_, sections.relids);
+  const auto* end = relids + header.table_count;
+  const auto* entry = std::lower_bound(
+      relids, end, relid,
+      [](const RelidEntry& e, uint32_t value) { return e.relid < value; });
+  if (entry == end || entry->relid != relid) {
+    return std::nullopt;
+  }
+  const auto& table = at<TableRecord>(data_, sections.tables)[entry->table];
+  if (table.has_details == 0) {
+    return std::nullopt;
+  }
+
+  const char* pool = reinterpret_cast<const char*>(data_ + sections.pool);
+  auto text = [&](const StringRef& ref) {
+    return std::pmr::string(pool + ref.offset, ref.length, memory);
+  };
+
+  TableDetails details{.table_name = text(table.table_name),
+                       .schema_name = text(table.schema_name),
+                       .columns = std::pmr::vector<ColumnInfo>(memory),
+                       .indexes = std::pmr::vector<std::pmr::string>(memory),
+                       .success = true,
+                       .error_message = "",
+                       .description = text(table.description)};
+  details.columns.reserve(table.column_count);
+  const auto* columns =
+      at<ColumnRecord>(data_, sections.columns) + table.first_column;
+  for (uint32_t i = 0; i < table.column_count; ++i) {
+    const auto& column = columns[i];
+    details.columns.push_back(
+        ColumnInfo{.column_name = text(column.column_name),
+                   .data_type = text(column.data_type),
+                   .is_nullable = (column.flags & kNullable) != 0,
+                   .column_default = text(column.column_default),
+                   .is_primary_key = (column.flags & kPrimaryKey) != 0,
+                   .is_foreign_key = (column.flags & kForeignKey) != 0,
+                   .foreign_table = text(column.foreign_table),
+                   .foreign_column = text(column.foreign_column),
+                   .description = text(column.description)});
+  }
+  details.indexes.reserve(table.index_count);
+  const auto* indexes =
+      at<StringRef>(data_, sections.indexes) + table.first_index;
+  for (uint32_t i = 0; i < table.index_count; ++i) {
+    details.indexes.push_back(text(indexes[i]));
+  }
+  return details;
+}
+
+}  // namespace pg_ai
@@ -0,0 +1,443 @@
+#include "../include/schema_version.hpp"
+
+extern "C" {
+#include <postgres.h>
+
+#include <access/xact.h>
+#include <executor/spi.h>
+#include <miscadmin.h>
+#include <storage/fd.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/inval.h>
+#include <utils/syscache.h>
+#include <utils/timestamp.h>
+}
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "../include/logger.hpp"
+#include "../include/spi_connection.hpp"
+
+namespace pg_ai::schema_version {
+
+namespace {
+
+/** Databases with a version slot of their own; others share slot 0 */
+constexpr int kMaxDatabases = 64;
+/** Relation changes remembered across all databases */
+constexpr int kLogSize = 1024;
+constexpr const char* kTrancheName = "pg_ai_query";
+/** Holds the shared state while the server is shut down */
+constexpr const char* kSaveFile = "pg_ai_query_schema.versions";
+constexpr uint32 kSaveMagic = 0x53565150;
+constexpr uint32 kSaveFormat = 1;
+
+struct DatabaseVersion {
+  Oid database;
+  uint64 version;
+  /** Highest version with changes that fell out of the log */
+  uint64 forgotten;
+};
+
+struct Change {
+  Oid database;
+  /** InvalidOid: every relation of the database */
+  Oid relation;
+  uint64 version;
+};
+
+struct SharedState {
+  LWLock* lock;
+  /** Version of databases without changes since the server started */
+  uint64 initial_version;
+  /** Slot 0 is shared by databases beyond kMaxDatabases */
+  int num_databases;
+  DatabaseVersion databases[kMaxDatabases];
+  /** Changes recorded so far; the next one goes to log[next_change % size] */
+  uint64 next_change;
+  Change log[kLogSize];
+};
+
+SharedState* shared = nullptr;
+shmem_startup_hook_type prev_shmem_startup_hook = nullptr;
+#if PG_VERSION_NUM >= 150000
+shmem_request_hook_type prev_shmem_request_hook = nullptr;
+#endif
+
+// Changes of the current transaction, applied when it commits
+std::vector<uint32_t> pending_relations;
+bool pending_all = false;
+bool pending_any = false;
+bool xact_callback_registered = false;
+
+// Role membership and attribute changes seen by this backend
+uint64_t role_generation = 0;
+bool role_callback_registered = false;
+
+void requestShmem() {
+  RequestAddinShmemSpace(MAXALIGN(sizeof(SharedState)));
+  RequestNamedLWLockTranche(kTrancheName, 1);
+}
+
+#if PG_VERSION_NUM >= 150000
+void shmemRequest() {
+  if (prev_shmem_request_hook) {
+    prev_shmem_request_hook();
+  }
+  requestShmem();
+}
+#endif
+
+// Fresh versions, starting from the current time. Leaves the lock unset.
+void initialize() {
+  memset(shared, 0, sizeof(SharedState));
+  shared->initial_version = static_cast<uint64>(GetCurrentTimestamp());
+  shared->databases[0] = DatabaseVersion{.database = InvalidOid,
+                                         .version = shared->initial_version,
+                                         .forgotten = 0};
+  shared->num_databases = 1;
+}
+
+struct SaveHeader {
+  uint32 magic;
+  uint32 format;
+  uint64 size;
+};
+
+// Writes the shared state at a clean shutdown, so versions and the change
+// log continue after the restart and data tagged with them stays usable
+void shmemShutdown(int code, Datum /*arg*/) {
+  // After a crash, changes may have committed without being recorded
+  if (code != 0 || shared == nullptr) {
+    return;
+  }
+
+  std::string temp = std::string(kSaveFile) + ".tmp";
+  FILE* file = AllocateFile(temp.c_str(), PG_BINARY_W);
+  if (file == nullptr) {
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("could not write file \"%s\": %m", temp.c_str())));
+    return;
+  }
+  SaveHeader header{
+      .magic = kSaveMagic, .format = kSaveFormat, .size = sizeof(SharedState)};
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(shared, sizeof(SharedState), 1, file) == 1;
+  if (FreeFile(file) != 0 || !written) {
+    ereport(LOG, (errcode_for_file_access(),
+                  errmsg("could not write file \"%s\": %m", temp.c_str())));
+    unlink(temp.c_str());
+    return;
+  }
+  (void)durable_rename(temp.c_str(), kSaveFile, LOG);
+}
+
+// Restores the state saved at the last clean shutdown. The file is removed,
+// so a crash before the next clean shutdown starts from fresh versions.
+void loadSaved() {
+  FILE* file = AllocateFile(kSaveFile, PG_BINARY_R);
+  if (file == nullptr) {
+    return;
+  }
+
+  SaveHeader header{};
+  LWLock* lock = shared->lock;
+  bool loaded = fread(&header, sizeof(header), 1, file) == 1 &&
+                header.magic == kSaveMagic && header.format == kSaveFormat &&
+                header.size == sizeof(SharedState) &&
+                fread(shared, sizeof(SharedState), 1, file) == 1 &&
+                shared->num_databases >= 1 &&
+                shared->num_databases <= kMaxDatabases;
+  FreeFile(file);
+  unlink(kSaveFile);
+
+  if (!loaded) {
+    ereport(LOG, (errmsg("ignoring invalid file \"%s\"", kSaveFile)));
+    initialize();
+  }
+  shared->lock = lock;
+}
+
+void shmemStartup() {
+  if (prev_shmem_startup_hook) {
+    prev_shmem_startup_hook();
+  }
+
+  LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+  bool found = false;
+  shared = static_cast<SharedState*>(ShmemInitStruct(
+      "pg_ai_query schema version", sizeof(SharedState), &found));
+  if (!found) {
+    initialize();
+    shared->lock = &(GetNamedLWLockTranche(kTrancheName))->lock;
+  }
+  LWLockRelease(AddinShmemInitLock);
+
+  if (!IsUnderPostmaster) {
+    if (!found) {
+      loadSaved();
+    }
+    on_shmem_exit(shmemShutdown, 0);
+  }
+}
+
+// Slot of a database, or nullptr when it has none yet and create is false.
+// Caller holds the lock (exclusively to create).
+DatabaseVersion* findDatabase(Oid database, bool create) {
+  for (int i = 1; i < shared->num_databases; ++i) {
+    if (shared->databases[i].database == database) {
+      return &shared->databases[i];
+    }
+  }
+  if (!create) {
+    return shared->num_databases == kMaxDatabases ? &shared->databases[0]
+                                                  : nullptr;
+  }
+  if (shared->num_databases == kMaxDatabases) {
+    return &shared->databases[0];
+  }
+  DatabaseVersion* slot = &shared->databases[shared->num_databases++];
+  *slot = DatabaseVersion{.database = database,
+                          .version = shared->databases[0].version,
+                          .forgotten = 0};
+  return slot;
+}
+
+void appendChange(Oid relation, uint64 version) {
+  Change& entry = shared->log[shared->next_change % kLogSize];
+  if (shared->next_change >= kLogSize) {
+    // The overwritten change can no longer be reported to its database
+    DatabaseVersion* owner = findDatabase(entry.database, false);
+    if (owner == nullptr) {
+      owner = &shared->databases[0];
+    }
+    owner->forgotten = std::max(owner->forgotten, entry.version);
+  }
+  entry = Change{
+      .database = MyDatabaseId, .relation = relation, .version = version};
+  ++shared->next_change;
+}
+
+void bump(const std::vector<uint32_t>& relations, bool all) {
+  LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+  DatabaseVersion* slot = findDatabase(MyDatabaseId, true);
+  uint64 version = ++slot->version;
+  if (all || relations.size() > kLogSize / 2) {
+    appendChange(InvalidOid, version);
+  } else {
+    for (uint32_t relation : relations) {
+      appendChange(relation, version);
+    }
+  }
+  LWLockRelease(shared->lock);
+}
+
+void onXactEvent(XactEvent event, void* /*arg*/) {
+  switch (event) {
+    case XACT_EVENT_COMMIT:
+    case XACT_EVENT_PARALLEL_COMMIT:
+      if (pending_any && shared != nullptr) {
+        bump(pending_relations, pending_all);
+      }
+      break;
+    case XACT_EVENT_PREPARE:
+      // COMMIT PREPARED may run in any backend, long after this one forgot
+      // the changes, and bumping now would let sessions reload before they
+      // are visible: two-phase commit is not tracked
+      if (pending_any && shared != nullptr) {
+        ereport(WARNING,
+                (errmsg("pg_ai_query: schema changes in a prepared "
+                        "transaction do not advance the schema version"),
+                 errhint("Sessions that cached the schema see the changes "
+                         "after they reconnect.")));
+      }
+      break;
+    case XACT_EVENT_ABORT:
+    case XACT_EVENT_PARALLEL_ABORT:
+      break;
+    default:
+      return;
+  }
+  pending_relations.clear();
+  pending_all = false;
+  pending_any = false;
+}
+
+// Relations affected by the command; 0 stands for every relation. Index
+// and policy changes count as changes of their table. Dropped indexes and
+// policies are already gone from the catalog, so their table is unknown.
+constexpr const char* kDdlCommandsQuery = R"(
+    SELECT DISTINCT (CASE d.classid
+               WHEN 'pg_catalog.pg_class'::regclass
+                   THEN COALESCE(i.indrelid, d.objid)
+               WHEN 'pg_catalog.pg_policy'::regclass THEN p.polrelid
+               ELSE 0
+           END)::int8
+    FROM pg_catalog.pg_event_trigger_ddl_commands() d
+    LEFT JOIN pg_catalog.pg_index i
+        ON d.classid = 'pg_catalog.pg_class'::regclass
+        AND i.indexrelid = d.objid
+    LEFT JOIN pg_catalog.pg_policy p
+        ON d.classid = 'pg_catalog.pg_policy'::regclass AND p.oid = d.objid
+    WHERE d.classid IN ('pg_catalog.pg_class'::regclass,
+                        'pg_catalog.pg_namespace'::regclass,
+                        'pg_catalog.pg_policy'::regclass)
+        OR d.command_tag IN ('GRANT', 'REVOKE')
+)";
+
+constexpr const char* kDroppedObjectsQuery = R"(
+    SELECT DISTINCT (CASE
+               WHEN d.classid = 'pg_catalog.pg_class'::regclass
+                   AND d.object_type <> 'index' THEN d.objid
+               ELSE 0
+           END)::int8
+    FROM pg_catalog.pg_event_trigger_dropped_objects() d
+    WHERE d.classid IN ('pg_catalog.pg_class'::regclass,
+                        'pg_catalog.pg_namespace'::regclass,
+                        'pg_catalog.pg_policy'::regclass)
+)";
+
+void registerXactCallback() {
+  if (!xact_callback_registered) {
+    RegisterXactCallback(onXactEvent, nullptr);
+    xact_callback_registered = true;
+  }
+}
+
+// Invalidation callbacks may run during any catalog access, so this only
+// counts
+void onRoleChange(Datum /*arg*/, int /*cache_id*/, uint32 /*hash_value*/) {
+  ++role_generation;
+}
+
+}  // namespace
+
+void requestSharedMemory() {
+  if (!process_shared_preload_libraries_in_progress) {
+    return;
+  }
+#if PG_VERSION_NUM >= 150000
+  prev_shmem_request_hook = shmem_request_hook;
+  shmem_request_hook = shmemRequest;
+#else
+  requestShmem();
+#endif
+  prev_shmem_startup_hook = shmem_startup_hook;
+  shmem_startup_hook = shmemStartup;
+}
+
+bool available() {
+  return shared != nullptr;
+}
+
+std::optional<uint64_t> current() {
+  if (shared == nullptr) {
+    return std::nullopt;
+  }
+  LWLockAcquire(shared->lock, LW_SHARED);
+  DatabaseVersion* slot = findDatabase(MyDatabaseId, false);
+  uint64 version = slot ? slot->version : shared->databases[0].version;
+  LWLockRelease(shared->lock);
+  return version;
+}
+
+std::optional<std::vector<uint32_t>> changedSince(uint64_t version) {
+  if (shared == nullptr) {
+    return std::nullopt;
+  }
+
+  std::vector<uint32_t> relations;
+  bool complete = true;
+  LWLockAcquire(shared->lock, LW_SHARED);
+  DatabaseVersion* slot = findDatabase(MyDatabaseId, false);
+  // Versions before initial_version belong to a server run whose changes
+  // were not carried over
+  if (version < shared->initial_version ||
+      (slot != nullptr && slot->forgotten > version)) {
+    complete = false;
+  }
+  uint64 count = std::min<uint64>(shared->next_change, kLogSize);
+  for (uint64 i = 0; complete && i < count; ++i) {
+    const Change& change = shared->log[i];
+    if (change.database != MyDatabaseId || change.version <= version) {
+      continue;
+    }
+    if (change.relation == InvalidOid) {
+      complete = false;
+    } else {
+      relations.push_back(change.relation);
+    }
+  }
+  LWLockRelease(shared->lock);
+
+  if (!complete) {
+    return std::nullopt;
+  }
+  std::sort(relations.begin(), relations.end());
+  relations.erase(std::unique(relations.begin(), relations.end()),
+                  relations.end());
+  return relations;
+}
+
+void recordEventTrigger(bool sql_drop) {
+  if (shared == nullptr) {
+    return;
+  }
+  registerXactCallback();
+
+  try {
+    SPIConnection spi_conn;
+    if (!spi_conn) {
+      throw std::runtime_error(spi_conn.getErrorMessage());
+    }
+
+    int ret = SPI_execute(
+        sql_drop ? kDroppedObjectsQuery : kDdlCommandsQuery, true, 0);
+    if (ret != SPI_OK_SELECT) {
+      throw std::runtime_error(SPI_result_code_string(ret));
+    }
+
+    for (uint64 i = 0; i < SPI_processed; ++i) {
+      auto relation = static_cast<uint32_t>(
+          SPIRow(SPI_tuptable->vals[i], SPI_tuptable->tupdesc).getInt64(1));
+      if (relation == InvalidOid) {
+        pending_all = true;
+      } else {
+        pending_relations.push_back(relation);
+      }
+      pending_any = true;
+    }
+  } catch (const std::exception& e) {
+    logger::Logger::warning(std::string("Schema changes not identified: ") +
+                            e.what());
+    // The commit invalidates everything instead
+    pending_all = true;
+    pending_any = true;
+  }
+}
+
+void recordChange(uint32_t relation) {
+  if (shared == nullptr) {
+    return;
+  }
+  registerXactCallback();
+  pending_relations.push_back(relation);
+  pending_any = true;
+}
+
+uint64_t roleGeneration() {
+  if (!role_callback_registered) {
+    CacheRegisterSyscacheCallback(AUTHMEMROLEMEM, onRoleChange, 0);
+    CacheRegisterSyscacheCallback(AUTHOID, onRoleChange, 0);
+    role_callback_registered = true;
+  }
+  return role_generation;
+}
+
+}  // namespace pg_ai::schema_version
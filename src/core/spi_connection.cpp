@@ -1,5 +1,12 @@
 #include "../include/spi_connection.hpp"
 
+extern "C" {
+#include <fmgr.h>
+#if PG_VERSION_NUM >= 160000
+#include <varatt.h>
+#endif
+}
+
 namespace pg_ai {
 
 SPIConnection::SPIConnection() {
@@ -35,4 +42,45 @@ SPIConnection& SPIConnection::operator=(SPIConnection&& other) noexcept {
   return *this;
 }
 
+bool SPIRow::isNull(int column) const {
+  bool isnull = true;
+  SPI_getbinval(tuple_, tupdesc_, column, &isnull);
+  return isnull;
+}
+
+std::string_view SPIRow::getName(int column) const {
+  bool isnull = true;
+  Datum value = SPI_getbinval(tuple_, tupdesc_, column, &isnull);
+  if (isnull) {
+    return {};
+  }
+  return std::string_view(NameStr(*DatumGetName(value)));
+}
+
+std::string_view SPIRow::getText(int column) const {
+  bool isnull = true;
+  Datum value = SPI_getbinval(tuple_, tupdesc_, column, &isnull);
+  if (isnull) {
+    return {};
+  }
+  // Only copies when the value is compressed or stored out of line; short
+  // and plain varlenas are read in place.
+  struct varlena* packed =
+      pg_detoast_datum_packed(reinterpret_cast<struct varlena*>(
+          DatumGetPointer(value)));
+  return std::string_view(VARDATA_ANY(packed), VARSIZE_ANY_EXHDR(packed));
+}
+
+bool SPIRow::getBool(int column) const {
+  bool isnull = true;
+  Datum value = SPI_getbinval(tuple_, tupdesc_, column, &isnull);
+  return !isnull && DatumGetBool(value);
+}
+
+int64 SPIRow::getInt64(int column) const {
+  bool isnull = true;
+  Datum value = SPI_getbinval(tuple_, tupdesc_, column, &isnull);
+  return isnull ? 0 : DatumGetInt64(value);
+}
+
 }  // namespace pg_ai
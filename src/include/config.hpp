@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -39,6 +40,7 @@ constexpr const char* SECTION_GEMINI = "gemini";
 // Default model names
 constexpr const char* DEFAULT_OPENAI_MODEL = "gpt-4o";
 constexpr const char* DEFAULT_ANTHROPIC_MODEL = "claude-sonnet-4-5-20250929";
+constexpr const char* DEFAULT_GEMINI_MODEL = "gemini-2.5-flash";
 
 // Default token limits
 constexpr int DEFAULT_OPENAI_MAX_TOKENS = 16384;
@@ -46,6 +48,12 @@ constexpr int DEFAULT_ANTHROPIC_MAX_TOKENS = 8192;
 constexpr int DEFAULT_MAX_TOKENS = 4096;
 constexpr double DEFAULT_TEMPERATURE = 0.7;
 constexpr int DEFAULT_MAX_QUERY_LENGTH = 4000;
+constexpr double DEFAULT_TEMPLATE_MIN_CONFIDENCE = 0.9;
+constexpr int DEFAULT_HISTORY_EXAMPLES = 3;
+constexpr double DEFAULT_HISTORY_MIN_SIMILARITY = 0.3;
+constexpr double DEFAULT_HISTORY_MATCH_THRESHOLD = 0.95;
+constexpr int DEFAULT_CONVERSATION_TURNS = 5;
+constexpr int DEFAULT_PLAN_CACHE_SIZE = 64;
 }  // namespace constants
 
 /**
@@ -65,6 +73,7 @@ struct ProviderConfig {
   Provider provider;
   std::string api_key;
   std::string default_model;
+  std::string fast_model;  // Model tried first for simple requests (optional)
   int default_max_tokens;
   double default_temperature;
   std::string api_endpoint;  // Custom API endpoint URL (optional)
@@ -77,6 +86,24 @@ struct ProviderConfig {
         api_endpoint() {}
 };
 
+/**
+ * @brief Per-session model overrides
+ *
+ * Set through the pg_ai_query.provider, model, max_tokens and temperature
+ * parameters, typically per role or database with ALTER ROLE/DATABASE ... SET.
+ * Unset fields fall back to the provider's configuration.
+ */
+struct SessionProfile {
+  /** Provider used when a call passes 'auto' (UNKNOWN = auto-select) */
+  Provider provider = Provider::UNKNOWN;
+  /** Model override (empty = provider's default_model) */
+  std::string model;
+  /** max_tokens override (0 = provider's default_max_tokens) */
+  int max_tokens = 0;
+  /** Temperature override (negative = provider's default_temperature) */
+  double temperature = -1;
+};
+
 /**
  * @brief Global configuration for the pg_ai_query extension
  *
@@ -93,12 +120,30 @@ struct Configuration {
   bool enable_logging;
   int request_timeout_ms;
   int max_retries;
+  /** Derive max_tokens from recent completion lengths (default: true) */
+  bool adaptive_max_tokens;
 
   // Query generation settings
   bool enforce_limit;
   int default_limit;
   /** Maximum characters allowed in natural language query (default: 4000) */
   int max_query_length;
+  /** Highest planner cost estimate ai_query() executes (0 = no limit) */
+  double max_query_cost;
+  /** Plans of executed queries kept per backend (0 = none) */
+  int plan_cache_size;
+  /** Answer common request shapes locally, without a provider call */
+  bool template_fast_path;
+  /** Lowest template confidence answered locally (default: 0.9) */
+  double template_min_confidence;
+  /** Accepted queries added to the prompt as examples (0 = none) */
+  int history_examples;
+  /** Lowest trigram similarity of an accepted query used as example */
+  double history_min_similarity;
+  /** Similarity from which an accepted query is returned directly */
+  double history_match_threshold;
+  /** Earlier requests kept as context for follow-ups (0 = none) */
+  int conversation_turns;
 
   // Response format settings
   bool show_explanation;
@@ -110,6 +155,13 @@ struct Configuration {
   std::string system_prompt;
   std::string explain_system_prompt;
 
+  // Session overrides (set through GUCs only, not the config file)
+  SessionProfile profile;
+
+  // Server settings (set through GUCs only, read at server start)
+  /** Database whose schema digest the worker keeps current ("" = none) */
+  std::string digest_database;
+
   // Default constructor with sensible defaults
   Configuration();
 };
@@ -156,6 +208,91 @@ class ConfigManager {
    */
   static bool loadConfig(const std::string& config_path);
 
+  /**
+   * @brief Load configuration from ~/.pg_ai.config if it exists
+   *
+   * Unlike loadConfig(), a missing file is not an error: built-in defaults
+   * are kept. Either way the configuration is marked as loaded, so later
+   * getConfig() calls do no file I/O.
+   *
+   * @return true if a config file was read
+   */
+  static bool loadConfigIfExists();
+
+  /**
+   * @brief Load configuration from a specific file path if it exists
+   * @param config_path Path to configuration file
+   * @return true if a config file was read
+   */
+  static bool loadConfigIfExists(const std::string& config_path);
+
+  /**
+   * @brief Get current configuration for in-place updates
+   *
+   * Used by the pg_ai_query.* GUC assign hooks. Never reads the config file;
+   * marks the configuration as loaded. Callers that change a value call
+   * markChanged() afterwards.
+   *
+   * @return Mutable reference to current configuration
+   */
+  static Configuration& getMutableConfig();
+
+  /**
+   * @brief Advance the generation after an in-place update
+   */
+  static void markChanged();
+
+  /**
+   * @brief Get provider config for in-place updates, adding it with the
+   * provider's defaults if it is not configured
+   *
+   * Adding a provider advances the generation and invalidates pointers
+   * returned by getProviderConfig(); callers that change an existing one
+   * call markChanged().
+   *
+   * @param provider Provider type to retrieve
+   * @return Mutable reference to the provider config
+   */
+  static ProviderConfig& getOrCreateProviderConfig(Provider provider);
+
+  /**
+   * @brief Get provider config from a given configuration, adding it with
+   * the provider's defaults if it is not configured
+   *
+   * @param config Configuration to look in
+   * @param provider Provider type to retrieve
+   * @return Mutable reference to the provider config
+   */
+  static ProviderConfig& getOrCreateProviderConfig(Configuration& config,
+                                                   Provider provider);
+
+  /**
+   * @brief Parse a configuration file without applying it
+   *
+   * @param config_path Path to configuration file
+   * @param config Receives the parsed configuration
+   * @return true if the file exists and was parsed
+   */
+  static bool readConfigFile(const std::string& config_path,
+                             Configuration& config);
+
+  /**
+   * @brief Get the path of ~/.pg_ai.config
+   * @return Path, or empty if the home directory cannot be determined
+   */
+  static std::string getDefaultConfigPath();
+
+  /**
+   * @brief Get the configuration generation
+   *
+   * Incremented whenever the configuration changes (file load, in-place
+   * update, reset). State derived from the configuration can remember the
+   * generation it was built from and rebuild once it differs.
+   *
+   * @return Current generation of this process's configuration
+   */
+  static uint64_t generation();
+
   /**
    * @brief Get current configuration
    * @return Reference to current configuration
@@ -169,6 +306,20 @@ class ConfigManager {
    */
   static const ProviderConfig* getProviderConfig(Provider provider);
 
+  /**
+   * @brief Get provider config with the session profile applied
+   *
+   * Model, max_tokens and temperature overrides from Configuration::profile
+   * apply to the profile's provider, or to every provider if it has none.
+   * The result is resolved once per configuration generation and cached, so
+   * repeated calls only compare the generation. Pointers stay valid until
+   * the next configuration change.
+   *
+   * @param provider Provider type to find
+   * @return Pointer to the effective config, or nullptr if not found
+   */
+  static const ProviderConfig* getEffectiveProviderConfig(Provider provider);
+
   /**
    * @brief Convert provider enum to string
    *
@@ -194,14 +345,18 @@ class ConfigManager {
  private:
   static Configuration config_;
   static bool config_loaded_;
+  static uint64_t generation_;
+  static std::vector<ProviderConfig> effective_providers_;
+  static uint64_t effective_generation_;
 
   /**
    * @brief Parse configuration file content
    *
    * @param content INI file content to parse
+   * @param config Receives the parsed configuration
    * @return true if parsing succeeded, false otherwise
    */
-  static bool parseConfig(const std::string& content);
+  static bool parseConfig(const std::string& content, Configuration& config);
 
   /**
    * @brief Get home directory path
@@ -210,14 +365,6 @@ class ConfigManager {
    */
   static std::string getHomeDirectory();
 
-  /**
-   * @brief Get mutable provider config (for internal use)
-   *
-   * @param provider Provider type to retrieve
-   * @return Pointer to mutable provider config, or nullptr if not found
-   */
-  static ProviderConfig* getProviderConfigMutable(Provider provider);
-
   /**
    * @brief Load configuration from environment variables
    *
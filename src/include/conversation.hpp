@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "query_generator.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief One answered generate_query request
+ */
+struct ConversationTurn {
+  std::string request;
+  std::string sql;
+};
+
+/**
+ * @brief The generate_query conversation of one session
+ *
+ * Keeps the last few answered requests with their SQL, and a compact
+ * column listing of every table described to the provider since the
+ * conversation started. A follow-up request ("now group that by month") is
+ * sent with these instead of the full schema: the earlier turns, the
+ * one-line listings of known tables, and full details only for tables it
+ * mentions for the first time.
+ *
+ * A request that mentions no table, or uses a follow-up phrase such as
+ * "that" or "instead", continues the conversation; any other request
+ * starts a new one.
+ */
+class Conversation {
+ public:
+  /**
+   * @brief Whether a request continues the conversation
+   *
+   * @param request The user's request
+   * @param mentioned_tables Number of schema tables named in the request
+   */
+  bool isFollowUp(std::string_view request, size_t mentioned_tables) const;
+
+  /**
+   * @brief Remember an answered request
+   *
+   * @param request The user's request
+   * @param sql The SQL returned for it
+   * @param max_turns Number of turns to keep
+   */
+  void recordTurn(std::string request, std::string sql, size_t max_turns);
+
+  /**
+   * @brief Remember a table described to the provider
+   *
+   * @param details The table's columns
+   */
+  void addTable(const TableDetails& details);
+
+  /**
+   * @brief Whether a table was described since the conversation started
+   */
+  bool hasTable(std::string_view schema_name,
+                std::string_view table_name) const;
+
+  /**
+   * @brief Earlier turns and known tables as prompt context
+   *
+   * @return Prompt section, or an empty string for a new conversation
+   */
+  std::string formatContext() const;
+
+  const std::deque<ConversationTurn>& turns() const { return turns_; }
+
+  /**
+   * @brief Forget all turns and tables
+   */
+  void reset();
+
+  /**
+   * @brief One-line column listing of a table
+   *
+   * @return e.g. "public.orders(id integer PK, customer_id integer ->
+   *         customers.id, total numeric)"
+   */
+  static std::string summarizeTable(const TableDetails& details);
+
+  /**
+   * @brief The backend's conversation for a role
+   *
+   * Turns and table listings carry what the role could read, so a session
+   * that switches role (SET ROLE, SECURITY DEFINER), or whose role
+   * memberships change, starts a new conversation.
+   *
+   * @param role OID of the current user
+   * @param memberships schema_version::roleGeneration()
+   */
+  static Conversation& forRole(uint32_t role, uint64_t memberships = 0);
+
+ private:
+  /** Role the conversation belongs to, and its memberships at the time */
+  uint32_t role_ = 0;
+  uint64_t memberships_ = 0;
+  std::deque<ConversationTurn> turns_;
+  /** Qualified table name to summarizeTable() listing */
+  std::map<std::string, std::string, std::less<>> tables_;
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+#include "query_generator.hpp"
+#include "schema_cache.hpp"
+#include "schema_snapshot.hpp"
+
+namespace pg_ai::digest_worker {
+
+/**
+ * @brief Register the schema digest background worker
+ *
+ * Called from _PG_init(). Only takes effect while the library is loaded
+ * through shared_preload_libraries and pg_ai_query.digest_database names a
+ * database; the worker then keeps that database's
+ * pg_ai_query_schema_digest current.
+ */
+void registerWorker();
+
+/**
+ * @brief Rewrite digest rows from the catalogs
+ *
+ * Each row holds a table's details as JSON, its pre-rendered
+ * formatTableDetailsForAI() fragment with an estimated token count, its
+ * row estimate, and the schema version it was read at. Rows of tables
+ * that no longer exist are deleted. Runs in the caller's transaction.
+ *
+ * With the shared schema version available, the whole digest is then
+ * written to the database's SchemaSnapshot file in the data directory.
+ *
+ * @param changed OIDs of the tables to refresh (tables with foreign keys
+ *        to them are refreshed too), or std::nullopt for every table
+ * @return Number of rows written, or -1 when the extension is not
+ *         installed in the current database
+ */
+int refresh(const std::optional<std::vector<uint32_t>>& changed);
+
+/**
+ * @brief A table's details from the digest, if still current
+ *
+ * Tries the mapped snapshot first, then the table's row by OID, and
+ * returns details only if the shared schema version shows no change to the
+ * table since they were written. Columns the current role can't select are
+ * left out.
+ *
+ * @param relid OID of the table
+ * @param memory Memory resource the returned structures allocate from
+ * @return The details, or std::nullopt when the digest can't answer
+ */
+std::optional<TableDetails> lookup(uint32_t relid,
+                                   std::pmr::memory_resource* memory);
+
+/**
+ * @brief A table's details from the mapped snapshot, if still current
+ *
+ * Like lookup() without the digest table: only tables unchanged since the
+ * snapshot was written and readable by the current role are returned,
+ * without the columns it can't select.
+ */
+std::optional<TableDetails> snapshotDetails(uint32_t relid,
+                                            std::pmr::memory_resource* memory);
+
+/**
+ * @brief The current database's schema snapshot, mapped in this backend
+ *
+ * The file is mapped on first use and mapped again once refresh() has
+ * replaced it.
+ *
+ * @return The snapshot, or nullptr when there is none or the shared schema
+ *         version is unavailable
+ */
+const SchemaSnapshot* snapshot();
+
+/**
+ * @brief Start a cache without a table list from the snapshot
+ *
+ * Stores the snapshot's tables the current role can read, with those changed
+ * since the snapshot was written marked stale, so only they are read from
+ * the catalogs.
+ *
+ * @param cache A cache at the current schema version whose tables() is
+ *        nullptr and staleTables() empty
+ * @return Whether the cache now has a table list
+ */
+bool seedSchemaCache(SchemaCache& cache);
+
+}  // namespace pg_ai::digest_worker
@@ -2,19 +2,26 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace gemini {
 
+// Views into caller-owned strings; they must stay alive until
+// generate_text() returns.
 struct GeminiRequest {
-  std::string model;
-  std::string system_prompt;
-  std::string user_prompt;
+  std::string_view model;
+  std::string_view system_prompt;
+  std::string_view user_prompt;
   std::optional<double> temperature;
   std::optional<int> max_tokens;
 };
 
 struct GeminiResponse {
   std::string text;
+  // Output tokens reported in usageMetadata (0 if absent)
+  int output_tokens = 0;
+  // Generation stopped at max_tokens (finishReason MAX_TOKENS)
+  bool truncated = false;
   bool success;
   std::string error_message;
   int status_code;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace pg_ai {
+
+/**
+ * @brief A business term and the table or column it refers to
+ */
+struct GlossaryEntry {
+  std::string term;
+  std::string schema_name;
+  std::string table_name;
+  /** Empty when the term names the table as a whole */
+  std::string column_name;
+};
+
+/**
+ * @brief Business terms from pg_ai_query_glossary, compiled for matching
+ *
+ * Users say "customers" or "churn" where the tables are acct and
+ * subscription_events. Each term is split into lower-cased words and
+ * indexed by its first word, so a request is matched in one pass over its
+ * words. A term matches where all its words appear in sequence as whole
+ * words of the text, ignoring case; a text word ending in "s" or "es" also
+ * matches the term word without it.
+ *
+ * @example
+ * Glossary glossary({{.term = "revenue", .schema_name = "public",
+ *                     .table_name = "fin_ledger_entries"}});
+ * for (const auto* entry : glossary.find("monthly revenue by region")) {
+ *   ...
+ * }
+ */
+class Glossary {
+ public:
+  Glossary() = default;
+  explicit Glossary(std::vector<GlossaryEntry> entries);
+
+  /**
+   * @brief Entries whose term occurs in a text
+   *
+   * @return Entries in order of their first occurrence, each once
+   */
+  std::vector<const GlossaryEntry*> find(std::string_view text) const;
+
+  const std::vector<GlossaryEntry>& entries() const { return entries_; }
+
+  bool empty() const { return entries_.empty(); }
+
+ private:
+  std::vector<GlossaryEntry> entries_;
+  /** Lower-cased words of each entry's term */
+  std::vector<std::vector<std::string>> words_;
+  /** Entries by the first word of their term */
+  std::unordered_map<std::string, std::vector<size_t>> by_first_word_;
+};
+
+}  // namespace pg_ai
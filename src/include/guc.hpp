@@ -0,0 +1,36 @@
+#pragma once
+
+namespace pg_ai::guc {
+
+/**
+ * @brief Define the pg_ai_query.* configuration parameters
+ *
+ * Called once from _PG_init(). Reads ~/.pg_ai.config if it exists and uses
+ * its values as the parameters' boot values, then registers one GUC per
+ * setting. Assign hooks write straight into ConfigManager's configuration,
+ * so values from postgresql.conf, ALTER SYSTEM/DATABASE/ROLE and SET take
+ * effect without touching the file again.
+ *
+ * With the library in shared_preload_libraries this runs in the postmaster
+ * and every backend inherits the parsed configuration through fork().
+ */
+void defineVariables();
+
+/**
+ * @brief Pick up ~/.pg_ai.config changes after a configuration reload
+ *
+ * Called at the start of each SQL function that reads the configuration.
+ * Costs one comparison unless this process has handled a SIGHUP
+ * (pg_reload_conf()) since the last call; only then is the file checked, and
+ * only a changed file is parsed. Its values replace the earlier file values
+ * as parameter defaults, while settings from postgresql.conf, ALTER ... SET
+ * and SET keep precedence.
+ *
+ * PostgreSQL has no hook for extension code in the postmaster's SIGHUP path,
+ * so with shared_preload_libraries the postmaster keeps the file as read at
+ * server start. Each backend forked after a reload that changed the file
+ * parses it once, on its first call; a restart makes it the inherited copy.
+ */
+void reloadIfNeeded();
+
+}  // namespace pg_ai::guc
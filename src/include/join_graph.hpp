@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pg_ai {
+
+/**
+ * @brief A foreign key constraint between two tables
+ */
+struct ForeignKey {
+  /** OID of the referencing table */
+  uint32_t relid;
+  /** OID of the referenced table */
+  uint32_t referenced_relid;
+  /** Schema-qualified name of the referencing table */
+  std::string table;
+  std::string referenced_table;
+  /** Referencing columns, in constraint order */
+  std::vector<std::string> columns;
+  /** Referenced columns, matching columns */
+  std::vector<std::string> referenced_columns;
+};
+
+/**
+ * @brief A table on a join path between mentioned tables, but not one of them
+ */
+struct BridgeTable {
+  uint32_t relid;
+  /** Foreign keys of the paths leading through it */
+  std::vector<const ForeignKey*> keys;
+};
+
+/**
+ * @brief Foreign key adjacency of the database's tables
+ *
+ * A request about orders and customers often needs order_items or
+ * accounts to join them, though it never names them. Foreign keys are
+ * indexed as undirected edges by both of their tables, so connect() finds
+ * the shortest join path from each mentioned table to those already
+ * connected with a breadth-first search, and reports the tables it passes
+ * through.
+ *
+ * @example
+ * JoinGraph graph(readForeignKeys());
+ * for (const auto& bridge : graph.connect({orders, customers}, visible)) {
+ *   prompt += JoinGraph::formatBridge(bridge);
+ * }
+ */
+class JoinGraph {
+ public:
+  /** Longest join path connect() follows, in joins */
+  static constexpr size_t kMaxJoins = 3;
+
+  JoinGraph() = default;
+  explicit JoinGraph(std::vector<ForeignKey> keys);
+
+  /**
+   * @brief Bridging tables joining a set of tables
+   *
+   * Tables are connected in order: each one by a shortest path of at most
+   * kMaxJoins joins to any table connected before it, including bridges
+   * found earlier. Tables with no such path are left unconnected.
+   *
+   * @param relids Tables to connect
+   * @param usable Whether a table may be used as a bridge
+   * @return Bridging tables in order of discovery, each once
+   */
+  std::vector<BridgeTable> connect(
+      const std::vector<uint32_t>& relids,
+      const std::function<bool(uint32_t)>& usable) const;
+
+  /**
+   * @brief A bridging table and its join conditions, for prompts
+   *
+   * "Join through public.order_items:" followed by one line per foreign
+   * key, e.g. "  public.order_items.order_id = public.orders.id".
+   */
+  static std::string formatBridge(const BridgeTable& bridge);
+
+  const std::vector<ForeignKey>& keys() const { return keys_; }
+
+  bool empty() const { return keys_.empty(); }
+
+ private:
+  std::vector<ForeignKey> keys_;
+  /** Indices into keys_ by each of the key's two tables */
+  std::unordered_map<uint32_t, std::vector<size_t>> edges_;
+};
+
+}  // namespace pg_ai
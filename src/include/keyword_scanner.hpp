@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SIMD scan paths: x86-64 builds with GCC or Clang (for target attributes)
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PG_AI_KEYWORD_SCANNER_X86 1
+#endif
+
+namespace pg_ai {
+
+/**
+ * @brief Case-insensitive multi-keyword scanner
+ *
+ * Finds any of a fixed set of ASCII keywords in a text in a single pass,
+ * without lower-casing a copy of the input. Candidate positions are found
+ * 32 (AVX2) or 16 (SSE2) bytes at a time by comparing the case-folded first
+ * two bytes and the last byte of every keyword against the text; only those
+ * candidates are verified byte by byte. Builds without x86 SIMD, and CPUs
+ * without AVX2, fall back to SSE2 or a scalar loop with identical results.
+ *
+ * Up to 64 keywords are supported. Matching folds ASCII letters only; other
+ * bytes (including UTF-8 sequences) must match exactly.
+ *
+ * @example
+ * static const KeywordScanner kErrors({"table not found", "no such table"});
+ * if (kErrors.containsAny(explanation)) {
+ *   // explanation reports a failure
+ * }
+ */
+class KeywordScanner {
+ public:
+  /**
+   * @brief Build a scanner for the given keywords
+   *
+   * @param keywords Keywords to look for; each must be non-empty
+   * @throws std::invalid_argument on an empty keyword or more than 64
+   */
+  KeywordScanner(std::initializer_list<std::string_view> keywords);
+
+  /**
+   * @brief Find which keywords occur in a text
+   *
+   * @param text Text to scan
+   * @return Bit i is set if keyword i (in constructor order) occurs
+   */
+  uint64_t scan(std::string_view text) const;
+
+  /**
+   * @brief Check whether any keyword occurs in a text
+   *
+   * Stops at the first match.
+   *
+   * @param text Text to scan
+   * @return true if at least one keyword occurs
+   */
+  bool containsAny(std::string_view text) const;
+
+  /**
+   * @brief Get the number of keywords
+   */
+  size_t size() const { return keywords_.size(); }
+
+ private:
+  struct Keyword {
+    std::string folded;  // lower-cased keyword
+    uint8_t first;
+    uint8_t second;  // same as first for one-byte keywords
+    uint8_t last;
+  };
+
+  std::vector<Keyword> keywords_;
+  size_t max_length_ = 0;
+
+  uint64_t scanImpl(std::string_view text, bool stop_at_first) const;
+  uint64_t scanScalar(std::string_view text,
+                      size_t from,
+                      uint64_t found,
+                      bool stop_at_first) const;
+  bool matchesAt(std::string_view text, size_t pos, const Keyword& kw) const;
+
+#ifdef PG_AI_KEYWORD_SCANNER_X86
+  uint64_t scanSSE2(std::string_view text, bool stop_at_first) const;
+  uint64_t scanAVX2(std::string_view text, bool stop_at_first) const;
+#endif
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,80 @@
+#pragma once
+
+extern "C" {
+#include <postgres.h>
+
+#include <utils/memutils.h>
+}
+
+#include <memory_resource>
+
+namespace pg_ai {
+
+/**
+ * @brief std::pmr::memory_resource that allocates from a PostgreSQL
+ * MemoryContext
+ *
+ * Allocations are served by palloc from the wrapped context, so everything
+ * handed out is released in bulk when the context is reset or deleted -
+ * including when an elog(ERROR) longjmps past C++ frames and their
+ * destructors never run.
+ */
+class MemoryContextResource : public std::pmr::memory_resource {
+ public:
+  explicit MemoryContextResource(MemoryContext context) : context_(context) {}
+
+  /**
+   * @brief Get the MemoryContext backing this resource
+   */
+  MemoryContext context() const { return context_; }
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p,
+                     std::size_t bytes,
+                     std::size_t alignment) override;
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override;
+
+  MemoryContext context_;
+};
+
+/**
+ * @brief RAII owner of a per-call MemoryContext exposed as a memory resource
+ *
+ * Creates a child of CurrentMemoryContext on construction and deletes it on
+ * destruction, releasing every allocation made through resource() in one
+ * MemoryContextDelete. Because the context hangs off the caller's context,
+ * PostgreSQL still reclaims it during error cleanup if the destructor is
+ * skipped.
+ *
+ * Objects allocated through resource() must not outlive this owner.
+ *
+ * @example
+ * RequestMemoryContext request_memory;
+ * auto result = QueryGenerator::generateQuery(request,
+ *                                             request_memory.resource());
+ */
+class RequestMemoryContext {
+ public:
+  RequestMemoryContext();
+  ~RequestMemoryContext();
+
+  RequestMemoryContext(const RequestMemoryContext&) = delete;
+  RequestMemoryContext& operator=(const RequestMemoryContext&) = delete;
+
+  /**
+   * @brief Get the memory resource allocating from this context
+   */
+  std::pmr::memory_resource* resource() { return &resource_; }
+
+  /**
+   * @brief Get the underlying MemoryContext
+   */
+  MemoryContext context() const { return resource_.context(); }
+
+ private:
+  MemoryContextResource resource_;
+};
+
+}  // namespace pg_ai
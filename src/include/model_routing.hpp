@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace pg_ai {
+
+/**
+ * @brief Model tier a request is sent to
+ */
+enum class ModelTier { kFast, kStrong };
+
+/**
+ * @brief Result of estimating a request's complexity
+ */
+struct ComplexityEstimate {
+  /** Sum of the complexity signals found in the request */
+  int score = 0;
+  /** Tier the request should be tried on first */
+  ModelTier tier = ModelTier::kFast;
+};
+
+/**
+ * @brief Local, cheap estimate of how hard a natural language request is
+ *
+ * Scores one point per kind of signal found in the request text
+ * (aggregation, time ranges, ranking, comparisons), one point per mentioned
+ * table beyond the first (up to three), and up to two points for long
+ * requests. Requests scoring kStrongThreshold or more go to the strong
+ * model directly; "count rows in orders" scores 0.
+ *
+ * Keyword matching is a single KeywordScanner pass over the text.
+ */
+class ComplexityEstimator {
+ public:
+  /** Score from which requests skip the fast model */
+  static constexpr int kStrongThreshold = 2;
+
+  /**
+   * @brief Estimate the complexity of a request
+   *
+   * @param natural_language The user's request
+   * @param mentioned_tables Number of schema tables named in the request
+   * @return Score and tier
+   */
+  static ComplexityEstimate estimate(std::string_view natural_language,
+                                     size_t mentioned_tables);
+};
+
+/**
+ * @brief Per-tier counters for model routing in this backend
+ *
+ * A request is "accepted" on a tier when that tier's answer was returned to
+ * the user; fast-tier requests that were not accepted were escalated to the
+ * strong model.
+ */
+class RoutingStats {
+ public:
+  struct Tier {
+    uint64_t requests = 0;
+    uint64_t accepted = 0;
+  };
+
+  /**
+   * @brief Record one model call
+   *
+   * @param tier Tier the call was made on
+   * @param accepted Whether its answer was usable
+   */
+  static void record(ModelTier tier, bool accepted);
+
+  static const Tier& fast();
+  static const Tier& strong();
+
+  /**
+   * @brief Counters and hit rates as a JSON object
+   *
+   * @return {"fast": {"requests", "accepted", "escalated", "hit_rate"},
+   *          "strong": {"requests", "accepted", "hit_rate"}}
+   */
+  static std::string toJson();
+
+  /**
+   * @brief Reset all counters (for testing only)
+   */
+  static void reset();
+
+ private:
+  static Tier fast_;
+  static Tier strong_;
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace pg_ai {
+
+/**
+ * @brief Kind of provider request; each kind has its own output budget
+ */
+enum class RequestKind { kGenerate, kExplain };
+
+/**
+ * @brief Adaptive max_tokens for provider requests
+ *
+ * Generation time grows with output length, while SQL answers rarely need
+ * more than a few hundred tokens. OutputBudget remembers the completion
+ * lengths of the last kWindow requests of each kind and caps the next request
+ * at their 95th percentile plus 50% headroom, never below kMinBudget and
+ * never above the configured max_tokens. Until kMinSamples completions have
+ * been recorded the configured value is used unchanged.
+ *
+ * A request that stops at its budget is retried once with the configured
+ * max_tokens, so the adaptive cap only trims runaway generations.
+ *
+ * @example
+ * auto& budgets = OutputBudget::forProcess();
+ * int max_tokens = budgets.budget(RequestKind::kGenerate, configured);
+ * // ... call the provider, retry with `configured` if truncated ...
+ * budgets.record(RequestKind::kGenerate, completion_tokens);
+ */
+class OutputBudget {
+ public:
+  /** Completions remembered per request kind */
+  static constexpr size_t kWindow = 64;
+  /** Completions needed before the budget adapts */
+  static constexpr size_t kMinSamples = 8;
+  /** Smallest adaptive budget */
+  static constexpr int kMinBudget = 256;
+
+  /**
+   * @brief Budget for the next request of a kind
+   *
+   * @param kind Request kind
+   * @param cap Configured max_tokens; the budget never exceeds it
+   * @return max_tokens to send with the request
+   */
+  int budget(RequestKind kind, int cap) const;
+
+  /**
+   * @brief Record the completion length of a finished request
+   *
+   * @param kind Request kind
+   * @param completion_tokens Output tokens reported by the provider
+   */
+  void record(RequestKind kind, int completion_tokens);
+
+  /**
+   * @brief Number of completions currently remembered for a kind
+   */
+  size_t samples(RequestKind kind) const;
+
+  /**
+   * @brief Rough token count of a completion, for providers that do not
+   * report usage
+   *
+   * @param text Completion text
+   * @return Estimated tokens (about four bytes per token)
+   */
+  static int estimateTokens(std::string_view text);
+
+  /**
+   * @brief Budgets shared by all requests in this backend
+   */
+  static OutputBudget& forProcess();
+
+ private:
+  struct Window {
+    std::array<int, kWindow> tokens{};
+    size_t count = 0;
+    size_t next = 0;
+  };
+
+  std::array<Window, 2> windows_;
+
+  const Window& window(RequestKind kind) const {
+    return windows_[static_cast<size_t>(kind)];
+  }
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace pg_ai {
+
+/**
+ * @brief Per-backend registry of prepared plans for generated queries
+ *
+ * Repeated requests (dashboards, history and template answers) produce the
+ * same SQL text again and again. PlanCache maps that text to the saved
+ * plan it was prepared into, so executing it again skips parsing, the
+ * read-only check and planning. PostgreSQL's plan cache still replans a
+ * saved plan when the tables it uses or the search_path change.
+ *
+ * At most `capacity` plans are kept; inserting into a full cache releases
+ * the least recently used plan.
+ *
+ * @example
+ * static PlanCache plans([](PlanCache::Plan plan) {
+ *   SPI_freeplan(static_cast<SPIPlanPtr>(plan));
+ * });
+ * auto plan = static_cast<SPIPlanPtr>(plans.find(sql));
+ * if (plan == nullptr) {
+ *   plan = SPI_prepare(sql.c_str(), 0, nullptr);
+ *   SPI_keepplan(plan);
+ *   plans.insert(sql, plan, capacity);
+ * }
+ */
+class PlanCache {
+ public:
+  /** Opaque saved plan (an SPIPlanPtr in the backend) */
+  using Plan = void*;
+
+  /**
+   * @param release Called with each plan the cache drops
+   */
+  explicit PlanCache(std::function<void(Plan)> release);
+
+  PlanCache(const PlanCache&) = delete;
+  PlanCache& operator=(const PlanCache&) = delete;
+
+  /**
+   * @brief The plan saved for a query, marked as most recently used
+   *
+   * @return The plan, or nullptr when none is saved
+   */
+  Plan find(std::string_view sql);
+
+  /**
+   * @brief Save a plan for a query
+   *
+   * A plan already saved for the query is released and replaced.
+   *
+   * @param sql Query text the plan was prepared from
+   * @param plan Saved plan; the cache releases it when dropping it
+   * @param capacity Plans kept at most; 0 releases all plans
+   */
+  void insert(std::string sql, Plan plan, size_t capacity);
+
+  /**
+   * @brief Release the plan saved for a query, if any
+   */
+  void erase(std::string_view sql);
+
+  /**
+   * @brief Release all plans
+   */
+  void clear();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::string sql;
+    Plan plan;
+  };
+
+  void evict(size_t capacity);
+
+  std::function<void(Plan)> release_;
+  /** Most recently used first */
+  std::list<Entry> entries_;
+  /** Keys view the sql of their entry */
+  std::map<std::string_view, std::list<Entry>::iterator, std::less<>> index_;
+};
+
+}  // namespace pg_ai
@@ -14,9 +14,10 @@ extern const std::string EXPLAIN_SYSTEM_PROMPT;
  * Returns the custom system prompt from configuration if available,
  * otherwise returns the default built-in SYSTEM_PROMPT.
  *
- * @return The system prompt to use for query generation
+ * @return Reference to the system prompt to use for query generation; valid
+ * until the configuration is reloaded
  */
-std::string getSystemPrompt();
+const std::string& getSystemPrompt();
 
 /**
  * @brief Get the system prompt for query explanation
@@ -24,8 +25,9 @@ std::string getSystemPrompt();
  * Returns the custom explain system prompt from configuration if available,
  * otherwise returns the default built-in EXPLAIN_SYSTEM_PROMPT.
  *
- * @return The system prompt to use for query explanation
+ * @return Reference to the system prompt to use for query explanation; valid
+ * until the configuration is reloaded
  */
-std::string getExplainSystemPrompt();
+const std::string& getExplainSystemPrompt();
 
 }  // namespace pg_ai::prompts
\ No newline at end of file
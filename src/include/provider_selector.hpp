@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include "config.hpp"
 
@@ -33,15 +34,15 @@ class ProviderSelector {
    * @return ProviderSelectionResult with selected provider, config, and API key
    */
   static ProviderSelectionResult selectProvider(
-      const std::string& api_key,
-      const std::string& provider_preference);
+      std::string_view api_key,
+      std::string_view provider_preference);
 
  private:
   static ProviderSelectionResult selectExplicitProvider(
-      const std::string& api_key,
+      std::string_view api_key,
       config::Provider provider);
 
-  static ProviderSelectionResult autoSelectProvider(const std::string& api_key);
+  static ProviderSelectionResult autoSelectProvider(std::string_view api_key);
 };
 
 }  // namespace pg_ai
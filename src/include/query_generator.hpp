@@ -1,22 +1,30 @@
 #pragma once
 
+#include <memory_resource>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
+// PostgreSQL's tuplestore, opaque outside the backend
+struct Tuplestorestate;
+
 namespace pg_ai {
 
 /**
  * @brief Request structure for natural language query generation
  *
  * Contains the input parameters needed to generate a SQL query from
- * natural language using AI providers.
+ * natural language using AI providers. Fields are views into caller-owned
+ * data (typically the SQL function's arguments) and must stay valid for the
+ * duration of the generateQuery() call.
  */
 struct QueryRequest {
-  std::string natural_language;
-  std::string api_key;
-  std::string provider;
+  std::string_view natural_language;
+  std::string_view api_key;
+  std::string_view provider;
 };
 
 /**
@@ -33,6 +41,11 @@ struct QueryResult {
   std::string suggested_visualization;
   bool success;
   std::string error_message;
+  /**
+   * "template" for the local fast path, "history" for an accepted query
+   * reused as is, "provider" for model answers
+   */
+  std::string source;
 };
 
 /**
@@ -40,12 +53,21 @@ struct QueryResult {
  *
  * Contains basic metadata about a table including name, schema,
  * type, and estimated row count.
+ *
+ * Schema structures use polymorphic allocators so a whole request's catalog
+ * data can live in a per-call memory resource (see RequestMemoryContext).
  */
 struct TableInfo {
-  std::string table_name;
-  std::string schema_name;
-  std::string table_type;
+  std::pmr::string table_name;
+  std::pmr::string schema_name;
+  std::pmr::string table_type;
   int64_t estimated_rows;
+  /** pg_class OID, used to invalidate cached schema data */
+  uint32_t relid = 0;
+  /** Row-level security filters the rows the current role can read */
+  bool row_security = false;
+  /** COMMENT ON TABLE, or empty */
+  std::pmr::string description;
 };
 
 /**
@@ -55,14 +77,16 @@ struct TableInfo {
  * data type, constraints, and foreign key relationships.
  */
 struct ColumnInfo {
-  std::string column_name;
-  std::string data_type;
+  std::pmr::string column_name;
+  std::pmr::string data_type;
   bool is_nullable;
-  std::string column_default;
+  std::pmr::string column_default;
   bool is_primary_key;
   bool is_foreign_key;
-  std::string foreign_table;
-  std::string foreign_column;
+  std::pmr::string foreign_table;
+  std::pmr::string foreign_column;
+  /** COMMENT ON COLUMN, or empty */
+  std::pmr::string description;
 };
 
 /**
@@ -72,12 +96,14 @@ struct ColumnInfo {
  * all columns, indexes, and retrieval status.
  */
 struct TableDetails {
-  std::string table_name;
-  std::string schema_name;
-  std::vector<ColumnInfo> columns;
-  std::vector<std::string> indexes;
+  std::pmr::string table_name;
+  std::pmr::string schema_name;
+  std::pmr::vector<ColumnInfo> columns;
+  std::pmr::vector<std::pmr::string> indexes;
   bool success;
   std::string error_message;
+  /** COMMENT ON TABLE, or empty */
+  std::pmr::string description;
 };
 
 /**
@@ -86,7 +112,7 @@ struct TableDetails {
  * Contains information about all accessible tables in the database.
  */
 struct DatabaseSchema {
-  std::vector<TableInfo> tables;
+  std::pmr::vector<TableInfo> tables;
   bool success;
   std::string error_message;
 };
@@ -94,12 +120,13 @@ struct DatabaseSchema {
 /**
  * @brief Request structure for query performance analysis
  *
- * Contains the SQL query to analyze and optional API configuration.
+ * Contains the SQL query to analyze and optional API configuration. Like
+ * QueryRequest, fields are views that must outlive the explainQuery() call.
  */
 struct ExplainRequest {
-  std::string query_text;
-  std::string api_key;
-  std::string provider;
+  std::string_view query_text;
+  std::string_view api_key;
+  std::string_view provider;
 };
 
 /**
@@ -116,6 +143,44 @@ struct ExplainResult {
   std::string error_message;
 };
 
+/**
+ * @brief A generated query to execute, with the limits applied to it
+ *
+ * The query is a view that must outlive the executeQuery() call.
+ */
+struct ExecuteRequest {
+  std::string_view query;
+  /** Rows returned at most; 0 for no cap */
+  int64_t max_rows;
+  /** Highest planner cost estimate that is executed; 0 for no limit */
+  double max_cost;
+};
+
+/**
+ * @brief Result of executing a generated query
+ */
+struct ExecuteResult {
+  /** Rows added to the tuplestore */
+  int64_t rows;
+  /** The query had more rows than max_rows */
+  bool truncated;
+  double estimated_cost;
+  bool success;
+  std::string error_message;
+};
+
+/**
+ * @brief Result of recording an accepted query
+ */
+struct AcceptResult {
+  int64_t id;
+  bool success;
+  std::string error_message;
+};
+
+class Conversation;
+struct SchemaMatch;
+
 /**
  * @brief Main class for SQL query generation and database schema operations
  *
@@ -135,6 +200,8 @@ class QueryGenerator {
    *
    * @param request The query request containing natural language input and
    * options
+   * @param memory Memory resource for per-call scratch data (schema, prompt
+   * fragments, parser buffers)
    * @return QueryResult containing the generated SQL query and metadata
    * @throws std::runtime_error if database connection fails or AI API call
    * fails
@@ -148,7 +215,9 @@ class QueryGenerator {
    *   std::cout << result.generated_query << std::endl;
    * }
    */
-  static QueryResult generateQuery(const QueryRequest& request);
+  static QueryResult generateQuery(
+      const QueryRequest& request,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
 
   /**
    * @brief Retrieve list of all accessible tables in the database
@@ -156,6 +225,7 @@ class QueryGenerator {
    * Queries PostgreSQL's information_schema to get metadata about all
    * tables accessible to the current user.
    *
+   * @param memory Memory resource the returned structures allocate from
    * @return DatabaseSchema containing all visible tables and their metadata
    * @throws std::runtime_error if database query fails
    *
@@ -167,7 +237,23 @@ class QueryGenerator {
    *   }
    * }
    */
-  static DatabaseSchema getDatabaseTables();
+  static DatabaseSchema getDatabaseTables(
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+  /**
+   * @brief Retrieve the listed tables only
+   *
+   * Same rows as getDatabaseTables(), restricted to the given pg_class
+   * OIDs. OIDs that are not (or no longer) visible base tables are absent
+   * from the result.
+   *
+   * @param relids OIDs of the tables to read
+   * @param memory Memory resource the returned structures allocate from
+   * @return DatabaseSchema with the matching tables, in the same order
+   */
+  static DatabaseSchema getDatabaseTables(
+      const std::vector<uint32_t>& relids,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
 
   /**
    * @brief Get detailed information about a specific table
@@ -177,6 +263,7 @@ class QueryGenerator {
    *
    * @param table_name Name of the table to inspect
    * @param schema_name Schema containing the table (defaults to "public")
+   * @param memory Memory resource the returned structures allocate from
    * @return TableDetails containing complete table schema information
    * @throws std::runtime_error if database query fails
    *
@@ -190,7 +277,30 @@ class QueryGenerator {
    */
   static TableDetails getTableDetails(
       const std::string& table_name,
-      const std::string& schema_name = "public");
+      const std::string& schema_name = "public",
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+  /**
+   * @brief Search table and column names in the cached schema
+   *
+   * Ranks with a SchemaIndex built from the cached table list and the table
+   * details already cached or in the schema snapshot; the index is kept
+   * until the schema version, the snapshot or the role changes. Columns of
+   * tables with no details at hand are not searched, so the catalogs are
+   * read at most for the table list of a cold session.
+   *
+   * @param query Name, name prefix or words to look for
+   * @param k Maximum number of matches
+   * @return Matches, best first
+   * @throws std::runtime_error if the table list can't be read
+   *
+   * @example
+   * for (const auto& match : QueryGenerator::searchSchema("cust", 10)) {
+   *   std::cout << match.table_name << " " << match.score << std::endl;
+   * }
+   */
+  static std::vector<SchemaMatch> searchSchema(std::string_view query,
+                                               size_t k);
 
   /**
    * @brief Analyze query performance and get optimization suggestions
@@ -214,6 +324,36 @@ class QueryGenerator {
    */
   static ExplainResult explainQuery(const ExplainRequest& request);
 
+  /**
+   * @brief Execute a generated query into a tuplestore, one jsonb per row
+   *
+   * The query must be a single SELECT without data-modifying CTEs or row
+   * locks; it runs read-only. Its cost estimate is checked against
+   * max_cost before execution, and rows are fetched from a cursor in
+   * batches, each converted with to_jsonb() and appended to the
+   * tuplestore, until max_rows is reached.
+   *
+   * @param request The query and its limits
+   * @param rows Tuplestore with a single jsonb column
+   * @return ExecuteResult with the number of rows returned
+   */
+  static ExecuteResult executeQuery(const ExecuteRequest& request,
+                                    Tuplestorestate* rows);
+
+  /**
+   * @brief Record an accepted (request, SQL) pair in pg_ai_query_history
+   *
+   * Accepted queries are retrieved as few-shot examples for similar
+   * requests against the same schema version, and returned directly for
+   * near-identical ones.
+   *
+   * @param natural_language The request the query answers
+   * @param query The accepted SQL
+   * @return AcceptResult with the new history row's id
+   */
+  static AcceptResult acceptQuery(std::string_view natural_language,
+                                  std::string_view query);
+
   /**
    * @brief Format database schema as text for AI consumption
    *
@@ -221,9 +361,12 @@ class QueryGenerator {
    * for including in prompts sent to AI models.
    *
    * @param schema The database schema to format
+   * @param memory Memory resource the returned string allocates from
    * @return Formatted string representation of the schema
    */
-  static std::string formatSchemaForAI(const DatabaseSchema& schema);
+  static std::pmr::string formatSchemaForAI(
+      const DatabaseSchema& schema,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
 
   /**
    * @brief Format table details as text for AI consumption
@@ -232,18 +375,36 @@ class QueryGenerator {
    * for including in prompts sent to AI models.
    *
    * @param details The table details to format
+   * @param memory Memory resource the returned string allocates from
    * @return Formatted string representation of the table details
    */
-  static std::string formatTableDetailsForAI(const TableDetails& details);
+  static std::pmr::string formatTableDetailsForAI(
+      const TableDetails& details,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
 
  private:
   /**
    * @brief Build AI prompt with schema context and query request
    *
    * @param request Query request containing natural language description
+   * @param schema Tables of the database (may be unsuccessful)
+   * @param mentioned Tables of schema named in the request
+   * @param examples Few-shot examples section (may be empty)
+   * @param conversation The session's conversation; tables described in
+   *        the prompt are added to it
+   * @param follow_up Send the conversation context and only the tables new
+   *        to it, instead of the full table list
+   * @param memory Memory resource for intermediate schema context
    * @return Complete prompt string ready for AI API
    */
-  static std::string buildPrompt(const QueryRequest& request);
+  static std::string buildPrompt(
+      const QueryRequest& request,
+      const DatabaseSchema& schema,
+      const std::pmr::vector<const TableInfo*>& mentioned,
+      std::string_view examples,
+      Conversation& conversation,
+      bool follow_up,
+      std::pmr::memory_resource* memory);
 
   /**
    * @brief Log model configuration settings
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "query_generator.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief An accepted (request, SQL) pair from the query history
+ */
+struct HistoryExample {
+  std::string natural_language;
+  std::string query;
+  /** Trigram similarity to the current request, 0-1 */
+  double similarity = 0.0;
+};
+
+/**
+ * @brief Word trigrams of a text, as pg_trgm computes them
+ *
+ * The text is lowercased and split into words of letters and digits; each
+ * word is padded with two spaces in front and one behind, and every three
+ * consecutive bytes form a trigram. "Orders" and "orders?" have the same
+ * set.
+ */
+class TrigramSet {
+ public:
+  explicit TrigramSet(std::string_view text);
+
+  /**
+   * @brief Shared trigrams over all distinct trigrams of both sets
+   *
+   * @return Similarity from 0 to 1; 0 when either set is empty
+   */
+  double similarity(const TrigramSet& other) const;
+
+  size_t size() const { return trigrams_.size(); }
+
+ private:
+  /** Sorted, unique; three bytes packed per trigram */
+  std::vector<uint32_t> trigrams_;
+};
+
+/**
+ * @brief Retrieval over accepted queries for few-shot prompting
+ */
+class QueryHistory {
+ public:
+  /** Most recent accepted queries compared against each request */
+  static constexpr size_t kMaxCandidates = 1000;
+
+  /**
+   * @brief The k candidates most similar to a request
+   *
+   * Candidates are expected newest first; among equally similar examples
+   * the newer one wins, and only the newest example of a repeated request
+   * is kept.
+   *
+   * @param natural_language The user's request
+   * @param candidates Accepted queries for the current schema version
+   * @param k Maximum number of examples to return
+   * @param min_similarity Examples less similar than this are dropped
+   * @return Examples with their similarity set, most similar first
+   */
+  static std::vector<HistoryExample> nearest(
+      std::string_view natural_language,
+      std::vector<HistoryExample> candidates,
+      size_t k,
+      double min_similarity);
+
+  /**
+   * @brief Format examples as few-shot context for the user prompt
+   *
+   * @return Prompt section, or an empty string for no examples
+   */
+  static std::string formatExamples(
+      const std::vector<HistoryExample>& examples);
+
+  /**
+   * @brief Fingerprint of the tables a query may refer to
+   *
+   * Accepted queries are only reused while the set of tables they were
+   * accepted against is unchanged.
+   *
+   * @return 16 hex digits, or an empty string when the schema is unknown
+   */
+  static std::string schemaVersion(const DatabaseSchema& schema);
+};
+
+}  // namespace pg_ai
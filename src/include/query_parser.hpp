@@ -34,6 +34,10 @@ class QueryParser {
   /**
    * @brief Parse a JSON response into a QueryResult struct
    *
+   * Accepts the same formats as extractSQLFromResponse(), but streams the
+   * JSON through a SAX parser and moves only the known top-level fields
+   * into the result instead of building a JSON document.
+   *
    * @param response_text The raw response text from the LLM
    * @return QueryResult with parsed fields and success/error status
    */
@@ -42,6 +46,8 @@ class QueryParser {
   /**
    * @brief Check if a SQL query accesses system tables
    *
+   * Case-insensitive; the query text is scanned in place.
+   *
    * @param sql The SQL query to check
    * @return true if the query accesses information_schema or pg_catalog
    */
@@ -50,6 +56,8 @@ class QueryParser {
   /**
    * @brief Check if an explanation indicates an error condition
    *
+   * Case-insensitive; the texts are scanned in place.
+   *
    * @param explanation The explanation text to check
    * @param warnings Vector of warning messages
    * @return true if error indicators are found
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "query_generator.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief Request shapes the template engine can answer without a provider
+ */
+enum class TemplateShape {
+  kNone,
+  /** "how many orders are there" */
+  kCount,
+  /** "top 5 products by price" */
+  kTopN,
+  /** "orders in the last 7 days" */
+  kRecent,
+  /** "get user with id 42" */
+  kLookup
+};
+
+/**
+ * @brief A request answered from a template
+ */
+struct TemplateMatch {
+  TemplateShape shape = TemplateShape::kNone;
+  std::string sql;
+  std::string explanation;
+  bool row_limit_applied = false;
+  /** 1.0 when every word of the request was understood */
+  double confidence = 0.0;
+};
+
+/**
+ * @brief Deterministic SQL for common single-table request shapes
+ *
+ * Every word of the request must be accounted for: common filler ("show",
+ * "all", "the"), the table name, words of the detected shape, and the
+ * column or value it refers to. Each remaining word halves the confidence,
+ * since it is usually a filter or grouping the template would silently
+ * drop; a timestamp column chosen by name rather than named in the request
+ * costs 10%. Callers compare the confidence against their threshold and
+ * fall back to a provider below it.
+ */
+class QueryTemplates {
+ public:
+  /**
+   * @brief Detect the shape of a request from its wording alone
+   *
+   * Cheap enough to run before any catalog lookup.
+   *
+   * @param natural_language The user's request
+   * @return The shape, or kNone
+   */
+  static TemplateShape detect(std::string_view natural_language);
+
+  /**
+   * @brief Build SQL for a request against one table
+   *
+   * @param natural_language The user's request
+   * @param table Columns of the table the request names
+   * @param row_limit LIMIT for multi-row results, or nullopt for none
+   * @return The match, or nullopt when the shape, table, column or value
+   *         cannot be resolved
+   */
+  static std::optional<TemplateMatch> match(std::string_view natural_language,
+                                            const TableDetails& table,
+                                            std::optional<int> row_limit);
+
+  /**
+   * @brief Lowercase name of a shape ("count", "top_n", ...)
+   */
+  static const char* shapeName(TemplateShape shape);
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "glossary.hpp"
+#include "join_graph.hpp"
+#include "query_generator.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief Per-backend cache of catalog reads used for prompts
+ *
+ * Holds the table list and the table details read for earlier requests,
+ * tagged with the schema version they were read at. Before each use the
+ * cache is advanced to the current version: data for relations changed in
+ * between is read again, the rest is reused without touching the catalogs.
+ * Changed rows of the table list are patched in place, so keeping it
+ * current costs a read of the changed tables, not of the whole database.
+ *
+ * @example
+ * auto& cache = SchemaCache::forRole(GetUserId());
+ * cache.advance(version, changed);
+ * if (!cache.staleTables().empty()) {
+ *   cache.patchTables(QueryGenerator::getDatabaseTables(cache.staleTables()));
+ * }
+ * if (const auto* tables = cache.tables()) {
+ *   ...
+ * }
+ */
+class SchemaCache {
+ public:
+  /**
+   * @brief Move to a newer schema version
+   *
+   * Marks the changed tables' rows of the table list as stale, and drops
+   * the details of changed tables and of tables with foreign keys to them.
+   *
+   * @param version The current schema version
+   * @param changed Sorted OIDs of relations changed since version(), or
+   *        std::nullopt when they are unknown; everything is dropped then
+   */
+  void advance(uint64_t version,
+               const std::optional<std::vector<uint32_t>>& changed);
+
+  /**
+   * @brief Version the cached data is valid for, if any was set
+   */
+  std::optional<uint64_t> version() const { return version_; }
+
+  /**
+   * @brief The cached table list, or nullptr while absent or stale
+   */
+  const DatabaseSchema* tables() const;
+
+  /**
+   * @brief Cache a successfully read table list
+   */
+  void storeTables(const DatabaseSchema& schema);
+
+  /**
+   * @brief Cache a table list read at an older schema version
+   *
+   * @param schema The table list
+   * @param stale Sorted OIDs of relations changed since it was read; their
+   *        rows are patched before tables() returns the list
+   */
+  void storeTables(const DatabaseSchema& schema,
+                   const std::vector<uint32_t>& stale);
+
+  /**
+   * @brief OIDs of tables whose rows in the table list must be read again
+   */
+  const std::vector<uint32_t>& staleTables() const { return stale_; }
+
+  /**
+   * @brief Replace the stale rows of the table list
+   *
+   * @param fresh The stale tables read again (see
+   *        QueryGenerator::getDatabaseTables(relids)); tables missing from
+   *        it were dropped. If the read failed, the whole list is dropped.
+   */
+  void patchTables(const DatabaseSchema& fresh);
+
+  /**
+   * @brief The cached details of a table, or nullptr
+   */
+  const TableDetails* details(std::string_view schema_name,
+                              std::string_view table_name) const;
+
+  /**
+   * @brief Cache successfully read table details
+   *
+   * Only tables in the cached table list are kept, since their OID is
+   * needed to invalidate them.
+   */
+  void storeDetails(const TableDetails& details);
+
+  /**
+   * @brief The cached glossary, or nullptr
+   */
+  const Glossary* glossary() const {
+    return glossary_ ? &*glossary_ : nullptr;
+  }
+
+  /**
+   * @brief Cache the glossary
+   *
+   * @param relid OID of the glossary table; its triggers report changes to
+   *        it like DDL, which drops the cached copy
+   */
+  void storeGlossary(uint32_t relid, Glossary glossary);
+
+  /**
+   * @brief The cached foreign key graph, or nullptr
+   */
+  const JoinGraph* joinGraph() const {
+    return join_graph_ ? &*join_graph_ : nullptr;
+  }
+
+  /**
+   * @brief Cache the foreign key graph
+   *
+   * Any change to a table drops it, since a new foreign key is only
+   * reported as a change of the table it is added to.
+   */
+  void storeJoinGraph(JoinGraph graph);
+
+  /**
+   * @brief Drop all cached data and the version
+   */
+  void clear();
+
+  /** Roles forRole() keeps caches for in a backend */
+  static constexpr size_t kMaxRoles = 8;
+
+  /**
+   * @brief The backend's cache for a role
+   *
+   * Catalog reads only return what the role can read, so each role has its
+   * own cache. The least recently used one is dropped beyond kMaxRoles.
+   * Role membership changes can change what any role reads, so all caches
+   * are dropped when memberships differs from the previous call.
+   *
+   * @param role OID of the role
+   * @param memberships schema_version::roleGeneration()
+   */
+  static SchemaCache& forRole(uint32_t role, uint64_t memberships = 0);
+
+ private:
+  struct CachedDetails {
+    uint32_t relid;
+    TableDetails details;
+  };
+
+  std::optional<uint64_t> version_;
+  std::optional<DatabaseSchema> tables_;
+  /** Sorted */
+  std::vector<uint32_t> stale_;
+  /** Keyed by schema-qualified table name */
+  std::map<std::string, CachedDetails, std::less<>> details_;
+  std::optional<Glossary> glossary_;
+  uint32_t glossary_relid_ = 0;
+  std::optional<JoinGraph> join_graph_;
+};
+
+}  // namespace pg_ai
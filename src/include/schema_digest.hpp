@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include "query_generator.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief JSON form of table details stored in the schema digest
+ *
+ * The digest worker stores each table's details in
+ * pg_ai_query_schema_digest.details so backends can rebuild them with one
+ * indexed lookup instead of the information_schema joins. The layout is
+ * the one get_table_details() returns.
+ *
+ * @example
+ * std::string stored = SchemaDigest::toJson(details).dump();
+ * auto restored = SchemaDigest::fromJson(stored, memory);
+ */
+class SchemaDigest {
+ public:
+  /**
+   * @brief Serialize table details
+   *
+   * @return {"table_name", "schema_name", "columns": [...], "indexes": [...]}
+   */
+  static nlohmann::json toJson(const TableDetails& details);
+
+  /**
+   * @brief Rebuild table details from their stored JSON
+   *
+   * @param json Text previously produced by toJson()
+   * @param memory Memory resource the returned structures allocate from
+   * @return Successful details, or std::nullopt if the text is malformed
+   */
+  static std::optional<TableDetails> fromJson(
+      std::string_view json,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "glossary.hpp"
+#include "query_generator.hpp"
+#include "query_history.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief A table or column found by SchemaIndex::search()
+ */
+struct SchemaMatch {
+  std::string schema_name;
+  std::string table_name;
+  /** Empty for a table */
+  std::string column_name;
+  /** Relevance, 0-1 */
+  double score = 0.0;
+  /** Short description: row estimate for tables, type and keys for columns */
+  std::string snippet;
+};
+
+/**
+ * @brief Relevance index over table and column names
+ *
+ * Built once from a table list and whatever table details are at hand, then
+ * searched without touching the catalogs. A name scores 1 when it equals the
+ * query, at least 0.5 when it starts with it (for autocomplete), and
+ * otherwise its trigram similarity to the query; columns are matched on
+ * "table column", so "customer email" finds customers.email. Glossary
+ * terms are indexed as further names of the tables and columns they refer
+ * to.
+ *
+ * @example
+ * SchemaIndex index(schema, details);
+ * for (const auto& match : index.search("cust", 10)) {
+ *   ...
+ * }
+ */
+class SchemaIndex {
+ public:
+  /** Matches scoring less than this are not returned */
+  static constexpr double kMinScore = 0.1;
+
+  /**
+   * @brief Index the tables and the columns of the given details
+   *
+   * @param schema Table list
+   * @param details Details of some of the listed tables; columns of tables
+   *        without details are not searchable
+   * @param glossary Business terms; those of unlisted tables are ignored
+   */
+  SchemaIndex(const DatabaseSchema& schema,
+              const std::vector<TableDetails>& details,
+              const Glossary& glossary = Glossary());
+
+  /**
+   * @brief The k best matches for a query
+   *
+   * @return Best first; equal scores list tables before columns, then by
+   *         name
+   */
+  std::vector<SchemaMatch> search(std::string_view query, size_t k) const;
+
+  /**
+   * @brief Number of indexed tables and columns
+   */
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    SchemaMatch match;
+    /** Lower-cased name compared against the query as a whole */
+    std::string name;
+    TrigramSet trigrams;
+  };
+
+  std::vector<Entry> entries_;
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "query_generator.hpp"
+
+namespace pg_ai {
+
+/**
+ * @brief Read-only, memory-mapped binary copy of a database's schema
+ *
+ * The digest worker writes the table list and every table's details to one
+ * flat file: fixed-size table, column and index records that refer to a
+ * shared string pool by offset, and a table index sorted by OID. Backends
+ * map the file read-only, so all of them share one copy through the page
+ * cache, and a backend without cached schema data can take the table list
+ * or a table's details from it without querying the catalogs. Nothing is
+ * parsed: records are read in place and copied out only on request.
+ *
+ * The file is tagged with the schema version it was written at; callers
+ * must treat tables changed since then (see schema_version::changedSince)
+ * as absent.
+ *
+ * @example
+ * SchemaSnapshot::write(path, SchemaSnapshot::serialize(version, schema,
+ *                                                       details));
+ * if (auto snapshot = SchemaSnapshot::open(path)) {
+ *   auto tables = snapshot->tables(memory);
+ *   auto orders = snapshot->details(relid, memory);
+ * }
+ */
+class SchemaSnapshot {
+ public:
+  SchemaSnapshot(SchemaSnapshot&& other) noexcept;
+  SchemaSnapshot& operator=(SchemaSnapshot&& other) noexcept;
+  SchemaSnapshot(const SchemaSnapshot&) = delete;
+  SchemaSnapshot& operator=(const SchemaSnapshot&) = delete;
+  ~SchemaSnapshot();
+
+  /**
+   * @brief Lay out a schema in the snapshot format
+   *
+   * @param version Schema version the data is at least as new as
+   * @param schema Table list, in getDatabaseTables() order
+   * @param details Details of listed tables by OID; tables without an
+   *        entry are stored without details
+   * @return The file contents
+   */
+  static std::string serialize(
+      uint64_t version,
+      const DatabaseSchema& schema,
+      const std::map<uint32_t, TableDetails>& details);
+
+  /**
+   * @brief Replace a snapshot file
+   *
+   * Writes a temporary file next to path and renames it over path, so
+   * readers see either the old or the new file, never a partial one.
+   *
+   * @return Whether the file was replaced
+   */
+  static bool write(const std::string& path, std::string_view contents);
+
+  /**
+   * @brief Map a snapshot file
+   *
+   * @return The snapshot, or std::nullopt if the file is missing, from
+   *         another format version, or inconsistent
+   */
+  static std::optional<SchemaSnapshot> open(const std::string& path);
+
+  /**
+   * @brief Schema version the snapshot was written at
+   */
+  uint64_t version() const;
+
+  /**
+   * @brief Number of tables in the snapshot
+   */
+  size_t tableCount() const;
+
+  /**
+   * @brief Whether path now names a different file than the one mapped
+   */
+  bool replaced(const std::string& path) const;
+
+  /**
+   * @brief Copy out the table list, in getDatabaseTables() order
+   */
+  DatabaseSchema tables(std::pmr::memory_resource* memory =
+                            std::pmr::get_default_resource()) const;
+
+  /**
+   * @brief Copy out a table's details
+   *
+   * @param relid OID of the table
+   * @return The details, or std::nullopt if the table isn't in the
+   *         snapshot or was stored without details
+   */
+  std::optional<TableDetails> details(
+      uint32_t relid,
+      std::pmr::memory_resource* memory =
+          std::pmr::get_default_resource()) const;
+
+ private:
+  SchemaSnapshot(const std::byte* data, size_t size, uint64_t device,
+                 uint64_t inode);
+
+  const std::byte* data_;
+  size_t size_;
+  uint64_t device_;
+  uint64_t inode_;
+};
+
+}  // namespace pg_ai
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace pg_ai::schema_version {
+
+/**
+ * @brief Reserve the shared schema version state
+ *
+ * Called from _PG_init(). Only takes effect while the library is loaded
+ * through shared_preload_libraries; otherwise available() stays false and
+ * schema caches are not used.
+ */
+void requestSharedMemory();
+
+/**
+ * @brief Whether the shared schema version exists in this server
+ */
+bool available();
+
+/**
+ * @brief Schema version of the current database
+ *
+ * Each database has its own version. It advances when a transaction that
+ * ran DDL affecting schema context (tables, columns, indexes, schemas,
+ * policies, grants) commits, after the change is visible to other
+ * backends. Versions start from the server start time in microseconds, so
+ * they never repeat across restarts. After a clean shutdown they continue
+ * where they stopped instead, together with the change log, so data tagged
+ * with a version before the restart can still be validated.
+ *
+ * Catalog data read with a fresh snapshot after this call is at least as
+ * new as the returned version.
+ *
+ * @return The version, or std::nullopt without shared memory
+ */
+std::optional<uint64_t> current();
+
+/**
+ * @brief Relations of the current database changed after a version
+ *
+ * @param version A version previously returned by current()
+ * @return Sorted OIDs of the changed relations, or std::nullopt when the
+ *         change log no longer covers the version (including versions from
+ *         before a crash) or recorded a change to every relation; callers
+ *         then drop everything derived from it
+ */
+std::optional<std::vector<uint32_t>> changedSince(uint64_t version);
+
+/**
+ * @brief Note the relations changed by the command firing an event trigger
+ *
+ * Reads pg_event_trigger_ddl_commands() for ddl_command_end and
+ * pg_event_trigger_dropped_objects() for sql_drop. The changes are applied
+ * to the shared version when the transaction commits and discarded if it
+ * aborts or is prepared: two-phase commit is not tracked.
+ *
+ * @param sql_drop Called for sql_drop rather than ddl_command_end
+ */
+void recordEventTrigger(bool sql_drop);
+
+/**
+ * @brief Note a change to a relation's data that schema caches depend on
+ *
+ * For tables like pg_ai_query_glossary whose rows feed cached prompt
+ * context; called from their statement triggers. Applied at commit like
+ * recordEventTrigger().
+ *
+ * @param relation OID of the changed table
+ */
+void recordChange(uint32_t relation);
+
+/**
+ * @brief Role membership changes seen by this backend
+ *
+ * GRANT role TO user, REVOKE role FROM user and ALTER ROLE change what a
+ * role may read without firing an event trigger, so they do not advance the
+ * schema version. They do invalidate the pg_auth_members and pg_authid
+ * caches of every backend, which advances this count. Data filtered by the
+ * current role's privileges is dropped when it moves.
+ *
+ * Works without shared_preload_libraries.
+ *
+ * @return A count that only grows
+ */
+uint64_t roleGeneration();
+
+}  // namespace pg_ai::schema_version
@@ -7,6 +7,7 @@ extern "C" {
 }
 
 #include <string>
+#include <string_view>
 
 namespace pg_ai {
 
@@ -99,4 +100,50 @@ class SPIValue {
   char* value_;
 };
 
+/**
+ * @brief Typed, zero-copy accessors for one row of an SPI result
+ *
+ * Reads attributes as binary Datums with SPI_getbinval instead of running
+ * each type's output function through SPI_getvalue. The query must cast
+ * every column to the type its accessor expects (name, text, bool, int8).
+ *
+ * Returned string_views point into the tuple (or into a detoasted copy in
+ * the current memory context) and are only valid until SPI_finish().
+ * NULL attributes read as an empty view, false, or 0.
+ */
+class SPIRow {
+ public:
+  SPIRow(HeapTuple tuple, TupleDesc tupdesc)
+      : tuple_(tuple), tupdesc_(tupdesc) {}
+
+  /**
+   * @brief Check whether the attribute is NULL
+   */
+  bool isNull(int column) const;
+
+  /**
+   * @brief Read a name attribute
+   */
+  std::string_view getName(int column) const;
+
+  /**
+   * @brief Read a text attribute without copying it when not toasted
+   */
+  std::string_view getText(int column) const;
+
+  /**
+   * @brief Read a bool attribute
+   */
+  bool getBool(int column) const;
+
+  /**
+   * @brief Read an int8 attribute
+   */
+  int64 getInt64(int column) const;
+
+ private:
+  HeapTuple tuple_;
+  TupleDesc tupdesc_;
+};
+
 }  // namespace pg_ai
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace pg_ai::utils {
@@ -65,4 +66,40 @@ std::string read_file_or_throw(const std::string& filepath);
  */
 std::string formatAPIError(const std::string& raw_error);
 
+/**
+ * @brief Append a string to a buffer as a quoted, escaped JSON string
+ *
+ * Writes straight into the caller's (typically pre-reserved) buffer so large
+ * values such as prompts can be serialized without building a JSON DOM or
+ * copying them first. Quotes, backslashes and control characters are
+ * escaped; UTF-8 bytes pass through unchanged.
+ *
+ * @param out Buffer to append to
+ * @param value Raw string value
+ *
+ * @example
+ * std::string body = "{\"text\":";
+ * appendJsonString(body, "say \"hi\"");
+ * body += '}';
+ * // body == {"text":"say \"hi\""}
+ */
+void appendJsonString(std::string& out, std::string_view value);
+
+/**
+ * @brief Shorten free text, such as a comment, to one line for a prompt
+ *
+ * Runs of whitespace, including newlines, become single spaces. Text longer
+ * than max_length bytes is cut at the last word boundary (or UTF-8
+ * character) that fits and ends with "...", so the result never exceeds
+ * max_length + 3 bytes.
+ *
+ * @param text Text to shorten
+ * @param max_length Maximum bytes kept from the text
+ *
+ * @example
+ * oneLine("Amount in cents.\nNever negative.", 22);
+ * // "Amount in cents. Never..."
+ */
+std::string oneLine(std::string_view text, size_t max_length);
+
 }  // namespace pg_ai::utils
\ No newline at end of file
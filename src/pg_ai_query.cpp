@@ -3,27 +3,89 @@ extern "C" {
 
 #include <access/htup_details.h>
 #include <catalog/pg_type.h>
+#include <commands/event_trigger.h>
+#include <commands/trigger.h>
 #include <fmgr.h>
 #include <funcapi.h>
 #include <miscadmin.h>
 #include <utils/builtins.h>
 #include <utils/elog.h>
 #include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/tuplestore.h>
+#if PG_VERSION_NUM >= 160000
+#include <varatt.h>
+#endif
 }
 
+#include <string_view>
+
 #include <nlohmann/json.hpp>
 
 #include "include/config.hpp"
+#include "include/conversation.hpp"
+#include "include/digest_worker.hpp"
+#include "include/guc.hpp"
+#include "include/memory_context.hpp"
+#include "include/model_routing.hpp"
 #include "include/query_generator.hpp"
 #include "include/response_formatter.hpp"
+#include "include/schema_digest.hpp"
+#include "include/schema_index.hpp"
+#include "include/schema_version.hpp"
+
+namespace {
+
+// View of a (detoasted) text argument's bytes, valid for the rest of the
+// call, so arguments are not copied into C strings and again into
+// std::strings.
+std::string_view textArgView(const text* arg, std::string_view fallback = {}) {
+  if (arg == nullptr) {
+    return fallback;
+  }
+  return std::string_view(VARDATA_ANY(arg), VARSIZE_ANY_EXHDR(arg));
+}
+
+Datum stringToTextDatum(std::string_view value) {
+  return PointerGetDatum(
+      cstring_to_text_with_len(value.data(), static_cast<int>(value.size())));
+}
+
+}  // namespace
 
 extern "C" {
 PG_MODULE_MAGIC;
 
 PG_FUNCTION_INFO_V1(generate_query);
+PG_FUNCTION_INFO_V1(ai_query);
 PG_FUNCTION_INFO_V1(get_database_tables);
 PG_FUNCTION_INFO_V1(get_table_details);
 PG_FUNCTION_INFO_V1(explain_query);
+PG_FUNCTION_INFO_V1(get_routing_stats);
+PG_FUNCTION_INFO_V1(accept_query);
+PG_FUNCTION_INFO_V1(reset_conversation);
+PG_FUNCTION_INFO_V1(get_schema_version);
+PG_FUNCTION_INFO_V1(pg_ai_query_schema_changed);
+PG_FUNCTION_INFO_V1(pg_ai_query_glossary_changed);
+PG_FUNCTION_INFO_V1(refresh_schema_digest);
+PG_FUNCTION_INFO_V1(search_schema);
+
+void _PG_init(void);
+
+/**
+ * _PG_init()
+ *
+ * Registers the pg_ai_query.* GUCs, seeded from ~/.pg_ai.config when it
+ * exists. Loaded via shared_preload_libraries, this runs once in the
+ * postmaster and backends inherit the configuration instead of reading the
+ * file on first use, the shared schema version is set up and the schema
+ * digest worker is registered.
+ */
+void _PG_init(void) {
+  pg_ai::guc::defineVariables();
+  pg_ai::schema_version::requestSharedMemory();
+  pg_ai::digest_worker::registerWorker();
+}
 
 /**
  * generate_query(natural_language_query text, api_key text DEFAULT NULL,
@@ -35,19 +97,22 @@ PG_FUNCTION_INFO_V1(explain_query);
  */
 Datum generate_query(PG_FUNCTION_ARGS) {
   try {
+    pg_ai::guc::reloadIfNeeded();
+
+    // Per-call scratch (schema, prompt fragments, parser buffers) is released
+    // in one MemoryContextDelete, or by PostgreSQL's error cleanup.
+    pg_ai::RequestMemoryContext request_memory;
+
     text* nl_query_arg = PG_GETARG_TEXT_PP(0);
     text* api_key_arg = PG_ARGISNULL(1) ? nullptr : PG_GETARG_TEXT_PP(1);
     text* provider_arg = PG_ARGISNULL(2) ? nullptr : PG_GETARG_TEXT_PP(2);
 
-    std::string nl_query = text_to_cstring(nl_query_arg);
-    std::string api_key = api_key_arg ? text_to_cstring(api_key_arg) : "";
-    std::string provider =
-        provider_arg ? text_to_cstring(provider_arg) : "auto";
+    pg_ai::QueryRequest request{.natural_language = textArgView(nl_query_arg),
+                                .api_key = textArgView(api_key_arg),
+                                .provider = textArgView(provider_arg, "auto")};
 
-    pg_ai::QueryRequest request{
-        .natural_language = nl_query, .api_key = api_key, .provider = provider};
-
-    auto result = pg_ai::QueryGenerator::generateQuery(request);
+    auto result = pg_ai::QueryGenerator::generateQuery(
+        request, request_memory.resource());
 
     if (!result.success) {
       ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
@@ -65,7 +130,104 @@ Datum generate_query(PG_FUNCTION_ARGS) {
       PG_RETURN_TEXT_P(cstring_to_text(""));
     }
 
-    PG_RETURN_TEXT_P(cstring_to_text(formatted_response.c_str()));
+    PG_RETURN_DATUM(stringToTextDatum(formatted_response));
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+
+/**
+ * ai_query(natural_language_query text, api_key text DEFAULT NULL,
+ * provider text DEFAULT 'auto', max_rows integer DEFAULT NULL)
+ *
+ * Generates a query like generate_query and returns its result, one jsonb
+ * object per row. Rows are capped at max_rows, or at default_limit while
+ * enforce_limit is on.
+ */
+Datum ai_query(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+
+    auto* rsinfo = reinterpret_cast<ReturnSetInfo*>(fcinfo->resultinfo);
+    if (rsinfo == nullptr || !IsA(rsinfo, ReturnSetInfo) ||
+        !(rsinfo->allowedModes & SFRM_Materialize)) {
+      ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                      errmsg("ai_query must be called in a context that "
+                             "accepts a set")));
+    }
+
+    const auto& config = pg_ai::config::ConfigManager::getConfig();
+    int64_t max_rows = config.enforce_limit ? config.default_limit : 0;
+    if (!PG_ARGISNULL(3)) {
+      max_rows = PG_GETARG_INT32(3);
+      if (max_rows <= 0) {
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                        errmsg("max_rows must be positive")));
+      }
+    }
+
+    pg_ai::RequestMemoryContext request_memory;
+
+    text* nl_query_arg = PG_GETARG_TEXT_PP(0);
+    text* api_key_arg = PG_ARGISNULL(1) ? nullptr : PG_GETARG_TEXT_PP(1);
+    text* provider_arg = PG_ARGISNULL(2) ? nullptr : PG_GETARG_TEXT_PP(2);
+
+    pg_ai::QueryRequest request{.natural_language = textArgView(nl_query_arg),
+                                .api_key = textArgView(api_key_arg),
+                                .provider = textArgView(provider_arg, "auto")};
+
+    auto result = pg_ai::QueryGenerator::generateQuery(
+        request, request_memory.resource());
+
+    if (!result.success) {
+      ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
+                      errmsg("Query generation failed: %s",
+                             result.error_message.c_str())));
+    }
+
+    // The result set is read after this call returns, so it lives in the
+    // per-query memory context
+    MemoryContext old_context =
+        MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+    TupleDesc tupdesc = CreateTemplateTupleDesc(1);
+    TupleDescInitEntry(tupdesc, 1, "ai_query", JSONBOID, -1, 0);
+    Tuplestorestate* rows = tuplestore_begin_heap(
+        (rsinfo->allowedModes & SFRM_Materialize_Random) != 0, false,
+        work_mem);
+    MemoryContextSwitchTo(old_context);
+
+    rsinfo->returnMode = SFRM_Materialize;
+    rsinfo->setResult = rows;
+    rsinfo->setDesc = tupdesc;
+
+    if (result.generated_query.empty()) {
+      ereport(INFO, (errmsg("%s", result.explanation.c_str())));
+      return (Datum)0;
+    }
+
+    auto executed = pg_ai::QueryGenerator::executeQuery(
+        pg_ai::ExecuteRequest{.query = result.generated_query,
+                              .max_rows = max_rows,
+                              .max_cost = config.max_query_cost},
+        rows);
+
+    if (!executed.success) {
+      ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
+                      errmsg("Generated query was not executed: %s",
+                             executed.error_message.c_str()),
+                      errdetail("Query: %s", result.generated_query.c_str())));
+    }
+
+    if (executed.truncated) {
+      ereport(NOTICE,
+              (errmsg("ai_query returned the first %lld rows",
+                      static_cast<long long>(executed.rows)),
+               errhint("Pass max_rows to return more.")));
+    }
+
+    return (Datum)0;
   } catch (const std::exception& e) {
     ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
                     errmsg("Internal error: %s", e.what())));
@@ -80,7 +242,10 @@ Datum generate_query(PG_FUNCTION_ARGS) {
  */
 Datum get_database_tables(PG_FUNCTION_ARGS) {
   try {
-    auto result = pg_ai::QueryGenerator::getDatabaseTables();
+    pg_ai::guc::reloadIfNeeded();
+    pg_ai::RequestMemoryContext request_memory;
+    auto result =
+        pg_ai::QueryGenerator::getDatabaseTables(request_memory.resource());
 
     if (!result.success) {
       ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
@@ -96,11 +261,15 @@ Datum get_database_tables(PG_FUNCTION_ARGS) {
       table_json["schema_name"] = table.schema_name;
       table_json["table_type"] = table.table_type;
       table_json["estimated_rows"] = table.estimated_rows;
+      table_json["row_security"] = table.row_security;
+      if (!table.description.empty()) {
+        table_json["description"] = table.description;
+      }
       json_result.push_back(table_json);
     }
 
     std::string json_string = json_result.dump(2);
-    PG_RETURN_TEXT_P(cstring_to_text(json_string.c_str()));
+    PG_RETURN_DATUM(stringToTextDatum(json_string));
 
   } catch (const std::exception& e) {
     ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
@@ -117,6 +286,9 @@ Datum get_database_tables(PG_FUNCTION_ARGS) {
  */
 Datum get_table_details(PG_FUNCTION_ARGS) {
   try {
+    pg_ai::guc::reloadIfNeeded();
+    pg_ai::RequestMemoryContext request_memory;
+
     text* table_name_arg = PG_GETARG_TEXT_PP(0);
     text* schema_name_arg = PG_ARGISNULL(1) ? nullptr : PG_GETARG_TEXT_PP(1);
 
@@ -124,8 +296,8 @@ Datum get_table_details(PG_FUNCTION_ARGS) {
     std::string schema_name =
         schema_name_arg ? text_to_cstring(schema_name_arg) : "public";
 
-    auto result =
-        pg_ai::QueryGenerator::getTableDetails(table_name, schema_name);
+    auto result = pg_ai::QueryGenerator::getTableDetails(
+        table_name, schema_name, request_memory.resource());
 
     if (!result.success) {
       ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
@@ -133,31 +305,8 @@ Datum get_table_details(PG_FUNCTION_ARGS) {
                              result.error_message.c_str())));
     }
 
-    nlohmann::json json_result;
-    json_result["table_name"] = result.table_name;
-    json_result["schema_name"] = result.schema_name;
-
-    nlohmann::json columns = nlohmann::json::array();
-    for (const auto& column : result.columns) {
-      nlohmann::json column_json;
-      column_json["column_name"] = column.column_name;
-      column_json["data_type"] = column.data_type;
-      column_json["is_nullable"] = column.is_nullable;
-      column_json["column_default"] = column.column_default;
-      column_json["is_primary_key"] = column.is_primary_key;
-      column_json["is_foreign_key"] = column.is_foreign_key;
-      if (!column.foreign_table.empty()) {
-        column_json["foreign_table"] = column.foreign_table;
-        column_json["foreign_column"] = column.foreign_column;
-      }
-      columns.push_back(column_json);
-    }
-    json_result["columns"] = columns;
-
-    json_result["indexes"] = result.indexes;
-
-    std::string json_string = json_result.dump(2);
-    PG_RETURN_TEXT_P(cstring_to_text(json_string.c_str()));
+    std::string json_string = pg_ai::SchemaDigest::toJson(result).dump(2);
+    PG_RETURN_DATUM(stringToTextDatum(json_string));
 
   } catch (const std::exception& e) {
     ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
@@ -175,17 +324,16 @@ Datum get_table_details(PG_FUNCTION_ARGS) {
  */
 Datum explain_query(PG_FUNCTION_ARGS) {
   try {
+    pg_ai::guc::reloadIfNeeded();
+
     text* query_text_arg = PG_GETARG_TEXT_PP(0);
     text* api_key_arg = PG_ARGISNULL(1) ? nullptr : PG_GETARG_TEXT_PP(1);
     text* provider_arg = PG_ARGISNULL(2) ? nullptr : PG_GETARG_TEXT_PP(2);
 
-    std::string query_text = text_to_cstring(query_text_arg);
-    std::string api_key = api_key_arg ? text_to_cstring(api_key_arg) : "";
-    std::string provider =
-        provider_arg ? text_to_cstring(provider_arg) : "auto";
-
     pg_ai::ExplainRequest request{
-        .query_text = query_text, .api_key = api_key, .provider = provider};
+        .query_text = textArgView(query_text_arg),
+        .api_key = textArgView(api_key_arg),
+        .provider = textArgView(provider_arg, "auto")};
 
     auto result = pg_ai::QueryGenerator::explainQuery(request);
 
@@ -195,11 +343,237 @@ Datum explain_query(PG_FUNCTION_ARGS) {
                              result.error_message.c_str())));
     }
 
-    PG_RETURN_TEXT_P(cstring_to_text(result.ai_explanation.c_str()));
+    PG_RETURN_DATUM(stringToTextDatum(result.ai_explanation));
   } catch (const std::exception& e) {
     ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
                     errmsg("Internal error: %s", e.what())));
     PG_RETURN_NULL();
   }
 }
-}
\ No newline at end of file
+
+/**
+ * get_routing_stats()
+ *
+ * Returns JSON with the fast/strong model tier counters and hit rates of
+ * generate_query calls in the current session
+ */
+Datum get_routing_stats(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+    PG_RETURN_DATUM(stringToTextDatum(pg_ai::RoutingStats::toJson()));
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+
+/**
+ * accept_query(natural_language_query text, query text)
+ *
+ * Records an accepted (request, SQL) pair in pg_ai_query_history for reuse
+ * by generate_query and returns the new row's id
+ */
+Datum accept_query(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+    text* nl_query_arg = PG_GETARG_TEXT_PP(0);
+    text* query_arg = PG_GETARG_TEXT_PP(1);
+
+    auto result = pg_ai::QueryGenerator::acceptQuery(textArgView(nl_query_arg),
+                                                     textArgView(query_arg));
+
+    if (!result.success) {
+      ereport(ERROR, (errcode(ERRCODE_EXTERNAL_ROUTINE_EXCEPTION),
+                      errmsg("Failed to record accepted query: %s",
+                             result.error_message.c_str())));
+    }
+
+    PG_RETURN_INT64(result.id);
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+
+/**
+ * reset_conversation()
+ *
+ * Starts a new generate_query conversation in the current session
+ */
+Datum reset_conversation(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+    pg_ai::Conversation::forRole(GetUserId(),
+                                 pg_ai::schema_version::roleGeneration())
+        .reset();
+    PG_RETURN_VOID();
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+
+/**
+ * get_schema_version()
+ *
+ * Returns the schema version of the current database, or NULL when the
+ * library is not loaded through shared_preload_libraries
+ */
+Datum get_schema_version(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+    auto version = pg_ai::schema_version::current();
+    if (!version) {
+      PG_RETURN_NULL();
+    }
+    PG_RETURN_INT64(static_cast<int64>(*version));
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+
+/**
+ * pg_ai_query_schema_changed()
+ *
+ * Event trigger function for ddl_command_end and sql_drop. Records the
+ * relations changed by the command so the schema version advances when the
+ * transaction commits.
+ */
+Datum pg_ai_query_schema_changed(PG_FUNCTION_ARGS) {
+  if (!CALLED_AS_EVENT_TRIGGER(fcinfo)) {
+    ereport(ERROR,
+            (errcode(ERRCODE_E_R_I_E_EVENT_TRIGGER_PROTOCOL_VIOLATED),
+             errmsg("pg_ai_query_schema_changed() must be called as an "
+                    "event trigger")));
+  }
+
+  try {
+    auto* trigger_data = reinterpret_cast<EventTriggerData*>(fcinfo->context);
+    pg_ai::schema_version::recordEventTrigger(
+        std::string_view(trigger_data->event) == "sql_drop");
+  } catch (const std::exception& e) {
+    // A stale prompt cache must never block DDL
+    ereport(WARNING, (errmsg("Schema change not recorded: %s", e.what())));
+  }
+  PG_RETURN_NULL();
+}
+
+/**
+ * pg_ai_query_glossary_changed()
+ *
+ * Statement trigger function for pg_ai_query_glossary. Records a change to
+ * the table so cached glossaries are read again once the transaction
+ * commits.
+ */
+Datum pg_ai_query_glossary_changed(PG_FUNCTION_ARGS) {
+  if (!CALLED_AS_TRIGGER(fcinfo)) {
+    ereport(ERROR,
+            (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+             errmsg("pg_ai_query_glossary_changed() must be called as a "
+                    "trigger")));
+  }
+
+  try {
+    auto* trigger_data = reinterpret_cast<TriggerData*>(fcinfo->context);
+    pg_ai::schema_version::recordChange(
+        RelationGetRelid(trigger_data->tg_relation));
+  } catch (const std::exception& e) {
+    ereport(WARNING, (errmsg("Glossary change not recorded: %s", e.what())));
+  }
+  return PointerGetDatum(nullptr);
+}
+
+/**
+ * refresh_schema_digest()
+ *
+ * Rewrites every row of pg_ai_query_schema_digest from the catalogs and
+ * returns the number of tables written
+ */
+Datum refresh_schema_digest(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+    int written = pg_ai::digest_worker::refresh(std::nullopt);
+    if (written < 0) {
+      ereport(ERROR,
+              (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+               errmsg("pg_ai_query is not installed in this database")));
+    }
+    PG_RETURN_INT32(written);
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+
+/**
+ * search_schema(query text, k integer DEFAULT 10)
+ *
+ * Returns the k tables and columns whose names best match the query, from
+ * the cached schema, as (schema_name, table_name, column_name, score,
+ * snippet) rows; column_name is NULL for tables
+ */
+Datum search_schema(PG_FUNCTION_ARGS) {
+  try {
+    pg_ai::guc::reloadIfNeeded();
+    auto* rsinfo = reinterpret_cast<ReturnSetInfo*>(fcinfo->resultinfo);
+    if (rsinfo == nullptr || !IsA(rsinfo, ReturnSetInfo) ||
+        !(rsinfo->allowedModes & SFRM_Materialize)) {
+      ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                      errmsg("search_schema must be called in a context "
+                             "that accepts a set")));
+    }
+
+    int32 k = PG_GETARG_INT32(1);
+    if (k <= 0) {
+      ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                      errmsg("k must be positive")));
+    }
+
+    auto matches = pg_ai::QueryGenerator::searchSchema(
+        textArgView(PG_GETARG_TEXT_PP(0)), static_cast<size_t>(k));
+
+    // The result set is read after this call returns, so it lives in the
+    // per-query memory context
+    MemoryContext old_context =
+        MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+    TupleDesc tupdesc;
+    if (get_call_result_type(fcinfo, nullptr, &tupdesc) !=
+        TYPEFUNC_COMPOSITE) {
+      ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                      errmsg("search_schema must return a row type")));
+    }
+    Tuplestorestate* rows = tuplestore_begin_heap(
+        (rsinfo->allowedModes & SFRM_Materialize_Random) != 0, false,
+        work_mem);
+    rsinfo->returnMode = SFRM_Materialize;
+    rsinfo->setResult = rows;
+    rsinfo->setDesc = tupdesc;
+    MemoryContextSwitchTo(old_context);
+
+    for (const auto& match : matches) {
+      Datum values[5] = {
+          CStringGetTextDatum(match.schema_name.c_str()),
+          CStringGetTextDatum(match.table_name.c_str()),
+          match.column_name.empty()
+              ? Datum(0)
+              : CStringGetTextDatum(match.column_name.c_str()),
+          Float4GetDatum(static_cast<float4>(match.score)),
+          CStringGetTextDatum(match.snippet.c_str())};
+      bool nulls[5] = {false, false, match.column_name.empty(), false, false};
+      tuplestore_putvalues(rows, tupdesc, values, nulls);
+    }
+
+    return (Datum)0;
+  } catch (const std::exception& e) {
+    ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR),
+                    errmsg("Internal error: %s", e.what())));
+    PG_RETURN_NULL();
+  }
+}
+}
@@ -103,7 +103,7 @@ Your response should include:
 Keep the explanation concise but comprehensive. Use plain language that both developers and DBAs can understand.
 Format the response as plain text with clear section headers and bullet points. Do not use markdown syntax like **, ##, or ###.)";
 
-std::string getSystemPrompt() {
+const std::string& getSystemPrompt() {
   const auto& config = config::ConfigManager::getConfig();
   if (!config.system_prompt.empty()) {
     return config.system_prompt;
@@ -111,7 +111,7 @@ std::string getSystemPrompt() {
   return SYSTEM_PROMPT;
 }
 
-std::string getExplainSystemPrompt() {
+const std::string& getExplainSystemPrompt() {
   const auto& config = config::ConfigManager::getConfig();
   if (!config.explain_system_prompt.empty()) {
     return config.explain_system_prompt;
@@ -1,8 +1,12 @@
 #include "../../include/gemini_client.h"
 
-#include <sstream>
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "../../include/utils.hpp"
 
 namespace gemini {
 
@@ -21,96 +25,258 @@ GeminiClient::GeminiClient(const std::string& api_key) : api_key_(api_key) {
 }
 
 std::string GeminiClient::build_request_body(const GeminiRequest& request) {
-  nlohmann::json body;
+  // Serialize directly into one pre-sized buffer: the prompts can be hundreds
+  // of KB, and a JSON DOM would copy them twice more before dump().
+  std::string body;
+  body.reserve(request.user_prompt.size() + request.system_prompt.size() +
+               256);
 
-  // Build contents array
-  nlohmann::json contents = nlohmann::json::array();
-  nlohmann::json user_message;
-  user_message["parts"] = nlohmann::json::array();
-  user_message["parts"].push_back({{"text", request.user_prompt}});
-  contents.push_back(user_message);
-  body["contents"] = contents;
+  body += R"({"contents":[{"parts":[{"text":)";
+  pg_ai::utils::appendJsonString(body, request.user_prompt);
+  body += "}]}]";
 
   // Add system instruction if provided
   if (!request.system_prompt.empty()) {
-    nlohmann::json system_instruction;
-    system_instruction["parts"] = nlohmann::json::array();
-    system_instruction["parts"].push_back({{"text", request.system_prompt}});
-    body["systemInstruction"] = system_instruction;
+    body += R"(,"systemInstruction":{"parts":[{"text":)";
+    pg_ai::utils::appendJsonString(body, request.system_prompt);
+    body += "}]}";
   }
 
   // Add generation config
-  nlohmann::json generation_config;
-  if (request.temperature.has_value()) {
-    generation_config["temperature"] = request.temperature.value();
+  if (request.temperature.has_value() || request.max_tokens.has_value()) {
+    nlohmann::json generation_config;
+    if (request.temperature.has_value()) {
+      generation_config["temperature"] = request.temperature.value();
+    }
+    if (request.max_tokens.has_value()) {
+      generation_config["maxOutputTokens"] = request.max_tokens.value();
+    }
+    body += R"(,"generationConfig":)";
+    body += generation_config.dump();
+  }
+
+  body += '}';
+  return body;
+}
+
+namespace {
+
+// ------------------------------------------------------------
+// SAX handler for generateContent responses.
+//
+// Captures candidates[0].content.parts[0].text,
+// candidates[0].finishReason, usageMetadata.candidatesTokenCount
+// and error.{message,code} while the body is parsed; everything else
+// is skipped without building a JSON document. The text is moved
+// out of the parser's buffer rather than copied.
+// ------------------------------------------------------------
+class GenerateContentHandler : public nlohmann::json_sax<nlohmann::json> {
+ public:
+  std::optional<std::string> text;
+  std::string finish_reason;
+  int64_t output_tokens = 0;
+  bool has_error = false;
+  std::optional<std::string> error_message;
+  std::optional<int64_t> error_code;
+  std::string parse_error_message;
+
+  bool null() override { return endValue(); }
+  bool boolean(bool) override { return endValue(); }
+
+  bool number_integer(number_integer_t val) override {
+    if (at(kErrorCodePath)) {
+      error_code = val;
+    } else if (at(kOutputTokensPath)) {
+      output_tokens = val;
+    }
+    return endValue();
   }
-  if (request.max_tokens.has_value()) {
-    generation_config["maxOutputTokens"] = request.max_tokens.value();
+
+  bool number_unsigned(number_unsigned_t val) override {
+    if (at(kErrorCodePath)) {
+      error_code = static_cast<int64_t>(val);
+    } else if (at(kOutputTokensPath)) {
+      output_tokens = static_cast<int64_t>(val);
+    }
+    return endValue();
   }
 
-  if (!generation_config.empty()) {
-    body["generationConfig"] = generation_config;
+  bool number_float(number_float_t, const string_t&) override {
+    return endValue();
   }
 
-  return body.dump();
-}
+  bool string(string_t& val) override {
+    if (at(kTextPath)) {
+      text = std::move(val);
+    } else if (at(kFinishReasonPath)) {
+      finish_reason = std::move(val);
+    } else if (at(kErrorMessagePath)) {
+      error_message = std::move(val);
+    }
+    return endValue();
+  }
+
+  bool binary(binary_t&) override { return endValue(); }
+
+  bool start_object(std::size_t) override {
+    stack_.push_back({.array = false});
+    return true;
+  }
+
+  bool key(string_t& val) override {
+    Key key = Key::kOther;
+    if (val == "candidates") {
+      key = Key::kCandidates;
+    } else if (val == "content") {
+      key = Key::kContent;
+    } else if (val == "parts") {
+      key = Key::kParts;
+    } else if (val == "text") {
+      key = Key::kText;
+    } else if (val == "finishReason") {
+      key = Key::kFinishReason;
+    } else if (val == "usageMetadata") {
+      key = Key::kUsageMetadata;
+    } else if (val == "candidatesTokenCount") {
+      key = Key::kCandidatesTokenCount;
+    } else if (val == "error") {
+      key = Key::kError;
+      has_error = has_error || stack_.size() == 1;
+    } else if (val == "message") {
+      key = Key::kMessage;
+    } else if (val == "code") {
+      key = Key::kCode;
+    }
+    stack_.back().key = key;
+    return true;
+  }
+
+  bool end_object() override {
+    stack_.pop_back();
+    return endValue();
+  }
+
+  bool start_array(std::size_t) override {
+    stack_.push_back({.array = true});
+    return true;
+  }
+
+  bool end_array() override {
+    stack_.pop_back();
+    return endValue();
+  }
+
+  bool parse_error(std::size_t,
+                   const std::string&,
+                   const nlohmann::detail::exception& ex) override {
+    parse_error_message = ex.what();
+    return false;
+  }
+
+ private:
+  enum class Key {
+    kOther,
+    kCandidates,
+    kContent,
+    kParts,
+    kText,
+    kFinishReason,
+    kUsageMetadata,
+    kCandidatesTokenCount,
+    kError,
+    kMessage,
+    kCode
+  };
+
+  // Object member (by key) or first array element
+  struct Step {
+    bool array;
+    Key key;
+  };
+
+  struct Frame {
+    bool array;
+    Key key = Key::kOther;
+    size_t index = 0;
+  };
+
+  static constexpr Step kTextPath[] = {
+      {false, Key::kCandidates}, {true, Key::kOther}, {false, Key::kContent},
+      {false, Key::kParts},      {true, Key::kOther}, {false, Key::kText}};
+  static constexpr Step kFinishReasonPath[] = {{false, Key::kCandidates},
+                                               {true, Key::kOther},
+                                               {false, Key::kFinishReason}};
+  static constexpr Step kOutputTokensPath[] = {
+      {false, Key::kUsageMetadata}, {false, Key::kCandidatesTokenCount}};
+  static constexpr Step kErrorMessagePath[] = {{false, Key::kError},
+                                               {false, Key::kMessage}};
+  static constexpr Step kErrorCodePath[] = {{false, Key::kError},
+                                            {false, Key::kCode}};
+
+  std::vector<Frame> stack_;
+
+  bool at(std::span<const Step> path) const {
+    if (stack_.size() != path.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < path.size(); ++i) {
+      const Frame& frame = stack_[i];
+      if (frame.array != path[i].array ||
+          (frame.array ? frame.index != 0 : frame.key != path[i].key)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Advance the enclosing array past the value just completed
+  bool endValue() {
+    if (!stack_.empty() && stack_.back().array) {
+      ++stack_.back().index;
+    }
+    return true;
+  }
+};
+
+}  // namespace
 
 GeminiResponse GeminiClient::parse_response(const std::string& body,
                                             int status_code) {
   GeminiResponse response;
   response.status_code = status_code;
+  response.success = false;
+
+  GenerateContentHandler handler;
+  bool parsed = nlohmann::json::sax_parse(body, &handler);
 
   if (status_code != 200) {
-    response.success = false;
-    try {
-      auto json = nlohmann::json::parse(body);
-      if (json.contains("error")) {
-        auto error = json["error"];
-        response.error_message = error.value("message", "Unknown error");
-        if (error.contains("code")) {
-          response.error_message = "Error " +
-                                   std::to_string(error["code"].get<int>()) +
-                                   ": " + response.error_message;
-        }
-      } else {
-        response.error_message = "HTTP " + std::to_string(status_code);
-      }
-    } catch (const std::exception& e) {
+    if (!parsed) {
       response.error_message =
           "HTTP " + std::to_string(status_code) + ": " + body;
+    } else if (handler.has_error) {
+      response.error_message =
+          handler.error_message.value_or("Unknown error");
+      if (handler.error_code.has_value()) {
+        response.error_message = "Error " +
+                                 std::to_string(*handler.error_code) + ": " +
+                                 response.error_message;
+      }
+    } else {
+      response.error_message = "HTTP " + std::to_string(status_code);
     }
     return response;
   }
 
-  try {
-    auto json = nlohmann::json::parse(body);
-
-    // Extract text from: candidates[0].content.parts[0].text
-    if (json.contains("candidates") && json["candidates"].is_array() &&
-        !json["candidates"].empty()) {
-      auto& candidate = json["candidates"][0];
-
-      if (candidate.contains("content")) {
-        auto& content = candidate["content"];
-
-        if (content.contains("parts") && content["parts"].is_array() &&
-            !content["parts"].empty()) {
-          auto& part = content["parts"][0];
-
-          if (part.contains("text")) {
-            response.text = part["text"].get<std::string>();
-            response.success = true;
-            return response;
-          }
-        }
-      }
-    }
-
-    response.success = false;
+  if (!parsed) {
+    response.error_message =
+        "JSON parse error: " + handler.parse_error_message;
+  } else if (handler.text.has_value()) {
+    response.text = std::move(*handler.text);
+    response.output_tokens = static_cast<int>(handler.output_tokens);
+    response.truncated = handler.finish_reason == "MAX_TOKENS";
+    response.success = true;
+  } else {
     response.error_message = "Invalid response format: missing text content";
-  } catch (const std::exception& e) {
-    response.success = false;
-    response.error_message = std::string("JSON parse error: ") + e.what();
   }
 
   return response;
@@ -193,8 +359,10 @@ GeminiResponse GeminiClient::make_http_request(const std::string& url,
     headers.append("x-goog-api-key: " + api_key_);
     curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers.get());
 
-    // Set POST data
-    curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS, body.c_str());
+    // Set POST data (sent from the caller's buffer, not copied by curl)
+    curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE_LARGE,
+                     static_cast<curl_off_t>(body.size()));
+    curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS, body.data());
 
     // Set write callback
     curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
@@ -221,8 +389,9 @@ GeminiResponse GeminiClient::make_http_request(const std::string& url,
 
 GeminiResponse GeminiClient::generate_text(const GeminiRequest& request) {
   // Build URL
-  std::string url = std::string(BASE_URL) + "/" + API_VERSION + "/models/" +
-                    request.model + ":generateContent";
+  std::string url = std::string(BASE_URL) + "/" + API_VERSION + "/models/";
+  url += request.model;
+  url += ":generateContent";
 
   // Build request body
   std::string body = build_request_body(request);
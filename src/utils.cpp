@@ -94,4 +94,93 @@ std::string formatAPIError(const std::string& raw_error) {
   return raw_error;
 }
 
-}  // namespace pg_ai::utils
\ No newline at end of file
+void appendJsonString(std::string& out, std::string_view value) {
+  static constexpr char kHex[] = "0123456789abcdef";
+
+  out.reserve(out.size() + value.size() + 2);
+  out += '"';
+
+  // Copy runs of characters that need no escaping in one append.
+  size_t run_start = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+
+    out.append(value.data() + run_start, i - run_start);
+    run_start = i + 1;
+
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        out += "\\u00";
+        out += kHex[c >> 4];
+        out += kHex[c & 0x0f];
+        break;
+    }
+  }
+  out.append(value.data() + run_start, value.size() - run_start);
+  out += '"';
+}
+
+std::string oneLine(std::string_view text, size_t max_length) {
+  std::string line;
+  line.reserve(std::min(text.size(), max_length + 1));
+  for (char c : text) {
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      if (!line.empty() && line.back() != ' ') {
+        line += ' ';
+      }
+    } else {
+      line += c;
+    }
+    if (line.size() > max_length && line.back() != ' ') {
+      break;
+    }
+  }
+  if (!line.empty() && line.back() == ' ') {
+    line.pop_back();
+  }
+  if (line.size() <= max_length) {
+    return line;
+  }
+
+  // Cut before a UTF-8 continuation byte never splits a character
+  size_t cut = max_length;
+  while (cut > 0 && (static_cast<unsigned char>(line[cut]) & 0xC0) == 0x80) {
+    --cut;
+  }
+  size_t space = line.rfind(' ', cut);
+  if (space != std::string::npos && space > cut / 2) {
+    cut = space;
+  }
+  line.resize(cut);
+  while (!line.empty() && line.back() == ' ') {
+    line.pop_back();
+  }
+  line += "...";
+  return line;
+}
+
+}  // namespace pg_ai::utils
@@ -0,0 +1,81 @@
+// Micro-benchmark for QueryParser::hasErrorIndicators
+//
+// Compares the previous implementation (lower-cased copy + one find per
+// phrase) with the single-pass KeywordScanner on large model outputs.
+//
+// Build with -DBUILD_BENCHMARKS=ON and run ./tests/pg_ai_query_bench.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "include/query_parser.hpp"
+
+namespace {
+
+bool legacyHasErrorIndicators(const std::string& explanation) {
+  std::string lower = explanation;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  return lower.find("cannot generate query") != std::string::npos ||
+         lower.find("cannot create query") != std::string::npos ||
+         lower.find("unable to generate") != std::string::npos ||
+         lower.find("does not exist") != std::string::npos ||
+         lower.find("do not exist") != std::string::npos ||
+         lower.find("table not found") != std::string::npos ||
+         lower.find("column not found") != std::string::npos ||
+         lower.find("no such table") != std::string::npos ||
+         lower.find("no such column") != std::string::npos;
+}
+
+// Realistic explanation text without any error phrase, so both
+// implementations have to scan the whole input.
+std::string makeExplanation(size_t size) {
+  static const std::string kSentence =
+      "This query joins Orders with Customers on customer_id, filters rows "
+      "created in the last 30 days and groups the Totals by Region. ";
+  std::string text;
+  text.reserve(size + kSentence.size());
+  while (text.size() < size) {
+    text += kSentence;
+  }
+  text.resize(size);
+  return text;
+}
+
+template <typename Fn>
+double nsPerByte(const std::string& text, int iterations, Fn&& fn) {
+  volatile bool sink = false;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    sink = fn(text);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  (void)sink;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         (static_cast<double>(text.size()) * iterations);
+}
+
+}  // namespace
+
+int main() {
+  const std::vector<size_t> sizes = {1024, 64 * 1024, 1024 * 1024};
+  const std::vector<std::string> no_warnings;
+
+  std::printf("%10s %14s %14s %8s\n", "bytes", "legacy ns/B", "scanner ns/B",
+              "speedup");
+  for (size_t size : sizes) {
+    std::string text = makeExplanation(size);
+    int iterations = static_cast<int>(std::max<size_t>(1, (64 << 20) / size));
+
+    double legacy = nsPerByte(text, iterations, legacyHasErrorIndicators);
+    double scanner = nsPerByte(text, iterations, [&](const std::string& t) {
+      return pg_ai::QueryParser::hasErrorIndicators(t, no_warnings);
+    });
+
+    std::printf("%10zu %14.3f %14.3f %7.1fx\n", size, legacy, scanner,
+                legacy / scanner);
+  }
+  return 0;
+}
@@ -197,6 +197,505 @@ BEGIN
     END;
 END $$;
 
+-- Test 11: get_routing_stats returns per-tier counters
+DO $$
+DECLARE
+    json_result JSONB;
+BEGIN
+    json_result := get_routing_stats()::jsonb;
+
+    IF NOT (json_result ? 'fast' AND json_result ? 'strong') THEN
+        RAISE EXCEPTION 'FAIL: get_routing_stats is missing a tier: %', json_result;
+    END IF;
+
+    IF NOT (json_result->'fast' ? 'hit_rate' AND json_result->'fast' ? 'escalated') THEN
+        RAISE EXCEPTION 'FAIL: get_routing_stats is missing fast tier counters: %', json_result;
+    END IF;
+
+    RAISE NOTICE 'PASS: get_routing_stats returns per-tier counters';
+END $$;
+
+-- Test 12: accept_query records a query that generate_query then reuses
+DO $$
+DECLARE
+    history_id BIGINT;
+    result TEXT;
+BEGIN
+    PERFORM reset_conversation();
+    history_id := accept_query('list every widget ever made',
+                               'SELECT 42 AS accepted_answer');
+
+    IF NOT EXISTS (SELECT 1 FROM pg_ai_query_history WHERE id = history_id) THEN
+        RAISE EXCEPTION 'FAIL: accept_query did not record row %', history_id;
+    END IF;
+
+    -- A repeated request is answered from the history, without a provider
+    result := generate_query('List every widget ever made?');
+    DELETE FROM pg_ai_query_history WHERE id = history_id;
+
+    IF result NOT LIKE '%SELECT 42 AS accepted_answer%' THEN
+        RAISE EXCEPTION 'FAIL: generate_query did not reuse the accepted query: %', result;
+    END IF;
+
+    RAISE NOTICE 'PASS: accept_query records queries reused by generate_query';
+END $$;
+
+-- Test 13: reset_conversation starts a new conversation
+DO $$
+DECLARE
+    history_id BIGINT;
+    result TEXT;
+BEGIN
+    history_id := accept_query('list every gadget ever made',
+                               'SELECT 43 AS accepted_answer');
+
+    -- The history answer is the first turn of a new conversation
+    PERFORM reset_conversation();
+    result := generate_query('list every gadget ever made');
+    IF result NOT LIKE '%SELECT 43 AS accepted_answer%' THEN
+        DELETE FROM pg_ai_query_history WHERE id = history_id;
+        RAISE EXCEPTION 'FAIL: generate_query did not reuse the accepted query: %', result;
+    END IF;
+
+    -- After a reset the repeated request is not a follow-up, so the history
+    -- answers it again
+    PERFORM reset_conversation();
+    result := generate_query('list every gadget ever made');
+    DELETE FROM pg_ai_query_history WHERE id = history_id;
+
+    IF result NOT LIKE '%SELECT 43 AS accepted_answer%' THEN
+        RAISE EXCEPTION 'FAIL: reset_conversation did not start a new conversation: %', result;
+    END IF;
+
+    RAISE NOTICE 'PASS: reset_conversation starts a new conversation';
+END $$;
+
+-- Test 14: ai_query executes the generated query and caps its rows
+DO $$
+DECLARE
+    ids BIGINT[];
+    row_count BIGINT;
+    answer JSONB;
+BEGIN
+    ids := ARRAY[
+        accept_query('the ultimate answer',
+                     'SELECT 42 AS answer, ''life'' AS topic;'),
+        accept_query('five numbers please',
+                     'SELECT g FROM generate_series(1, 5) AS g'),
+        accept_query('forget all accepted queries',
+                     'DELETE FROM pg_ai_query_history'),
+        accept_query('advance the history counter',
+                     'SELECT nextval(''pg_ai_query_history_id_seq'')')];
+
+    PERFORM reset_conversation();
+    SELECT row INTO answer FROM ai_query('the ultimate answer') AS row;
+    IF answer IS DISTINCT FROM '{"answer": 42, "topic": "life"}'::jsonb THEN
+        DELETE FROM pg_ai_query_history WHERE id = ANY (ids);
+        RAISE EXCEPTION 'FAIL: ai_query returned %', answer;
+    END IF;
+
+    PERFORM reset_conversation();
+    SELECT count(*) INTO row_count
+    FROM ai_query('five numbers please', max_rows => 2);
+    IF row_count <> 2 THEN
+        DELETE FROM pg_ai_query_history WHERE id = ANY (ids);
+        RAISE EXCEPTION 'FAIL: ai_query returned % rows with max_rows 2', row_count;
+    END IF;
+
+    PERFORM reset_conversation();
+    BEGIN
+        PERFORM * FROM ai_query('forget all accepted queries');
+        DELETE FROM pg_ai_query_history WHERE id = ANY (ids);
+        RAISE EXCEPTION 'FAIL: ai_query executed a DELETE';
+    EXCEPTION WHEN external_routine_exception THEN
+        NULL;
+    END;
+
+    -- A SELECT calling a volatile function is rejected too
+    PERFORM reset_conversation();
+    BEGIN
+        PERFORM * FROM ai_query('advance the history counter');
+        DELETE FROM pg_ai_query_history WHERE id = ANY (ids);
+        RAISE EXCEPTION 'FAIL: ai_query executed nextval()';
+    EXCEPTION WHEN external_routine_exception THEN
+        NULL;
+    END;
+
+    DELETE FROM pg_ai_query_history WHERE id = ANY (ids);
+    RAISE NOTICE 'PASS: ai_query returns capped jsonb rows of side-effect-free queries';
+END $$;
+
+-- Test 15: ai_query results stay current when its saved plan is reused
+DO $$
+DECLARE
+    history_id BIGINT;
+    answer JSONB;
+BEGIN
+    CREATE TEMP TABLE ai_query_plan_test (id int);
+    history_id := accept_query('rows of the plan test',
+                               'SELECT count(*) AS n FROM ai_query_plan_test');
+
+    PERFORM reset_conversation();
+    SELECT row INTO answer FROM ai_query('rows of the plan test') AS row;
+
+    INSERT INTO ai_query_plan_test VALUES (1), (2);
+    ALTER TABLE ai_query_plan_test ADD COLUMN label text;
+    PERFORM reset_conversation();
+    SELECT row INTO answer FROM ai_query('rows of the plan test') AS row;
+
+    DELETE FROM pg_ai_query_history WHERE id = history_id;
+    DROP TABLE ai_query_plan_test;
+
+    IF answer IS DISTINCT FROM '{"n": 2}'::jsonb THEN
+        RAISE EXCEPTION 'FAIL: ai_query returned % after the table changed', answer;
+    END IF;
+
+    RAISE NOTICE 'PASS: ai_query reuses saved plans without stale results';
+END $$;
+
+-- Test 16: committed DDL advances the schema version
+-- The version moves at commit, so the table is created in its own statement
+CREATE TEMP TABLE schema_version_test AS
+    SELECT get_schema_version() AS before_ddl;
+CREATE TABLE schema_version_probe (id int);
+DO $$
+DECLARE
+    before_ddl BIGINT;
+    after_ddl BIGINT;
+BEGIN
+    SELECT t.before_ddl INTO before_ddl FROM schema_version_test t;
+    after_ddl := get_schema_version();
+
+    IF after_ddl IS NULL THEN
+        RAISE NOTICE 'SKIP: pg_ai_query is not in shared_preload_libraries';
+    ELSIF after_ddl <= before_ddl THEN
+        RAISE EXCEPTION 'FAIL: schema version stayed at % after CREATE TABLE', after_ddl;
+    ELSE
+        RAISE NOTICE 'PASS: committed DDL advances the schema version';
+    END IF;
+END $$;
+DROP TABLE schema_version_probe;
+DROP TABLE schema_version_test;
+
+-- Test 17: search_schema finds a table by name prefix
+DO $$
+DECLARE
+    best RECORD;
+BEGIN
+    IF EXISTS (
+        SELECT 1 FROM information_schema.tables
+        WHERE table_schema = 'pg_ai_test' AND table_name = 'users'
+    ) THEN
+        SELECT * INTO best FROM search_schema('user', 5)
+        WHERE schema_name = 'pg_ai_test' AND table_name = 'users'
+            AND column_name IS NULL;
+
+        IF NOT FOUND THEN
+            RAISE EXCEPTION 'FAIL: search_schema did not find pg_ai_test.users';
+        ELSIF best.score < 0.5 THEN
+            RAISE EXCEPTION 'FAIL: prefix match scored only %', best.score;
+        END IF;
+
+        RAISE NOTICE 'PASS: search_schema ranks pg_ai_test.users for "user"';
+    ELSE
+        RAISE NOTICE 'SKIP: Test table pg_ai_test.users does not exist';
+    END IF;
+END $$;
+
+-- Test 18: search_schema finds a table through a glossary term
+-- (the entry is committed first: sessions see glossary changes after commit)
+INSERT INTO pg_ai_query_glossary (term, schema_name, table_name)
+SELECT 'account holders', 'pg_ai_test', 'users'
+WHERE EXISTS (
+    SELECT 1 FROM information_schema.tables
+    WHERE table_schema = 'pg_ai_test' AND table_name = 'users'
+);
+
+DO $$
+DECLARE
+    best RECORD;
+BEGIN
+    IF EXISTS (
+        SELECT 1 FROM pg_ai_query_glossary WHERE term = 'account holders'
+    ) THEN
+        SELECT * INTO best FROM search_schema('account holders', 1);
+
+        IF NOT FOUND OR best.table_name IS DISTINCT FROM 'users' THEN
+            RAISE EXCEPTION 'FAIL: glossary term did not find pg_ai_test.users';
+        ELSIF best.snippet <> 'glossary: account holders' THEN
+            RAISE EXCEPTION 'FAIL: unexpected snippet %', best.snippet;
+        END IF;
+
+        RAISE NOTICE 'PASS: search_schema finds pg_ai_test.users by glossary term';
+    ELSE
+        RAISE NOTICE 'SKIP: Test table pg_ai_test.users does not exist';
+    END IF;
+END $$;
+
+DELETE FROM pg_ai_query_glossary WHERE term = 'account holders';
+
+-- Test 19: get_database_tables leaves out tables the role can't select from
+CREATE ROLE pg_ai_test_writer NOLOGIN;
+
+DO $$
+DECLARE
+    tables jsonb;
+BEGIN
+    IF EXISTS (
+        SELECT 1 FROM information_schema.tables
+        WHERE table_schema = 'pg_ai_test' AND table_name = 'users'
+    ) THEN
+        GRANT USAGE ON SCHEMA pg_ai_test TO pg_ai_test_writer;
+        GRANT INSERT ON pg_ai_test.users TO pg_ai_test_writer;
+        SET LOCAL ROLE pg_ai_test_writer;
+        tables := get_database_tables()::jsonb;
+
+        IF EXISTS (
+            SELECT 1 FROM jsonb_array_elements(tables) t
+            WHERE t->>'schema_name' = 'pg_ai_test'
+                AND t->>'table_name' = 'users'
+        ) THEN
+            RAISE EXCEPTION 'FAIL: insert-only table listed for the role';
+        END IF;
+
+        RAISE NOTICE 'PASS: get_database_tables lists only readable tables';
+    ELSE
+        RAISE NOTICE 'SKIP: Test table pg_ai_test.users does not exist';
+    END IF;
+END $$;
+
+DROP OWNED BY pg_ai_test_writer;
+DROP ROLE pg_ai_test_writer;
+
+-- Test 20: get_table_details includes column comments
+CREATE ROLE pg_ai_test_writer NOLOGIN;
+
+DO $$
+DECLARE
+    result jsonb;
+    hidden jsonb;
+BEGIN
+    IF EXISTS (
+        SELECT 1 FROM information_schema.tables
+        WHERE table_schema = 'pg_ai_test' AND table_name = 'users'
+    ) THEN
+        COMMENT ON TABLE pg_ai_test.users IS 'Registered accounts';
+        COMMENT ON COLUMN pg_ai_test.users.id IS 'Surrogate key';
+        result := get_table_details('users', 'pg_ai_test')::jsonb;
+
+        -- No column is readable, but the table comment still is
+        GRANT USAGE ON SCHEMA pg_ai_test TO pg_ai_test_writer;
+        GRANT INSERT ON pg_ai_test.users TO pg_ai_test_writer;
+        SET LOCAL ROLE pg_ai_test_writer;
+        hidden := get_table_details('users', 'pg_ai_test')::jsonb;
+        RESET ROLE;
+
+        COMMENT ON COLUMN pg_ai_test.users.id IS NULL;
+        COMMENT ON TABLE pg_ai_test.users IS NULL;
+
+        IF result->>'description' IS DISTINCT FROM 'Registered accounts' THEN
+            RAISE EXCEPTION 'FAIL: table comment missing: %', result;
+        ELSIF NOT EXISTS (
+            SELECT 1 FROM jsonb_array_elements(result->'columns') col
+            WHERE col->>'column_name' = 'id'
+                AND col->>'description' = 'Surrogate key'
+        ) THEN
+            RAISE EXCEPTION 'FAIL: column comment missing: %', result;
+        ELSIF jsonb_array_length(hidden->'columns') <> 0 THEN
+            RAISE EXCEPTION 'FAIL: unreadable columns listed: %', hidden;
+        ELSIF hidden->>'description' IS DISTINCT FROM 'Registered accounts' THEN
+            RAISE EXCEPTION 'FAIL: table comment lost without columns: %',
+                hidden;
+        END IF;
+
+        RAISE NOTICE 'PASS: get_table_details includes comments';
+    ELSE
+        RAISE NOTICE 'SKIP: Test table pg_ai_test.users does not exist';
+    END IF;
+END $$;
+
+DROP OWNED BY pg_ai_test_writer;
+DROP ROLE pg_ai_test_writer;
+
+-- Test 21: accepted queries reach other roles only over tables they can read
+CREATE ROLE pg_ai_test_reader NOLOGIN;
+CREATE TABLE pg_ai_history_open (id int);
+CREATE TABLE pg_ai_history_secret (id int);
+GRANT SELECT ON pg_ai_history_open TO pg_ai_test_reader;
+
+DO $$
+DECLARE
+    ids BIGINT[];
+    open_result TEXT;
+    secret_result TEXT;
+BEGIN
+    ids := ARRAY[
+        accept_query('tally of the unlocked ledger',
+                     'SELECT count(*) AS open_rows FROM pg_ai_history_open'),
+        accept_query('tally of the sealed ledger',
+                     'SELECT count(*) AS secret_rows FROM pg_ai_history_secret')];
+
+    -- The restricted role sees a different table list than the accepting
+    -- owner, but the same history key
+    SET LOCAL ROLE pg_ai_test_reader;
+    PERFORM reset_conversation();
+    open_result := generate_query('tally of the unlocked ledger');
+    PERFORM reset_conversation();
+    BEGIN
+        secret_result := generate_query('tally of the sealed ledger');
+    EXCEPTION WHEN OTHERS THEN
+        -- Without the accepted query this needs a provider
+        secret_result := SQLERRM;
+    END;
+    RESET ROLE;
+    DELETE FROM pg_ai_query_history WHERE id = ANY (ids);
+
+    IF open_result NOT LIKE '%open_rows%' THEN
+        RAISE EXCEPTION 'FAIL: restricted role did not get the accepted query: %',
+            open_result;
+    ELSIF secret_result LIKE '%secret_rows%' THEN
+        RAISE EXCEPTION 'FAIL: accepted query over an unreadable table reused: %',
+            secret_result;
+    END IF;
+
+    RAISE NOTICE 'PASS: accepted queries are shared across roles by readable tables';
+END $$;
+
+DROP TABLE pg_ai_history_open, pg_ai_history_secret;
+DROP OWNED BY pg_ai_test_reader;
+DROP ROLE pg_ai_test_reader;
+
+-- Test 22: search_schema finds columns of tables no request has described
+CREATE TABLE pg_ai_search_cold (id int PRIMARY KEY, zephyr_reading numeric);
+
+DO $$
+DECLARE
+    best RECORD;
+BEGIN
+    SELECT * INTO best FROM search_schema('zephyr_reading', 5)
+    WHERE table_name = 'pg_ai_search_cold' AND column_name IS NOT NULL;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'FAIL: search_schema missed a column of an uncached table';
+    ELSIF best.column_name <> 'zephyr_reading' OR best.score < 1 THEN
+        RAISE EXCEPTION 'FAIL: unexpected match %', best;
+    ELSIF best.snippet NOT LIKE 'numeric%' THEN
+        RAISE EXCEPTION 'FAIL: unexpected snippet %', best.snippet;
+    END IF;
+
+    RAISE NOTICE 'PASS: search_schema reads columns of uncached tables';
+END $$;
+
+DROP TABLE pg_ai_search_cold;
+
+-- Test 23: a reused plan is checked again after its view is redefined
+DO $$
+DECLARE
+    history_id BIGINT;
+    answer JSONB;
+BEGIN
+    CREATE TEMP SEQUENCE ai_query_view_test_seq;
+    CREATE TEMP VIEW ai_query_view_test AS SELECT 1::bigint AS n;
+    history_id := accept_query('numbers of the view test',
+                               'SELECT n FROM ai_query_view_test');
+
+    PERFORM reset_conversation();
+    SELECT row INTO answer FROM ai_query('numbers of the view test') AS row;
+    IF answer IS DISTINCT FROM '{"n": 1}'::jsonb THEN
+        DELETE FROM pg_ai_query_history WHERE id = history_id;
+        RAISE EXCEPTION 'FAIL: ai_query returned %', answer;
+    END IF;
+
+    -- Same SQL text, but the saved plan now reaches nextval()
+    CREATE OR REPLACE TEMP VIEW ai_query_view_test AS
+        SELECT nextval('ai_query_view_test_seq') AS n;
+    PERFORM reset_conversation();
+    BEGIN
+        PERFORM * FROM ai_query('numbers of the view test');
+        DELETE FROM pg_ai_query_history WHERE id = history_id;
+        RAISE EXCEPTION 'FAIL: reused plan executed nextval()';
+    EXCEPTION WHEN external_routine_exception THEN
+        NULL;
+    END;
+
+    DELETE FROM pg_ai_query_history WHERE id = history_id;
+    DROP VIEW ai_query_view_test;
+    DROP SEQUENCE ai_query_view_test_seq;
+    RAISE NOTICE 'PASS: reused plans are checked again after a view changes';
+END $$;
+
+-- Test 24: a role sees tables granted through a role it joins or leaves
+CREATE ROLE pg_ai_test_member NOLOGIN;
+CREATE ROLE pg_ai_test_group NOLOGIN;
+CREATE TABLE pg_ai_member_ledger (id int);
+GRANT SELECT ON pg_ai_member_ledger TO pg_ai_test_group;
+
+DO $$
+DECLARE
+    before_grant BOOLEAN;
+    after_grant BOOLEAN;
+    after_revoke BOOLEAN;
+BEGIN
+    -- No event trigger fires for role membership, so the schema version
+    -- stays the same across the GRANT and REVOKE
+    SET LOCAL ROLE pg_ai_test_member;
+    before_grant := get_database_tables()::text LIKE '%pg_ai_member_ledger%';
+    RESET ROLE;
+    GRANT pg_ai_test_group TO pg_ai_test_member;
+    SET LOCAL ROLE pg_ai_test_member;
+    after_grant := get_database_tables()::text LIKE '%pg_ai_member_ledger%';
+    RESET ROLE;
+    REVOKE pg_ai_test_group FROM pg_ai_test_member;
+    SET LOCAL ROLE pg_ai_test_member;
+    after_revoke := get_database_tables()::text LIKE '%pg_ai_member_ledger%';
+    RESET ROLE;
+
+    IF before_grant OR NOT after_grant OR after_revoke THEN
+        RAISE EXCEPTION 'FAIL: table visible before %, after GRANT %, after REVOKE %',
+            before_grant, after_grant, after_revoke;
+    END IF;
+
+    RAISE NOTICE 'PASS: role membership changes reach the schema cache';
+END $$;
+
+DROP TABLE pg_ai_member_ledger;
+DROP ROLE pg_ai_test_member, pg_ai_test_group;
+
+-- Test 25: get_table_details reads names with quotes as names
+CREATE TABLE "pg_ai_o'quote" (id int);
+COMMENT ON TABLE "pg_ai_o'quote" IS 'quoted ledger';
+
+DO $$
+DECLARE
+    details JSONB;
+BEGIN
+    details := get_table_details('pg_ai_o''quote', 'public')::jsonb;
+    IF details->>'description' IS DISTINCT FROM 'quoted ledger'
+        OR jsonb_array_length(details->'columns') <> 1 THEN
+        RAISE EXCEPTION 'FAIL: unexpected details %', details;
+    END IF;
+
+    details := get_table_details('x'' OR ''1''=''1', 'public')::jsonb;
+    IF jsonb_array_length(details->'columns') <> 0 THEN
+        RAISE EXCEPTION 'FAIL: table name was spliced into the SQL: %', details;
+    END IF;
+
+    RAISE NOTICE 'PASS: get_table_details passes names as parameters';
+END $$;
+
+DROP TABLE "pg_ai_o'quote";
+
+-- Test 26: search_schema is volatile, since it fills the session's caches
+-- and reads the catalogs with a fresh snapshot
+DO $$
+BEGIN
+    IF (SELECT provolatile FROM pg_proc
+        WHERE oid = 'search_schema(text, integer)'::regprocedure) <> 'v' THEN
+        RAISE EXCEPTION 'FAIL: search_schema is not VOLATILE';
+    END IF;
+    RAISE NOTICE 'PASS: search_schema is VOLATILE';
+END $$;
+
 -- Summary
 DO $$
 BEGIN
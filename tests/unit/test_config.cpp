@@ -69,6 +69,18 @@ TEST_F(ConfigManagerTest, LoadsAnthropicOnlyConfig) {
   ASSERT_NE(anthropic, nullptr);
   EXPECT_EQ(anthropic->api_key, "sk-ant-only-key");
   EXPECT_EQ(anthropic->default_model, "claude-sonnet-4-5-20250929");
+  EXPECT_TRUE(anthropic->fast_model.empty());
+}
+
+// Test loading a provider's fast model
+TEST_F(ConfigManagerTest, LoadsFastModel) {
+  std::string config_path = getConfigFixture("anthropic_fast_model.ini");
+  ASSERT_TRUE(ConfigManager::loadConfig(config_path));
+
+  const auto* anthropic = ConfigManager::getProviderConfig(Provider::ANTHROPIC);
+  ASSERT_NE(anthropic, nullptr);
+  EXPECT_EQ(anthropic->default_model, "claude-sonnet-4-5-20250929");
+  EXPECT_EQ(anthropic->fast_model, "claude-haiku-4-5");
 }
 
 // Test loading empty configuration (no API keys)
@@ -104,6 +116,130 @@ TEST_F(ConfigManagerTest, ThrowsForNonexistentFile) {
                std::runtime_error);
 }
 
+// Test that an optional config file may be missing
+TEST_F(ConfigManagerTest, LoadConfigIfExistsKeepsDefaultsWithoutFile) {
+  EXPECT_FALSE(
+      ConfigManager::loadConfigIfExists("/nonexistent/path/config.ini"));
+
+  // Marked as loaded: getConfig() must not fall back to ~/.pg_ai.config
+  const auto& config = ConfigManager::getConfig();
+  EXPECT_EQ(config.log_level, "INFO");
+  EXPECT_EQ(config.default_limit, 1000);
+}
+
+// Test that an existing optional config file is loaded
+TEST_F(ConfigManagerTest, LoadConfigIfExistsLoadsFile) {
+  EXPECT_TRUE(
+      ConfigManager::loadConfigIfExists(getConfigFixture("valid_config.ini")));
+
+  EXPECT_EQ(ConfigManager::getConfig().default_limit, 500);
+}
+
+// Test in-place updates used by the GUC assign hooks
+TEST_F(ConfigManagerTest, GetOrCreateProviderConfig) {
+  ASSERT_FALSE(
+      ConfigManager::loadConfigIfExists("/nonexistent/path/config.ini"));
+  ASSERT_EQ(ConfigManager::getProviderConfig(Provider::GEMINI), nullptr);
+
+  auto& gemini = ConfigManager::getOrCreateProviderConfig(Provider::GEMINI);
+  EXPECT_EQ(gemini.default_model, constants::DEFAULT_GEMINI_MODEL);
+  gemini.api_key = "AIzaSy-from-guc";
+
+  auto& anthropic =
+      ConfigManager::getOrCreateProviderConfig(Provider::ANTHROPIC);
+  EXPECT_EQ(anthropic.default_max_tokens,
+            constants::DEFAULT_ANTHROPIC_MAX_TOKENS);
+
+  const auto* found = ConfigManager::getProviderConfig(Provider::GEMINI);
+  ASSERT_NE(found, nullptr);
+  EXPECT_EQ(found->api_key, "AIzaSy-from-guc");
+  EXPECT_EQ(&ConfigManager::getOrCreateProviderConfig(Provider::GEMINI),
+            found);
+
+  ConfigManager::getMutableConfig().default_limit = 42;
+  EXPECT_EQ(ConfigManager::getConfig().default_limit, 42);
+}
+
+// Test that reading a file for reload leaves the active config untouched
+TEST_F(ConfigManagerTest, ReadConfigFileDoesNotApply) {
+  ASSERT_TRUE(
+      ConfigManager::loadConfig(getConfigFixture("minimal_config.ini")));
+  const std::string active_level = ConfigManager::getConfig().log_level;
+
+  Configuration parsed;
+  ASSERT_TRUE(ConfigManager::readConfigFile(
+      getConfigFixture("valid_config.ini"), parsed));
+  EXPECT_EQ(parsed.log_level, "DEBUG");
+  EXPECT_EQ(parsed.default_limit, 500);
+  EXPECT_EQ(ConfigManager::getConfig().log_level, active_level);
+
+  Configuration missing;
+  EXPECT_FALSE(
+      ConfigManager::readConfigFile("/nonexistent/path/config.ini", missing));
+  EXPECT_EQ(missing.default_limit, 1000);
+
+  auto& gemini =
+      ConfigManager::getOrCreateProviderConfig(missing, Provider::GEMINI);
+  EXPECT_EQ(gemini.default_model, constants::DEFAULT_GEMINI_MODEL);
+  EXPECT_EQ(&ConfigManager::getOrCreateProviderConfig(missing,
+                                                      Provider::GEMINI),
+            &gemini);
+}
+
+// Test that every configuration change advances the generation
+TEST_F(ConfigManagerTest, GenerationAdvancesOnChange) {
+  uint64_t generation = ConfigManager::generation();
+
+  ASSERT_TRUE(
+      ConfigManager::loadConfig(getConfigFixture("minimal_config.ini")));
+  EXPECT_GT(ConfigManager::generation(), generation);
+  generation = ConfigManager::generation();
+
+  ConfigManager::getMutableConfig().default_limit = 10;
+  ConfigManager::markChanged();
+  EXPECT_GT(ConfigManager::generation(), generation);
+  generation = ConfigManager::generation();
+
+  ConfigManager::getOrCreateProviderConfig(Provider::GEMINI);
+  EXPECT_GT(ConfigManager::generation(), generation);
+  generation = ConfigManager::generation();
+
+  // Plain lookups leave it alone
+  ConfigManager::getMutableConfig();
+  ConfigManager::getOrCreateProviderConfig(Provider::GEMINI);
+  ConfigManager::getOrCreateProviderConfig(Provider::OPENAI);
+  EXPECT_EQ(ConfigManager::generation(), generation);
+
+  Configuration parsed;
+  ConfigManager::readConfigFile(getConfigFixture("valid_config.ini"), parsed);
+  EXPECT_EQ(ConfigManager::generation(), generation);
+
+  ConfigManager::reset();
+  EXPECT_GT(ConfigManager::generation(), generation);
+}
+
+// Test that the session profile is resolved once per generation
+TEST_F(ConfigManagerTest, EffectiveProviderConfigCachedPerGeneration) {
+  ASSERT_TRUE(ConfigManager::loadConfig(getConfigFixture("valid_config.ini")));
+
+  const auto* first =
+      ConfigManager::getEffectiveProviderConfig(Provider::OPENAI);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->default_model,
+            ConfigManager::getProviderConfig(Provider::OPENAI)->default_model);
+  EXPECT_EQ(ConfigManager::getEffectiveProviderConfig(Provider::OPENAI), first);
+
+  ConfigManager::getMutableConfig().profile.temperature = 0.0;
+  ConfigManager::markChanged();
+  const auto* updated =
+      ConfigManager::getEffectiveProviderConfig(Provider::OPENAI);
+  ASSERT_NE(updated, nullptr);
+  EXPECT_DOUBLE_EQ(updated->default_temperature, 0.0);
+  EXPECT_DOUBLE_EQ(
+      ConfigManager::getProviderConfig(Provider::OPENAI)->default_temperature,
+      0.5);
+}
+
 // Test provider enum to string conversion
 TEST_F(ConfigManagerTest, ProviderToString) {
   EXPECT_EQ(ConfigManager::providerToString(Provider::OPENAI), "openai");
@@ -240,6 +376,8 @@ max_retries = 10
 [query]
 default_limit = 2500
 max_query_length = 8000
+template_min_confidence = 0.5
+history_examples = 5
 
 [openai]
 api_key = sk-test
@@ -254,6 +392,8 @@ temperature = 0.85
   EXPECT_EQ(config.max_retries, 10);
   EXPECT_EQ(config.default_limit, 2500);
   EXPECT_EQ(config.max_query_length, 8000);
+  EXPECT_DOUBLE_EQ(config.template_min_confidence, 0.5);
+  EXPECT_EQ(config.history_examples, 5);
 
   const auto* openai = ConfigManager::getProviderConfig(Provider::OPENAI);
   ASSERT_NE(openai, nullptr);
@@ -269,6 +409,7 @@ enable_logging = true
 
 [query]
 enforce_limit = false
+template_fast_path = false
 
 [response]
 show_explanation = true
@@ -282,6 +423,7 @@ use_formatted_response = true
   const auto& config = ConfigManager::getConfig();
   EXPECT_TRUE(config.enable_logging);
   EXPECT_FALSE(config.enforce_limit);
+  EXPECT_FALSE(config.template_fast_path);
   EXPECT_TRUE(config.show_explanation);
   EXPECT_FALSE(config.show_warnings);
   EXPECT_TRUE(config.show_suggested_visualization);
@@ -299,6 +441,14 @@ TEST(ConfigurationTest, DefaultConstructorSetsDefaults) {
   EXPECT_TRUE(config.enforce_limit);
   EXPECT_EQ(config.default_limit, 1000);
   EXPECT_EQ(config.max_query_length, 4000);
+  EXPECT_DOUBLE_EQ(config.max_query_cost, 0.0);
+  EXPECT_EQ(config.plan_cache_size, 64);
+  EXPECT_TRUE(config.template_fast_path);
+  EXPECT_DOUBLE_EQ(config.template_min_confidence, 0.9);
+  EXPECT_EQ(config.history_examples, 3);
+  EXPECT_DOUBLE_EQ(config.history_min_similarity, 0.3);
+  EXPECT_DOUBLE_EQ(config.history_match_threshold, 0.95);
+  EXPECT_EQ(config.conversation_turns, 5);
   EXPECT_TRUE(config.show_explanation);
   EXPECT_TRUE(config.show_warnings);
   EXPECT_FALSE(config.show_suggested_visualization);
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include "include/conversation.hpp"
+
+using namespace pg_ai;
+
+class ConversationTest : public ::testing::Test {
+ protected:
+  static TableDetails orders() {
+    TableDetails details{.table_name = "orders",
+                         .schema_name = "public",
+                         .columns = {},
+                         .indexes = {},
+                         .success = true,
+                         .error_message = ""};
+    details.columns.push_back(ColumnInfo{.column_name = "id",
+                                         .data_type = "integer",
+                                         .is_nullable = false,
+                                         .column_default = "",
+                                         .is_primary_key = true,
+                                         .is_foreign_key = false,
+                                         .foreign_table = "",
+                                         .foreign_column = ""});
+    details.columns.push_back(ColumnInfo{.column_name = "customer_id",
+                                         .data_type = "integer",
+                                         .is_nullable = false,
+                                         .column_default = "",
+                                         .is_primary_key = false,
+                                         .is_foreign_key = true,
+                                         .foreign_table = "customers",
+                                         .foreign_column = "id"});
+    details.columns.push_back(ColumnInfo{.column_name = "total",
+                                         .data_type = "numeric",
+                                         .is_nullable = true,
+                                         .column_default = "",
+                                         .is_primary_key = false,
+                                         .is_foreign_key = false,
+                                         .foreign_table = "",
+                                         .foreign_column = ""});
+    return details;
+  }
+};
+
+// Test which requests continue a conversation
+TEST_F(ConversationTest, DetectsFollowUps) {
+  Conversation conversation;
+  EXPECT_FALSE(conversation.isFollowUp("now group that by month", 0));
+
+  conversation.recordTurn("orders per customer", "SELECT 1", 5);
+  EXPECT_TRUE(conversation.isFollowUp("now group by month", 0));
+  EXPECT_TRUE(conversation.isFollowUp("Join THOSE with customers", 1));
+  EXPECT_TRUE(conversation.isFollowUp("same for payments", 1));
+  EXPECT_FALSE(conversation.isFollowUp("list all payments", 1));
+}
+
+// Test that only the last max_turns turns are kept
+TEST_F(ConversationTest, KeepsLastTurns) {
+  Conversation conversation;
+  conversation.recordTurn("a", "SELECT 1", 2);
+  conversation.recordTurn("b", "SELECT 2", 2);
+  conversation.recordTurn("c", "SELECT 3", 2);
+
+  ASSERT_EQ(conversation.turns().size(), 2u);
+  EXPECT_EQ(conversation.turns().front().request, "b");
+  EXPECT_EQ(conversation.turns().back().sql, "SELECT 3");
+}
+
+// Test the one-line table listing
+TEST_F(ConversationTest, SummarizesTable) {
+  EXPECT_EQ(Conversation::summarizeTable(orders()),
+            "public.orders(id integer PK, customer_id integer -> "
+            "customers.id, total numeric)");
+}
+
+// Test the prompt section, and that reset forgets turns and tables
+TEST_F(ConversationTest, FormatsContextAndResets) {
+  Conversation conversation;
+  conversation.addTable(orders());
+  EXPECT_TRUE(conversation.hasTable("public", "orders"));
+  EXPECT_FALSE(conversation.hasTable("sales", "orders"));
+  EXPECT_EQ(conversation.formatContext(), "");
+
+  conversation.recordTurn("orders per customer",
+                          "SELECT customer_id, count(*) FROM orders GROUP BY 1",
+                          5);
+  EXPECT_EQ(conversation.formatContext(),
+            "Earlier requests in this conversation:\n"
+            "\nRequest: orders per customer\n"
+            "SQL: SELECT customer_id, count(*) FROM orders GROUP BY 1\n"
+            "\nTables used so far:\n"
+            "public.orders(id integer PK, customer_id integer -> "
+            "customers.id, total numeric)\n");
+
+  conversation.reset();
+  EXPECT_TRUE(conversation.turns().empty());
+  EXPECT_FALSE(conversation.hasTable("public", "orders"));
+  EXPECT_EQ(conversation.formatContext(), "");
+}
+
+// Test that switching role starts a new conversation
+TEST_F(ConversationTest, StartsOverForAnotherRole) {
+  Conversation& first = Conversation::forRole(10);
+  first.reset();
+  first.addTable(orders());
+  first.recordTurn("orders per customer", "SELECT 1", 5);
+
+  EXPECT_EQ(Conversation::forRole(10).turns().size(), 1u);
+
+  Conversation& second = Conversation::forRole(20);
+  EXPECT_TRUE(second.turns().empty());
+  EXPECT_FALSE(second.hasTable("public", "orders"));
+
+  // Switching back does not bring the first role's turns back
+  EXPECT_TRUE(Conversation::forRole(10).turns().empty());
+}
+
+// Test that a change in role memberships starts a new conversation
+TEST_F(ConversationTest, StartsOverWhenMembershipsChange) {
+  Conversation& conversation = Conversation::forRole(10, 1);
+  conversation.reset();
+  conversation.addTable(orders());
+  conversation.recordTurn("orders per customer", "SELECT 1", 5);
+
+  EXPECT_EQ(Conversation::forRole(10, 1).turns().size(), 1u);
+  EXPECT_TRUE(Conversation::forRole(10, 2).turns().empty());
+  EXPECT_FALSE(Conversation::forRole(10, 2).hasTable("public", "orders"));
+}
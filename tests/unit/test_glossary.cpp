@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "include/glossary.hpp"
+
+using namespace pg_ai;
+
+class GlossaryTest : public ::testing::Test {
+ protected:
+  static Glossary glossary() {
+    return Glossary({{.term = "customer",
+                      .schema_name = "public",
+                      .table_name = "acct",
+                      .column_name = ""},
+                     {.term = "Monthly Revenue",
+                      .schema_name = "fin",
+                      .table_name = "fin_ledger_entries",
+                      .column_name = "amount"},
+                     {.term = "churn",
+                      .schema_name = "public",
+                      .table_name = "subscription_events",
+                      .column_name = ""}});
+  }
+};
+
+// Test that terms match whole words, ignoring case and plural endings
+TEST_F(GlossaryTest, FindsTermsInRequest) {
+  Glossary terms = glossary();
+  auto found = terms.find("CHURN of Customers last quarter");
+  ASSERT_EQ(found.size(), 2u);
+  EXPECT_EQ(found[0]->table_name, "subscription_events");
+  EXPECT_EQ(found[1]->table_name, "acct");
+
+  EXPECT_TRUE(terms.find("customerid and churned users").empty());
+}
+
+// Test that multi-word terms need all their words in sequence
+TEST_F(GlossaryTest, MatchesMultiWordTerms) {
+  Glossary terms = glossary();
+  auto found = terms.find("show monthly revenues by region");
+  ASSERT_EQ(found.size(), 1u);
+  EXPECT_EQ(found[0]->schema_name, "fin");
+  EXPECT_EQ(found[0]->column_name, "amount");
+
+  EXPECT_TRUE(terms.find("monthly total revenue").empty());
+  EXPECT_TRUE(Glossary().find("customers").empty());
+}
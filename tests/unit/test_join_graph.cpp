@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "include/join_graph.hpp"
+
+using namespace pg_ai;
+
+class JoinGraphTest : public ::testing::Test {
+ protected:
+  static constexpr uint32_t kCustomers = 1;
+  static constexpr uint32_t kAccounts = 2;
+  static constexpr uint32_t kOrders = 3;
+  static constexpr uint32_t kOrderItems = 4;
+  static constexpr uint32_t kProducts = 5;
+  static constexpr uint32_t kAudit = 6;
+
+  static ForeignKey key(uint32_t relid,
+                        std::string table,
+                        std::string column,
+                        uint32_t referenced_relid,
+                        std::string referenced_table) {
+    return ForeignKey{.relid = relid,
+                      .referenced_relid = referenced_relid,
+                      .table = "public." + table,
+                      .referenced_table = "public." + referenced_table,
+                      .columns = {column},
+                      .referenced_columns = {"id"}};
+  }
+
+  // orders -> accounts -> customers; order_items -> orders, products
+  static JoinGraph graph() {
+    return JoinGraph(
+        {key(kAccounts, "accounts", "customer_id", kCustomers, "customers"),
+         key(kOrders, "orders", "account_id", kAccounts, "accounts"),
+         key(kOrderItems, "order_items", "order_id", kOrders, "orders"),
+         key(kOrderItems, "order_items", "product_id", kProducts, "products"),
+         key(kAudit, "audit", "parent_id", kAudit, "audit")});
+  }
+
+  static bool any(uint32_t) { return true; }
+};
+
+// Test that tables on the shortest path between mentioned ones are bridges
+TEST_F(JoinGraphTest, FindsBridgingTables) {
+  JoinGraph joins = graph();
+  auto bridges = joins.connect({kCustomers, kOrderItems}, any);
+  ASSERT_EQ(bridges.size(), 2u);
+  EXPECT_EQ(bridges[0].relid, kAccounts);
+  EXPECT_EQ(bridges[1].relid, kOrders);
+  ASSERT_EQ(bridges[0].keys.size(), 2u);
+
+  EXPECT_EQ(JoinGraph::formatBridge(bridges[0]),
+            "Join through public.accounts:\n"
+            "  public.orders.account_id = public.accounts.id\n"
+            "  public.accounts.customer_id = public.customers.id\n");
+
+  // Directly joined tables need no bridge
+  EXPECT_TRUE(joins.connect({kOrders, kAccounts}, any).empty());
+}
+
+// Test that long paths and unusable tables are not followed
+TEST_F(JoinGraphTest, LimitsPaths) {
+  JoinGraph joins = graph();
+  auto visible = [](uint32_t relid) { return relid != kAccounts; };
+  EXPECT_TRUE(joins.connect({kCustomers, kOrders}, visible).empty());
+  EXPECT_TRUE(joins.connect({kAudit, kCustomers}, any).empty());
+  EXPECT_TRUE(joins.connect({kCustomers, kProducts}, any).empty());
+
+  // Four joins apart, but orders is connected first
+  auto bridges = joins.connect({kCustomers, kOrders, kProducts}, any);
+  ASSERT_EQ(bridges.size(), 2u);
+  EXPECT_EQ(bridges[0].relid, kAccounts);
+  EXPECT_EQ(bridges[1].relid, kOrderItems);
+  EXPECT_TRUE(JoinGraph().connect({kCustomers, kOrders}, any).empty());
+}
@@ -0,0 +1,135 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "include/keyword_scanner.hpp"
+
+using namespace pg_ai;
+
+class KeywordScannerTest : public ::testing::Test {
+ protected:
+  // Reference implementation: lower-case copies and std::string::find
+  static uint64_t naiveScan(const std::vector<std::string>& keywords,
+                            std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    uint64_t found = 0;
+    for (size_t k = 0; k < keywords.size(); ++k) {
+      std::string keyword = keywords[k];
+      std::transform(keyword.begin(), keyword.end(), keyword.begin(),
+                     ::tolower);
+      if (text.find(keyword) != std::string::npos) {
+        found |= uint64_t{1} << k;
+      }
+    }
+    return found;
+  }
+};
+
+// Test basic matching and the bitmask order
+TEST_F(KeywordScannerTest, FindsKeywords) {
+  KeywordScanner scanner({"does not exist", "no such table", "error:"});
+
+  EXPECT_EQ(scanner.size(), 3u);
+  EXPECT_EQ(scanner.scan("relation does not exist"), 0b001u);
+  EXPECT_EQ(scanner.scan("error: no such table"), 0b110u);
+  EXPECT_EQ(scanner.scan("all good"), 0u);
+  EXPECT_TRUE(scanner.containsAny("no such table here"));
+  EXPECT_FALSE(scanner.containsAny("no such column here"));
+}
+
+// Test that keywords and text are matched case-insensitively
+TEST_F(KeywordScannerTest, CaseInsensitive) {
+  KeywordScanner scanner({"PG_CATALOG", "information_schema"});
+
+  EXPECT_EQ(scanner.scan("select * from pg_catalog.pg_class"), 0b01u);
+  EXPECT_EQ(scanner.scan("SELECT * FROM Information_Schema.tables"), 0b10u);
+  EXPECT_FALSE(scanner.containsAny("SELECT * FROM pg_tables"));
+}
+
+// Test that non-letters are not folded
+TEST_F(KeywordScannerTest, FoldsLettersOnly) {
+  KeywordScanner scanner({"a@b", "x[y"});
+
+  EXPECT_FALSE(scanner.containsAny("A`B"));
+  EXPECT_FALSE(scanner.containsAny("X{Y"));
+  EXPECT_EQ(scanner.scan("A@B X[Y"), 0b11u);
+}
+
+// Test matches at the very start and end of the text
+TEST_F(KeywordScannerTest, MatchesAtBoundaries) {
+  KeywordScanner scanner({"start", "end", "x"});
+
+  EXPECT_EQ(scanner.scan("start"), 0b001u);
+  EXPECT_EQ(scanner.scan("the end"), 0b010u);
+  EXPECT_EQ(scanner.scan("X"), 0b100u);
+  EXPECT_EQ(scanner.scan(""), 0u);
+  EXPECT_EQ(scanner.scan("star"), 0u);
+  EXPECT_EQ(scanner.scan("en"), 0u);
+}
+
+// Test matches at every offset of a text spanning several SIMD blocks
+TEST_F(KeywordScannerTest, MatchesAcrossBlocks) {
+  KeywordScanner scanner({"no such column"});
+  const std::string keyword = "No Such Column";
+
+  for (size_t offset = 0; offset < 130; ++offset) {
+    std::string text(offset, '.');
+    text += keyword;
+    text.append(100, '.');
+    EXPECT_TRUE(scanner.containsAny(text)) << "offset " << offset;
+
+    text.resize(offset + keyword.size() - 1);
+    EXPECT_FALSE(scanner.containsAny(text)) << "offset " << offset;
+  }
+}
+
+// Test near-misses sharing first, second and last bytes with a keyword
+TEST_F(KeywordScannerTest, RejectsNearMisses) {
+  KeywordScanner scanner({"table not found"});
+  std::string text;
+  for (int i = 0; i < 20; ++i) {
+    text += "table nXt found tablE NOT FOUNx ";
+  }
+
+  EXPECT_FALSE(scanner.containsAny(text));
+  EXPECT_TRUE(scanner.containsAny(text + "Table Not Found"));
+}
+
+// Test against the naive implementation on random text
+TEST_F(KeywordScannerTest, MatchesNaiveImplementation) {
+  const std::vector<std::string> keywords = {"ab", "Bca", "a", "cab", "abcabc",
+                                             "b c"};
+  KeywordScanner scanner({"ab", "Bca", "a", "cab", "abcabc", "b c"});
+  KeywordScanner without_a({"bca", "cab", "abcabc", "b c"});
+  const std::vector<std::string> keywords_without_a = {"bca", "cab", "abcabc",
+                                                       "b c"};
+
+  std::mt19937 rng(42);
+  const std::string alphabet = "abcABC ";
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+  std::uniform_int_distribution<size_t> length(0, 200);
+
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    std::string text(length(rng), ' ');
+    for (char& c : text) {
+      c = alphabet[pick(rng)];
+    }
+
+    EXPECT_EQ(scanner.scan(text), naiveScan(keywords, text)) << text;
+    uint64_t expected = naiveScan(keywords_without_a, text);
+    EXPECT_EQ(without_a.scan(text), expected) << text;
+    EXPECT_EQ(without_a.containsAny(text), expected != 0) << text;
+  }
+}
+
+// Test the supported keyword limits
+TEST_F(KeywordScannerTest, RejectsInvalidKeywords) {
+  EXPECT_THROW(KeywordScanner({"ok", ""}), std::invalid_argument);
+
+  EXPECT_NO_THROW(KeywordScanner({}));
+  EXPECT_EQ(KeywordScanner({}).scan("anything"), 0u);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <nlohmann/json.hpp>
+
+#include "include/model_routing.hpp"
+
+using namespace pg_ai;
+
+class ComplexityEstimatorTest : public ::testing::Test {};
+
+// Test that plain lookups stay on the fast tier
+TEST_F(ComplexityEstimatorTest, SimpleRequestsUseFastTier) {
+  for (const char* request :
+       {"count rows in orders", "show all users", "list products under $10",
+        "how many customers are there"}) {
+    auto estimate = ComplexityEstimator::estimate(request, 1);
+    EXPECT_EQ(estimate.tier, ModelTier::kFast) << request;
+    EXPECT_LT(estimate.score, ComplexityEstimator::kStrongThreshold)
+        << request;
+  }
+}
+
+// Test that each signal group adds at most one point
+TEST_F(ComplexityEstimatorTest, ScoresOnePointPerSignalGroup) {
+  EXPECT_EQ(ComplexityEstimator::estimate("average order value", 1).score, 1);
+  EXPECT_EQ(ComplexityEstimator::estimate("orders by month", 1).score, 1);
+  EXPECT_EQ(ComplexityEstimator::estimate("top 5 products", 1).score, 1);
+  EXPECT_EQ(ComplexityEstimator::estimate("compare stores", 1).score, 1);
+
+  // Several keywords from the same group
+  EXPECT_EQ(
+      ComplexityEstimator::estimate("Total and AVERAGE sum per store", 1).score,
+      1);
+}
+
+// Test that combined signals route to the strong tier
+TEST_F(ComplexityEstimatorTest, ComplexRequestsUseStrongTier) {
+  auto estimate = ComplexityEstimator::estimate(
+      "top 10 customers by total revenue in the last quarter", 1);
+  EXPECT_EQ(estimate.score, 3);
+  EXPECT_EQ(estimate.tier, ModelTier::kStrong);
+
+  auto cohort = ComplexityEstimator::estimate(
+      "monthly retention by signup cohort", 1);
+  EXPECT_EQ(cohort.tier, ModelTier::kStrong);
+}
+
+// Test the table and length signals
+TEST_F(ComplexityEstimatorTest, CountsTablesAndLength) {
+  EXPECT_EQ(ComplexityEstimator::estimate("orders", 0).score, 0);
+  EXPECT_EQ(ComplexityEstimator::estimate("orders", 2).score, 1);
+  EXPECT_EQ(ComplexityEstimator::estimate("orders", 3).tier,
+            ModelTier::kStrong);
+  EXPECT_EQ(ComplexityEstimator::estimate("orders", 20).score, 3);
+
+  std::string words;
+  for (int i = 0; i < 25; ++i) {
+    words += "word ";
+  }
+  EXPECT_EQ(ComplexityEstimator::estimate(words, 1).score, 1);
+  words += words;
+  EXPECT_EQ(ComplexityEstimator::estimate(words, 1).score, 2);
+}
+
+class RoutingStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override { RoutingStats::reset(); }
+};
+
+// Test per-tier counters and the JSON report
+TEST_F(RoutingStatsTest, ReportsHitRates) {
+  RoutingStats::record(ModelTier::kFast, true);
+  RoutingStats::record(ModelTier::kFast, true);
+  RoutingStats::record(ModelTier::kFast, true);
+  RoutingStats::record(ModelTier::kFast, false);
+  RoutingStats::record(ModelTier::kStrong, true);
+
+  EXPECT_EQ(RoutingStats::fast().requests, 4u);
+  EXPECT_EQ(RoutingStats::fast().accepted, 3u);
+  EXPECT_EQ(RoutingStats::strong().requests, 1u);
+
+  auto json = nlohmann::json::parse(RoutingStats::toJson());
+  EXPECT_EQ(json["fast"]["requests"], 4);
+  EXPECT_EQ(json["fast"]["escalated"], 1);
+  EXPECT_DOUBLE_EQ(json["fast"]["hit_rate"].get<double>(), 0.75);
+  EXPECT_EQ(json["strong"]["accepted"], 1);
+  EXPECT_DOUBLE_EQ(json["strong"]["hit_rate"].get<double>(), 1.0);
+}
+
+// Test that an empty tier reports a zero hit rate
+TEST_F(RoutingStatsTest, EmptyTierHasZeroHitRate) {
+  auto json = nlohmann::json::parse(RoutingStats::toJson());
+  EXPECT_EQ(json["fast"]["requests"], 0);
+  EXPECT_DOUBLE_EQ(json["fast"]["hit_rate"].get<double>(), 0.0);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "include/output_budget.hpp"
+
+using namespace pg_ai;
+
+class OutputBudgetTest : public ::testing::Test {
+ protected:
+  OutputBudget budgets;
+
+  void recordMany(RequestKind kind, int tokens, int times) {
+    for (int i = 0; i < times; ++i) {
+      budgets.record(kind, tokens);
+    }
+  }
+};
+
+// Test that the configured cap is used until enough samples exist
+TEST_F(OutputBudgetTest, UsesCapUntilWarmedUp) {
+  EXPECT_EQ(budgets.budget(RequestKind::kGenerate, 16384), 16384);
+
+  recordMany(RequestKind::kGenerate, 200,
+             static_cast<int>(OutputBudget::kMinSamples) - 1);
+  EXPECT_EQ(budgets.budget(RequestKind::kGenerate, 16384), 16384);
+
+  budgets.record(RequestKind::kGenerate, 200);
+  EXPECT_LT(budgets.budget(RequestKind::kGenerate, 16384), 16384);
+}
+
+// Test percentile plus headroom, rounding and the lower bound
+TEST_F(OutputBudgetTest, AdaptsToObservedLengths) {
+  recordMany(RequestKind::kGenerate, 400, 20);
+  // 400 * 1.5 = 600, rounded up to a multiple of 64
+  EXPECT_EQ(budgets.budget(RequestKind::kGenerate, 16384), 640);
+
+  OutputBudget small;
+  for (int i = 0; i < 20; ++i) {
+    small.record(RequestKind::kGenerate, 20);
+  }
+  EXPECT_EQ(small.budget(RequestKind::kGenerate, 16384),
+            OutputBudget::kMinBudget);
+}
+
+// Test that the budget never exceeds the configured cap
+TEST_F(OutputBudgetTest, NeverExceedsCap) {
+  recordMany(RequestKind::kExplain, 3000, 20);
+
+  EXPECT_EQ(budgets.budget(RequestKind::kExplain, 4096), 4096);
+  EXPECT_EQ(budgets.budget(RequestKind::kExplain, 100), 100);
+}
+
+// Test that a few long outliers stay above the 95th percentile
+TEST_F(OutputBudgetTest, IgnoresRareOutliers) {
+  recordMany(RequestKind::kGenerate, 300, 60);
+  recordMany(RequestKind::kGenerate, 12000, 2);
+
+  EXPECT_EQ(budgets.budget(RequestKind::kGenerate, 16384), 512);
+
+  // Enough long completions move the percentile up
+  recordMany(RequestKind::kGenerate, 12000, 10);
+  EXPECT_EQ(budgets.budget(RequestKind::kGenerate, 16384), 16384);
+}
+
+// Test that request kinds and old samples are tracked separately
+TEST_F(OutputBudgetTest, KeepsWindowPerKind) {
+  recordMany(RequestKind::kExplain, 2000, 20);
+  EXPECT_EQ(budgets.samples(RequestKind::kExplain), 20u);
+  EXPECT_EQ(budgets.samples(RequestKind::kGenerate), 0u);
+  EXPECT_EQ(budgets.budget(RequestKind::kGenerate, 8192), 8192);
+
+  // The window only remembers the most recent completions
+  recordMany(RequestKind::kExplain, 100,
+             static_cast<int>(OutputBudget::kWindow));
+  EXPECT_EQ(budgets.samples(RequestKind::kExplain), OutputBudget::kWindow);
+  EXPECT_EQ(budgets.budget(RequestKind::kExplain, 8192),
+            OutputBudget::kMinBudget);
+
+  budgets.record(RequestKind::kExplain, 0);
+  budgets.record(RequestKind::kExplain, -5);
+  EXPECT_EQ(budgets.samples(RequestKind::kExplain), OutputBudget::kWindow);
+}
+
+// Test the token estimate used when a provider reports no usage
+TEST_F(OutputBudgetTest, EstimatesTokens) {
+  EXPECT_EQ(OutputBudget::estimateTokens(""), 0);
+  EXPECT_EQ(OutputBudget::estimateTokens("abc"), 1);
+  EXPECT_EQ(OutputBudget::estimateTokens("SELECT * FROM t;"), 4);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "include/plan_cache.hpp"
+
+using namespace pg_ai;
+
+class PlanCacheTest : public ::testing::Test {
+ protected:
+  static PlanCache::Plan plan(uintptr_t id) {
+    return reinterpret_cast<PlanCache::Plan>(id);
+  }
+
+  std::vector<PlanCache::Plan> released_;
+  PlanCache cache_{[this](PlanCache::Plan p) { released_.push_back(p); }};
+};
+
+// Test lookup by query text
+TEST_F(PlanCacheTest, FindsSavedPlans) {
+  EXPECT_EQ(cache_.find("SELECT 1"), nullptr);
+
+  cache_.insert("SELECT 1", plan(1), 4);
+  cache_.insert("SELECT 2", plan(2), 4);
+  EXPECT_EQ(cache_.find("SELECT 1"), plan(1));
+  EXPECT_EQ(cache_.find("SELECT 2"), plan(2));
+  EXPECT_EQ(cache_.find("SELECT 3"), nullptr);
+  EXPECT_TRUE(released_.empty());
+}
+
+// Test that a full cache releases the least recently used plan
+TEST_F(PlanCacheTest, EvictsLeastRecentlyUsed) {
+  cache_.insert("SELECT 1", plan(1), 2);
+  cache_.insert("SELECT 2", plan(2), 2);
+  cache_.find("SELECT 1");
+  cache_.insert("SELECT 3", plan(3), 2);
+
+  EXPECT_EQ(cache_.size(), 2u);
+  EXPECT_EQ(cache_.find("SELECT 2"), nullptr);
+  EXPECT_EQ(cache_.find("SELECT 1"), plan(1));
+  EXPECT_EQ(released_, std::vector<PlanCache::Plan>{plan(2)});
+}
+
+// Test replacing a plan, shrinking to a smaller capacity and clearing
+TEST_F(PlanCacheTest, ReleasesReplacedAndClearedPlans) {
+  cache_.insert("SELECT 1", plan(1), 4);
+  cache_.insert("SELECT 1", plan(11), 4);
+  EXPECT_EQ(cache_.size(), 1u);
+  EXPECT_EQ(cache_.find("SELECT 1"), plan(11));
+  EXPECT_EQ(released_, std::vector<PlanCache::Plan>{plan(1)});
+
+  cache_.insert("SELECT 2", plan(2), 4);
+  cache_.insert("SELECT 3", plan(3), 1);
+  EXPECT_EQ(cache_.size(), 1u);
+  EXPECT_EQ(cache_.find("SELECT 3"), plan(3));
+
+  cache_.clear();
+  EXPECT_EQ(cache_.size(), 0u);
+  EXPECT_EQ(released_.size(), 4u);
+}
+
+// Test dropping the plan of one query
+TEST_F(PlanCacheTest, ErasesOnePlan) {
+  cache_.insert("SELECT 1", plan(1), 4);
+  cache_.insert("SELECT 2", plan(2), 4);
+
+  cache_.erase("SELECT 1");
+  cache_.erase("SELECT 3");
+  EXPECT_EQ(cache_.size(), 1u);
+  EXPECT_EQ(cache_.find("SELECT 1"), nullptr);
+  EXPECT_EQ(cache_.find("SELECT 2"), plan(2));
+  EXPECT_EQ(released_, std::vector<PlanCache::Plan>{plan(1)});
+}
@@ -179,6 +179,44 @@ TEST_F(ProviderSelectorTest, MinimalConfigOpenAIOnly) {
   EXPECT_FALSE(result_anthropic.success);
 }
 
+// Test that 'auto' uses the session profile's provider
+TEST_F(ProviderSelectorTest, AutoUsesSessionProfileProvider) {
+  ConfigManager::getMutableConfig().profile.provider = Provider::GEMINI;
+  ConfigManager::markChanged();
+
+  auto result = ProviderSelector::selectProvider("", "auto");
+  EXPECT_TRUE(result.success);
+  EXPECT_EQ(result.provider, Provider::GEMINI);
+  EXPECT_EQ(result.api_key_source, "gemini_config");
+
+  // An explicit provider still wins
+  auto explicit_result = ProviderSelector::selectProvider("", "anthropic");
+  EXPECT_EQ(explicit_result.provider, Provider::ANTHROPIC);
+}
+
+// Test that the selected config carries the session profile overrides
+TEST_F(ProviderSelectorTest, AppliesSessionProfileOverrides) {
+  auto& profile = ConfigManager::getMutableConfig().profile;
+  profile.provider = Provider::OPENAI;
+  profile.model = "gpt-4.1-nano";
+  profile.max_tokens = 256;
+  ConfigManager::markChanged();
+
+  auto result = ProviderSelector::selectProvider("", "");
+  ASSERT_TRUE(result.success);
+  ASSERT_NE(result.config, nullptr);
+  EXPECT_EQ(result.config->default_model, "gpt-4.1-nano");
+  EXPECT_EQ(result.config->default_max_tokens, 256);
+  EXPECT_EQ(result.config->default_temperature,
+            ConfigManager::getProviderConfig(Provider::OPENAI)
+                ->default_temperature);
+
+  // Overrides for OpenAI leave other providers alone
+  auto anthropic = ProviderSelector::selectProvider("", "anthropic");
+  ASSERT_NE(anthropic.config, nullptr);
+  EXPECT_NE(anthropic.config->default_model, "gpt-4.1-nano");
+}
+
 // Test that ProviderSelectionResult has expected default values
 TEST(ProviderSelectionResultTest, DefaultValues) {
   ProviderSelectionResult result;
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include "include/query_history.hpp"
+
+using namespace pg_ai;
+
+class TrigramSetTest : public ::testing::Test {};
+
+// Test that trigrams match pg_trgm's similarity()
+TEST_F(TrigramSetTest, MatchesPgTrgmSimilarity) {
+  // SELECT similarity('word', 'two words') = 0.36363637
+  EXPECT_NEAR(TrigramSet("word").similarity(TrigramSet("two words")),
+              4.0 / 11.0, 1e-9);
+  EXPECT_EQ(TrigramSet("word").size(), 5u);
+}
+
+// Test that case and punctuation are ignored
+TEST_F(TrigramSetTest, IgnoresCaseAndPunctuation) {
+  EXPECT_DOUBLE_EQ(
+      TrigramSet("How many orders?").similarity(TrigramSet("how many ORDERS")),
+      1.0);
+  EXPECT_DOUBLE_EQ(TrigramSet("").similarity(TrigramSet("orders")), 0.0);
+  EXPECT_DOUBLE_EQ(TrigramSet("?!").similarity(TrigramSet("?!")), 0.0);
+}
+
+class QueryHistoryTest : public ::testing::Test {
+ protected:
+  static std::vector<HistoryExample> history() {
+    // Newest first, as loaded from pg_ai_query_history
+    return {
+        {.natural_language = "active customers by region",
+         .query = "SELECT region, count(*) FROM customers WHERE active "
+                  "GROUP BY region"},
+        {.natural_language = "revenue per month",
+         .query = "SELECT date_trunc('month', paid_at), sum(amount) FROM "
+                  "payments GROUP BY 1"},
+        {.natural_language = "active customers by region",
+         .query = "SELECT region, count(*) FROM customers GROUP BY region"},
+        {.natural_language = "list all suppliers",
+         .query = "SELECT * FROM suppliers"},
+    };
+  }
+};
+
+// Test ranking, the similarity floor and k
+TEST_F(QueryHistoryTest, ReturnsNearestExamples) {
+  auto examples = QueryHistory::nearest("monthly revenue", history(), 3, 0.3);
+  ASSERT_EQ(examples.size(), 1u);
+  EXPECT_EQ(examples[0].natural_language, "revenue per month");
+  EXPECT_GT(examples[0].similarity, 0.3);
+  EXPECT_LT(examples[0].similarity, 1.0);
+
+  EXPECT_TRUE(QueryHistory::nearest("monthly revenue", history(), 0, 0.0)
+                  .empty());
+  EXPECT_EQ(QueryHistory::nearest("monthly revenue", history(), 2, 0.0).size(),
+            2u);
+}
+
+// Test that a repeated request keeps only its newest accepted query
+TEST_F(QueryHistoryTest, PrefersNewestOfRepeatedRequests) {
+  auto examples =
+      QueryHistory::nearest("Active customers by region", history(), 3, 0.3);
+  ASSERT_EQ(examples.size(), 1u);
+  EXPECT_DOUBLE_EQ(examples[0].similarity, 1.0);
+  EXPECT_NE(examples[0].query.find("WHERE active"), std::string::npos);
+}
+
+// Test the prompt section
+TEST_F(QueryHistoryTest, FormatsExamples) {
+  EXPECT_EQ(QueryHistory::formatExamples({}), "");
+
+  std::string text = QueryHistory::formatExamples(
+      {{.natural_language = "list all suppliers",
+        .query = "SELECT * FROM suppliers"}});
+  EXPECT_EQ(text,
+            "Previously accepted queries for similar requests:\n"
+            "\nRequest: list all suppliers\n"
+            "SQL: SELECT * FROM suppliers\n");
+}
+
+// Test that the schema version follows the set of tables
+TEST_F(QueryHistoryTest, SchemaVersionTracksTables) {
+  auto schema = [](std::initializer_list<const char*> tables) {
+    DatabaseSchema result{.tables = {}, .success = true};
+    for (const char* table : tables) {
+      result.tables.push_back(TableInfo{.table_name = table,
+                                        .schema_name = "public",
+                                        .table_type = "BASE TABLE",
+                                        .estimated_rows = 0});
+    }
+    return result;
+  };
+
+  std::string version = QueryHistory::schemaVersion(schema({"a", "b"}));
+  EXPECT_EQ(version.size(), 16u);
+  EXPECT_EQ(version, QueryHistory::schemaVersion(schema({"a", "b"})));
+  EXPECT_NE(version, QueryHistory::schemaVersion(schema({"a", "b", "c"})));
+  EXPECT_NE(version, QueryHistory::schemaVersion(schema({"ab"})));
+
+  // Row estimates change constantly and must not change the version
+  auto busy = schema({"a", "b"});
+  busy.tables[0].estimated_rows = 1000;
+  EXPECT_EQ(version, QueryHistory::schemaVersion(busy));
+
+  EXPECT_EQ(QueryHistory::schemaVersion(DatabaseSchema{.success = false}), "");
+}
@@ -310,6 +310,48 @@ TEST_F(QueryParserTest, ParseResponse_DefaultVisualization) {
   EXPECT_EQ(result.suggested_visualization, "table");
 }
 
+TEST_F(QueryParserTest, ParseResponse_IgnoresNestedFields) {
+  std::string response = R"({
+        "metadata": {"sql": "DROP TABLE users", "warnings": ["nested"]},
+        "sql": "SELECT * FROM users",
+        "explanation": "Query",
+        "warnings": ["Outer", {"text": "skipped"}, 42]
+    })";
+
+  QueryResult result = QueryParser::parseQueryResponse(response);
+
+  EXPECT_TRUE(result.success);
+  EXPECT_EQ(result.generated_query, "SELECT * FROM users");
+  ASSERT_EQ(result.warnings.size(), 1);
+  EXPECT_EQ(result.warnings[0], "Outer");
+}
+
+TEST_F(QueryParserTest, ParseResponse_MarkdownAfterOtherFence) {
+  std::string response = R"(Previous attempt:
+```sql
+SELECT 1
+```
+Corrected:
+```JSON
+{"sql": "SELECT id FROM orders", "suggested_visualization": "bar"}
+```)";
+
+  QueryResult result = QueryParser::parseQueryResponse(response);
+
+  EXPECT_TRUE(result.success);
+  EXPECT_EQ(result.generated_query, "SELECT id FROM orders");
+  EXPECT_EQ(result.suggested_visualization, "bar");
+}
+
+TEST_F(QueryParserTest, ParseResponse_NonObjectJSONIsRawSQL) {
+  std::string response = R"(["SELECT 1"])";
+
+  QueryResult result = QueryParser::parseQueryResponse(response);
+
+  EXPECT_TRUE(result.success);
+  EXPECT_EQ(result.generated_query, response);
+}
+
 // Test with fixture files
 TEST_F(QueryParserTest, ParseResponse_ValidQueryFixture) {
   std::string response = readResponseFixture("valid_query_response.json");
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include "include/query_templates.hpp"
+
+using namespace pg_ai;
+
+class QueryTemplatesTest : public ::testing::Test {
+ protected:
+  static ColumnInfo column(const char* name,
+                           const char* type,
+                           bool primary_key = false) {
+    return ColumnInfo{.column_name = name,
+                      .data_type = type,
+                      .is_nullable = !primary_key,
+                      .column_default = "",
+                      .is_primary_key = primary_key,
+                      .is_foreign_key = false,
+                      .foreign_table = "",
+                      .foreign_column = ""};
+  }
+
+  static TableDetails table(const char* name,
+                            std::initializer_list<ColumnInfo> columns) {
+    return TableDetails{.table_name = name,
+                        .schema_name = "public",
+                        .columns = columns,
+                        .indexes = {},
+                        .success = true,
+                        .error_message = ""};
+  }
+
+  TableDetails orders =
+      table("orders", {column("id", "integer", true),
+                       column("customer_id", "integer"),
+                       column("total", "numeric"), column("status", "text"),
+                       column("created_at", "timestamp with time zone"),
+                       column("shipped_at", "timestamp with time zone")});
+};
+
+// Test shape detection from wording alone
+TEST_F(QueryTemplatesTest, DetectsShapes) {
+  EXPECT_EQ(QueryTemplates::detect("how many orders are there?"),
+            TemplateShape::kCount);
+  EXPECT_EQ(QueryTemplates::detect("top 5 orders by total"),
+            TemplateShape::kTopN);
+  EXPECT_EQ(QueryTemplates::detect("orders in the last 7 days"),
+            TemplateShape::kRecent);
+  EXPECT_EQ(QueryTemplates::detect("get order with id 42"),
+            TemplateShape::kLookup);
+  EXPECT_EQ(QueryTemplates::detect("monthly revenue per store"),
+            TemplateShape::kNone);
+}
+
+// Test the count template
+TEST_F(QueryTemplatesTest, CountsRows) {
+  for (const char* request :
+       {"how many orders are there?", "Count all orders",
+        "number of rows in the orders table"}) {
+    auto match = QueryTemplates::match(request, orders, 1000);
+    ASSERT_TRUE(match.has_value()) << request;
+    EXPECT_EQ(match->sql,
+              "SELECT COUNT(*) AS count FROM \"public\".\"orders\";");
+    EXPECT_DOUBLE_EQ(match->confidence, 1.0) << request;
+    EXPECT_FALSE(match->row_limit_applied);
+  }
+}
+
+// Test top-N ordering, direction and the row limit
+TEST_F(QueryTemplatesTest, TopNByColumn) {
+  auto top = QueryTemplates::match("show the top 5 orders by total", orders,
+                                   1000);
+  ASSERT_TRUE(top.has_value());
+  EXPECT_EQ(top->sql,
+            "SELECT * FROM \"public\".\"orders\" ORDER BY \"total\" DESC "
+            "NULLS LAST LIMIT 5;");
+  EXPECT_DOUBLE_EQ(top->confidence, 1.0);
+
+  auto bottom = QueryTemplates::match("bottom 3 orders by total", orders,
+                                      std::nullopt);
+  ASSERT_TRUE(bottom.has_value());
+  EXPECT_EQ(bottom->sql,
+            "SELECT * FROM \"public\".\"orders\" ORDER BY \"total\" ASC "
+            "LIMIT 3;");
+
+  auto capped = QueryTemplates::match("top 5000 orders by total", orders, 100);
+  ASSERT_TRUE(capped.has_value());
+  EXPECT_TRUE(capped->row_limit_applied);
+  EXPECT_NE(capped->sql.find("LIMIT 100;"), std::string::npos);
+
+  // Text columns and unknown columns are not ranked
+  EXPECT_FALSE(QueryTemplates::match("top 5 orders by status", orders, 1000));
+  EXPECT_FALSE(QueryTemplates::match("top 5 orders by price", orders, 1000));
+}
+
+// Test recent rows with a named and an inferred timestamp column
+TEST_F(QueryTemplatesTest, RecentRows) {
+  auto named = QueryTemplates::match("orders by shipped_at in the last 2 weeks",
+                                     orders, 1000);
+  ASSERT_TRUE(named.has_value());
+  EXPECT_EQ(named->sql,
+            "SELECT * FROM \"public\".\"orders\" WHERE \"shipped_at\" >= "
+            "now() - interval '2 weeks' ORDER BY \"shipped_at\" DESC "
+            "LIMIT 1000;");
+  EXPECT_TRUE(named->row_limit_applied);
+  EXPECT_DOUBLE_EQ(named->confidence, 1.0);
+
+  // created_at is preferred among several timestamp columns
+  auto inferred =
+      QueryTemplates::match("new orders from the past day", orders,
+                            std::nullopt);
+  ASSERT_TRUE(inferred.has_value());
+  EXPECT_NE(inferred->sql.find("\"created_at\" >= now() - interval '1 day'"),
+            std::string::npos);
+  EXPECT_EQ(inferred->sql.find("LIMIT"), std::string::npos);
+  EXPECT_DOUBLE_EQ(inferred->confidence, 0.9);
+
+  auto no_timestamp = table("tags", {column("name", "text", true)});
+  EXPECT_FALSE(
+      QueryTemplates::match("tags in the last 7 days", no_timestamp, 1000));
+}
+
+// Test primary key lookups and literal quoting
+TEST_F(QueryTemplatesTest, LookupByKey) {
+  for (const char* request :
+       {"get order with id 42", "orders where id = 42", "order #42",
+        "show order 42"}) {
+    auto match = QueryTemplates::match(request, orders, 1000);
+    ASSERT_TRUE(match.has_value()) << request;
+    EXPECT_EQ(match->sql,
+              "SELECT * FROM \"public\".\"orders\" WHERE \"id\" = 42;");
+    EXPECT_DOUBLE_EQ(match->confidence, 1.0) << request;
+  }
+
+  // Non-numeric values never reach an integer key
+  EXPECT_FALSE(QueryTemplates::match("order with id abc", orders, 1000));
+
+  auto users = table("users", {column("username", "text", true)});
+  auto by_name = QueryTemplates::match("user with id O'Brien", users, 1000);
+  ASSERT_TRUE(by_name.has_value());
+  EXPECT_EQ(by_name->sql,
+            "SELECT * FROM \"public\".\"users\" WHERE \"username\" = "
+            "'O''Brien';");
+}
+
+// Test that words a template does not understand lower its confidence
+TEST_F(QueryTemplatesTest, UnknownWordsLowerConfidence) {
+  auto filtered =
+      QueryTemplates::match("how many pending orders", orders, 1000);
+  ASSERT_TRUE(filtered.has_value());
+  EXPECT_DOUBLE_EQ(filtered->confidence, 0.5);
+
+  auto grouped =
+      QueryTemplates::match("count orders per status per customer", orders,
+                            1000);
+  ASSERT_TRUE(grouped.has_value());
+  EXPECT_LT(grouped->confidence, 0.1);
+}
+
+// Test that requests naming another table are not answered
+TEST_F(QueryTemplatesTest, RequiresNamedTable) {
+  EXPECT_FALSE(QueryTemplates::match("how many customers", orders, 1000));
+  EXPECT_FALSE(
+      QueryTemplates::match("how many customer_orders", orders, 1000));
+  EXPECT_FALSE(
+      QueryTemplates::match("monthly revenue per store", orders, 1000));
+}
+
+// Test singular and plural table names
+TEST_F(QueryTemplatesTest, MatchesSingularTableNames) {
+  auto categories = table("categories", {column("id", "bigint", true)});
+  auto match = QueryTemplates::match("category 7", categories, 1000);
+  ASSERT_TRUE(match.has_value());
+  EXPECT_EQ(match->sql,
+            "SELECT * FROM \"public\".\"categories\" WHERE \"id\" = 7;");
+  EXPECT_STREQ(QueryTemplates::shapeName(match->shape), "lookup");
+}
@@ -21,7 +21,8 @@ class ResponseFormatterTest : public ::testing::Test {
                        .row_limit_applied = false,
                        .suggested_visualization = "table",
                        .success = true,
-                       .error_message = ""};
+                       .error_message = "",
+                       .source = ""};
   }
 
   QueryResult createResultWithWarnings() {
@@ -31,7 +32,8 @@ class ResponseFormatterTest : public ::testing::Test {
                        .row_limit_applied = true,
                        .suggested_visualization = "table",
                        .success = true,
-                       .error_message = ""};
+                       .error_message = "",
+                       .source = ""};
   }
 
   Configuration createConfig(bool formatted,
@@ -117,6 +119,24 @@ TEST_F(ResponseFormatterTest, PlainTextWithRowLimitNote) {
               testing::HasSubstr("Row limit was automatically applied"));
 }
 
+// Test plain text output notes answers not generated by a provider
+TEST_F(ResponseFormatterTest, PlainTextWithTemplateSourceNote) {
+  auto result = createBasicResult();
+  auto config = createConfig(false, false, false, false);
+
+  result.source = "provider";
+  EXPECT_THAT(ResponseFormatter::formatResponse(result, config),
+              testing::Not(testing::HasSubstr("query template")));
+
+  result.source = "template";
+  EXPECT_THAT(ResponseFormatter::formatResponse(result, config),
+              testing::HasSubstr("Generated locally from a query template"));
+
+  result.source = "history";
+  EXPECT_THAT(ResponseFormatter::formatResponse(result, config),
+              testing::HasSubstr("Previously accepted query"));
+}
+
 // Test plain text output with all options enabled
 TEST_F(ResponseFormatterTest, PlainTextAllOptions) {
   auto result = createResultWithWarnings();
@@ -211,6 +231,19 @@ TEST_F(ResponseFormatterTest, JSONNoRowLimitWhenFalse) {
   EXPECT_FALSE(j.contains("row_limit_applied"));
 }
 
+// Test JSON output includes the source when set
+TEST_F(ResponseFormatterTest, JSONWithSource) {
+  auto result = createBasicResult();
+  auto config = createConfig(true, false, false, false);
+
+  json j = json::parse(ResponseFormatter::formatResponse(result, config));
+  EXPECT_FALSE(j.contains("source"));
+
+  result.source = "template";
+  j = json::parse(ResponseFormatter::formatResponse(result, config));
+  EXPECT_EQ(j["source"], "template");
+}
+
 // Test JSON output with all options
 TEST_F(ResponseFormatterTest, JSONAllOptions) {
   auto result = createResultWithWarnings();
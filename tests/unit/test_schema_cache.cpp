@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include "include/schema_cache.hpp"
+
+using namespace pg_ai;
+
+class SchemaCacheTest : public ::testing::Test {
+ protected:
+  static DatabaseSchema schema() {
+    DatabaseSchema schema{.tables = {}, .success = true, .error_message = ""};
+    schema.tables.push_back(TableInfo{.table_name = "customers",
+                                      .schema_name = "public",
+                                      .table_type = "BASE TABLE",
+                                      .estimated_rows = 10,
+                                      .relid = 100});
+    schema.tables.push_back(TableInfo{.table_name = "orders",
+                                      .schema_name = "public",
+                                      .table_type = "BASE TABLE",
+                                      .estimated_rows = 50,
+                                      .relid = 200});
+    schema.tables.push_back(TableInfo{.table_name = "payments",
+                                      .schema_name = "public",
+                                      .table_type = "BASE TABLE",
+                                      .estimated_rows = 20,
+                                      .relid = 300});
+    return schema;
+  }
+
+  static TableDetails details(const char* table_name,
+                              const char* foreign_table = "") {
+    TableDetails details{.table_name = table_name,
+                         .schema_name = "public",
+                         .columns = {},
+                         .indexes = {},
+                         .success = true,
+                         .error_message = ""};
+    details.columns.push_back(ColumnInfo{.column_name = "id",
+                                         .data_type = "integer",
+                                         .is_nullable = false,
+                                         .column_default = "",
+                                         .is_primary_key = true,
+                                         .is_foreign_key = false,
+                                         .foreign_table = "",
+                                         .foreign_column = ""});
+    if (*foreign_table != '\0') {
+      details.columns.push_back(ColumnInfo{.column_name = "ref_id",
+                                           .data_type = "integer",
+                                           .is_nullable = false,
+                                           .column_default = "",
+                                           .is_primary_key = false,
+                                           .is_foreign_key = true,
+                                           .foreign_table = foreign_table,
+                                           .foreign_column = "id"});
+    }
+    return details;
+  }
+
+  static SchemaCache filled() {
+    SchemaCache cache;
+    cache.advance(1, std::nullopt);
+    cache.storeTables(schema());
+    cache.storeDetails(details("customers"));
+    cache.storeDetails(details("orders", "customers"));
+    cache.storeDetails(details("payments"));
+    return cache;
+  }
+};
+
+// Test that data is kept while the version stays the same
+TEST_F(SchemaCacheTest, ReusesDataAtSameVersion) {
+  SchemaCache cache = filled();
+  cache.advance(1, std::vector<uint32_t>{100});
+
+  ASSERT_NE(cache.tables(), nullptr);
+  EXPECT_EQ(cache.tables()->tables.size(), 3u);
+  ASSERT_NE(cache.details("public", "orders"), nullptr);
+  EXPECT_EQ(cache.details("public", "orders")->columns.size(), 2u);
+  EXPECT_EQ(cache.details("sales", "orders"), nullptr);
+
+  // Tables missing from the table list are not cached
+  cache.storeDetails(details("refunds"));
+  EXPECT_EQ(cache.details("public", "refunds"), nullptr);
+}
+
+// Test that a change drops the changed table and tables referencing it
+TEST_F(SchemaCacheTest, DropsChangedTables) {
+  SchemaCache cache = filled();
+  cache.advance(2, std::vector<uint32_t>{100});
+
+  EXPECT_EQ(cache.version(), std::optional<uint64_t>(2));
+  EXPECT_EQ(cache.tables(), nullptr);
+  EXPECT_EQ(cache.staleTables(), std::vector<uint32_t>{100});
+  EXPECT_EQ(cache.details("public", "customers"), nullptr);
+  EXPECT_EQ(cache.details("public", "orders"), nullptr);
+  EXPECT_NE(cache.details("public", "payments"), nullptr);
+}
+
+// Test that changed rows of the table list are patched in order
+TEST_F(SchemaCacheTest, PatchesChangedTables) {
+  SchemaCache cache = filled();
+
+  // customers renamed to clients, payments dropped, refunds created
+  cache.advance(2, std::vector<uint32_t>{100, 300, 400});
+  EXPECT_EQ(cache.staleTables(), (std::vector<uint32_t>{100, 300, 400}));
+  DatabaseSchema fresh{.tables = {}, .success = true, .error_message = ""};
+  fresh.tables.push_back(TableInfo{.table_name = "clients",
+                                   .schema_name = "public",
+                                   .table_type = "BASE TABLE",
+                                   .estimated_rows = 10,
+                                   .relid = 100});
+  fresh.tables.push_back(TableInfo{.table_name = "refunds",
+                                   .schema_name = "public",
+                                   .table_type = "BASE TABLE",
+                                   .estimated_rows = 0,
+                                   .relid = 400});
+  cache.patchTables(fresh);
+
+  ASSERT_NE(cache.tables(), nullptr);
+  std::vector<std::string> names;
+  for (const auto& table : cache.tables()->tables) {
+    names.emplace_back(table.table_name);
+  }
+  EXPECT_EQ(names, (std::vector<std::string>{"clients", "orders", "refunds"}));
+
+  // A failed read drops the list
+  cache.advance(3, std::vector<uint32_t>{200});
+  cache.patchTables(DatabaseSchema{
+      .tables = {}, .success = false, .error_message = "failed"});
+  EXPECT_EQ(cache.tables(), nullptr);
+  EXPECT_TRUE(cache.staleTables().empty());
+}
+
+// Test that a table list from an older version waits for its stale rows
+TEST_F(SchemaCacheTest, StoresOlderTableList) {
+  SchemaCache cache;
+  cache.advance(5, std::nullopt);
+  cache.storeTables(schema(), {200});
+  EXPECT_EQ(cache.tables(), nullptr);
+  EXPECT_EQ(cache.staleTables(), (std::vector<uint32_t>{200}));
+
+  cache.patchTables(
+      DatabaseSchema{.tables = {}, .success = true, .error_message = ""});
+  ASSERT_NE(cache.tables(), nullptr);
+  EXPECT_EQ(cache.tables()->tables.size(), 2u);
+}
+
+// Test that the glossary is dropped when its table changes
+TEST_F(SchemaCacheTest, DropsChangedGlossary) {
+  SchemaCache cache = filled();
+  cache.storeGlossary(
+      900, Glossary({{.term = "clients",
+                      .schema_name = "public",
+                      .table_name = "customers",
+                      .column_name = ""}}));
+  ASSERT_NE(cache.glossary(), nullptr);
+
+  cache.advance(2, std::vector<uint32_t>{200});
+  EXPECT_NE(cache.glossary(), nullptr);
+  cache.advance(3, std::vector<uint32_t>{900});
+  EXPECT_EQ(cache.glossary(), nullptr);
+}
+
+// Test that the foreign key graph is dropped when any table changes
+TEST_F(SchemaCacheTest, DropsJoinGraphOnChange) {
+  SchemaCache cache = filled();
+  cache.storeGlossary(900, Glossary());
+  cache.storeJoinGraph(JoinGraph({ForeignKey{.relid = 200,
+                                             .referenced_relid = 100,
+                                             .table = "public.orders",
+                                             .referenced_table =
+                                                 "public.customers",
+                                             .columns = {"customer_id"},
+                                             .referenced_columns = {"id"}}}));
+  ASSERT_NE(cache.joinGraph(), nullptr);
+
+  cache.advance(2, std::vector<uint32_t>{900});
+  EXPECT_NE(cache.joinGraph(), nullptr);
+  cache.advance(3, std::vector<uint32_t>{555});
+  EXPECT_EQ(cache.joinGraph(), nullptr);
+}
+
+// Test that unknown changes drop everything
+TEST_F(SchemaCacheTest, DropsEverythingForUnknownChanges) {
+  SchemaCache cache = filled();
+  cache.advance(2, std::nullopt);
+
+  EXPECT_EQ(cache.tables(), nullptr);
+  EXPECT_EQ(cache.details("public", "payments"), nullptr);
+
+  cache.clear();
+  EXPECT_FALSE(cache.version().has_value());
+}
+
+// Test that each role has its own cache, and the least recent one goes
+TEST_F(SchemaCacheTest, KeepsCachePerRole) {
+  SchemaCache& first = SchemaCache::forRole(10);
+  first.advance(1, std::nullopt);
+  first.storeTables(schema());
+  EXPECT_EQ(SchemaCache::forRole(11).tables(), nullptr);
+  EXPECT_NE(SchemaCache::forRole(10).tables(), nullptr);
+
+  for (uint32_t role = 20; role < 20 + SchemaCache::kMaxRoles - 1; ++role) {
+    SchemaCache::forRole(role);
+  }
+  // 11 was used less recently than 10, and went first
+  EXPECT_NE(SchemaCache::forRole(10).tables(), nullptr);
+  for (uint32_t role = 40; role < 40 + SchemaCache::kMaxRoles; ++role) {
+    SchemaCache::forRole(role);
+  }
+  EXPECT_EQ(SchemaCache::forRole(10).tables(), nullptr);
+}
+
+// Test that a change in role memberships drops every role's cache
+TEST_F(SchemaCacheTest, DropsRoleCachesWhenMembershipsChange) {
+  for (uint32_t role : {10u, 11u}) {
+    SchemaCache& cache = SchemaCache::forRole(role, 1);
+    cache.advance(1, std::nullopt);
+    cache.storeTables(schema());
+  }
+  EXPECT_NE(SchemaCache::forRole(10, 1).tables(), nullptr);
+
+  EXPECT_EQ(SchemaCache::forRole(11, 2).tables(), nullptr);
+  EXPECT_EQ(SchemaCache::forRole(10, 2).tables(), nullptr);
+}
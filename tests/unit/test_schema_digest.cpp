@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "include/schema_digest.hpp"
+
+using namespace pg_ai;
+
+class SchemaDigestTest : public ::testing::Test {};
+
+// Test that stored details come back unchanged
+TEST_F(SchemaDigestTest, RoundTripsDetails) {
+  TableDetails details{.table_name = "orders",
+                       .schema_name = "sales",
+                       .columns = {},
+                       .indexes = {},
+                       .success = true,
+                       .error_message = "",
+                       .description = "One row per checkout"};
+  details.columns.push_back(ColumnInfo{.column_name = "id",
+                                       .data_type = "integer",
+                                       .is_nullable = false,
+                                       .column_default = "nextval('s')",
+                                       .is_primary_key = true,
+                                       .is_foreign_key = false,
+                                       .foreign_table = "",
+                                       .foreign_column = ""});
+  details.columns.push_back(ColumnInfo{.column_name = "customer_id",
+                                       .data_type = "integer",
+                                       .is_nullable = true,
+                                       .column_default = "",
+                                       .is_primary_key = false,
+                                       .is_foreign_key = true,
+                                       .foreign_table = "customers",
+                                       .foreign_column = "id",
+                                       .description = "NULL for guests"});
+  details.indexes.emplace_back(
+      "CREATE UNIQUE INDEX orders_pkey ON sales.orders USING btree (id)");
+
+  auto restored =
+      SchemaDigest::fromJson(SchemaDigest::toJson(details).dump());
+  ASSERT_TRUE(restored.has_value());
+  EXPECT_TRUE(restored->success);
+  EXPECT_EQ(restored->schema_name, "sales");
+  EXPECT_EQ(restored->table_name, "orders");
+  EXPECT_EQ(restored->description, "One row per checkout");
+  ASSERT_EQ(restored->columns.size(), 2u);
+  EXPECT_EQ(restored->columns[0].column_default, "nextval('s')");
+  EXPECT_TRUE(restored->columns[0].is_primary_key);
+  EXPECT_TRUE(restored->columns[1].is_nullable);
+  EXPECT_EQ(restored->columns[1].foreign_table, "customers");
+  EXPECT_EQ(restored->columns[1].foreign_column, "id");
+  EXPECT_TRUE(restored->columns[0].description.empty());
+  EXPECT_EQ(restored->columns[1].description, "NULL for guests");
+  EXPECT_EQ(restored->indexes, details.indexes);
+}
+
+// Test that malformed digest rows are rejected
+TEST_F(SchemaDigestTest, RejectsMalformedJson) {
+  EXPECT_FALSE(SchemaDigest::fromJson("not json").has_value());
+  EXPECT_FALSE(SchemaDigest::fromJson("[]").has_value());
+  EXPECT_FALSE(
+      SchemaDigest::fromJson(R"({"table_name": "orders"})").has_value());
+  EXPECT_FALSE(
+      SchemaDigest::fromJson(R"({"columns": [1], "indexes": []})")
+          .has_value());
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "include/schema_index.hpp"
+
+using namespace pg_ai;
+
+class SchemaIndexTest : public ::testing::Test {
+ protected:
+  static DatabaseSchema schema() {
+    DatabaseSchema schema{.tables = {}, .success = true, .error_message = ""};
+    for (const char* name : {"customers", "orders", "order_items"}) {
+      schema.tables.push_back(TableInfo{.table_name = name,
+                                        .schema_name = "public",
+                                        .table_type = "BASE TABLE",
+                                        .estimated_rows = 10,
+                                        .relid = 0});
+    }
+    return schema;
+  }
+
+  static std::vector<TableDetails> details() {
+    TableDetails customers{.table_name = "customers",
+                           .schema_name = "public",
+                           .columns = {},
+                           .indexes = {},
+                           .success = true,
+                           .error_message = ""};
+    customers.columns.push_back(ColumnInfo{.column_name = "id",
+                                           .data_type = "integer",
+                                           .is_nullable = false,
+                                           .column_default = "",
+                                           .is_primary_key = true,
+                                           .is_foreign_key = false,
+                                           .foreign_table = "",
+                                           .foreign_column = ""});
+    customers.columns.push_back(ColumnInfo{.column_name = "email",
+                                           .data_type = "text",
+                                           .is_nullable = true,
+                                           .column_default = "",
+                                           .is_primary_key = false,
+                                           .is_foreign_key = false,
+                                           .foreign_table = "",
+                                           .foreign_column = ""});
+    return {customers};
+  }
+};
+
+// Test that exact and prefix matches rank first
+TEST_F(SchemaIndexTest, RanksExactAndPrefixMatches) {
+  SchemaIndex index(schema(), details());
+  EXPECT_EQ(index.size(), 5u);
+
+  auto exact = index.search("Orders", 10);
+  ASSERT_FALSE(exact.empty());
+  EXPECT_EQ(exact[0].table_name, "orders");
+  EXPECT_DOUBLE_EQ(exact[0].score, 1.0);
+  EXPECT_TRUE(exact[0].column_name.empty());
+  EXPECT_EQ(exact[0].snippet, "BASE TABLE, ~10 rows");
+
+  auto prefix = index.search("ord", 2);
+  ASSERT_EQ(prefix.size(), 2u);
+  EXPECT_EQ(prefix[0].table_name, "orders");
+  EXPECT_EQ(prefix[1].table_name, "order_items");
+  EXPECT_GE(prefix[1].score, 0.5);
+}
+
+// Test that columns are found through their table's name
+TEST_F(SchemaIndexTest, FindsColumnsWithTableContext) {
+  SchemaIndex index(schema(), details());
+
+  auto matches = index.search("customer email", 1);
+  ASSERT_EQ(matches.size(), 1u);
+  EXPECT_EQ(matches[0].table_name, "customers");
+  EXPECT_EQ(matches[0].column_name, "email");
+  EXPECT_EQ(matches[0].snippet, "text");
+
+  auto id = index.search("id", 10);
+  ASSERT_FALSE(id.empty());
+  EXPECT_EQ(id[0].column_name, "id");
+  EXPECT_EQ(id[0].snippet, "integer, primary key, not null");
+
+  EXPECT_TRUE(index.search("   ", 10).empty());
+  EXPECT_TRUE(index.search("zzzz", 10).empty());
+}
+
+// Test that glossary terms find the tables and columns they name
+TEST_F(SchemaIndexTest, FindsGlossaryTerms) {
+  Glossary glossary({{.term = "clients",
+                      .schema_name = "public",
+                      .table_name = "customers",
+                      .column_name = ""},
+                     {.term = "contact address",
+                      .schema_name = "public",
+                      .table_name = "customers",
+                      .column_name = "email"},
+                     {.term = "invoices",
+                      .schema_name = "public",
+                      .table_name = "missing",
+                      .column_name = ""}});
+  SchemaIndex index(schema(), details(), glossary);
+  EXPECT_EQ(index.size(), 7u);
+
+  auto clients = index.search("clients", 10);
+  ASSERT_FALSE(clients.empty());
+  EXPECT_EQ(clients[0].table_name, "customers");
+  EXPECT_TRUE(clients[0].column_name.empty());
+  EXPECT_DOUBLE_EQ(clients[0].score, 1.0);
+  EXPECT_EQ(clients[0].snippet, "glossary: clients");
+
+  auto contact = index.search("contact", 10);
+  ASSERT_EQ(contact.size(), 1u);
+  EXPECT_EQ(contact[0].column_name, "email");
+
+  EXPECT_TRUE(index.search("invoices", 10).empty());
+}
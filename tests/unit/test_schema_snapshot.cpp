@@ -0,0 +1,140 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "include/schema_snapshot.hpp"
+
+using namespace pg_ai;
+
+class SchemaSnapshotTest : public ::testing::Test {
+ protected:
+  std::filesystem::path temp_dir_;
+
+  void SetUp() override {
+    temp_dir_ =
+        std::filesystem::temp_directory_path() / "pg_ai_schema_snapshot_test";
+    std::filesystem::create_directories(temp_dir_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(temp_dir_); }
+
+  std::string path() const { return (temp_dir_ / "schema.snap").string(); }
+
+  static DatabaseSchema schema() {
+    DatabaseSchema schema{.tables = {}, .success = true, .error_message = ""};
+    schema.tables.push_back(TableInfo{.table_name = "customers",
+                                      .schema_name = "public",
+                                      .table_type = "BASE TABLE",
+                                      .estimated_rows = 10,
+                                      .relid = 300});
+    schema.tables.push_back(TableInfo{.table_name = "orders",
+                                      .schema_name = "public",
+                                      .table_type = "BASE TABLE",
+                                      .estimated_rows = 50,
+                                      .relid = 100,
+                                      .row_security = false,
+                                      .description = "One row per checkout"});
+    return schema;
+  }
+
+  static std::map<uint32_t, TableDetails> details() {
+    TableDetails orders{.table_name = "orders",
+                        .schema_name = "public",
+                        .columns = {},
+                        .indexes = {},
+                        .success = true,
+                        .error_message = ""};
+    orders.columns.push_back(ColumnInfo{.column_name = "id",
+                                        .data_type = "integer",
+                                        .is_nullable = false,
+                                        .column_default = "",
+                                        .is_primary_key = true,
+                                        .is_foreign_key = false,
+                                        .foreign_table = "",
+                                        .foreign_column = ""});
+    orders.columns.push_back(ColumnInfo{.column_name = "customer_id",
+                                        .data_type = "integer",
+                                        .is_nullable = true,
+                                        .column_default = "",
+                                        .is_primary_key = false,
+                                        .is_foreign_key = true,
+                                        .foreign_table = "customers",
+                                        .foreign_column = "id",
+                                        .description = "NULL for guests"});
+    orders.indexes.emplace_back(
+        "CREATE UNIQUE INDEX orders_pkey ON public.orders USING btree (id)");
+    std::map<uint32_t, TableDetails> details;
+    details.emplace(100, orders);
+    return details;
+  }
+};
+
+// Test that a written snapshot maps back to the same tables and details
+TEST_F(SchemaSnapshotTest, MapsWrittenSnapshot) {
+  ASSERT_TRUE(SchemaSnapshot::write(
+      path(), SchemaSnapshot::serialize(42, schema(), details())));
+
+  auto snapshot = SchemaSnapshot::open(path());
+  ASSERT_TRUE(snapshot.has_value());
+  EXPECT_EQ(snapshot->version(), 42u);
+  EXPECT_FALSE(snapshot->replaced(path()));
+
+  auto tables = snapshot->tables();
+  EXPECT_TRUE(tables.success);
+  ASSERT_EQ(tables.tables.size(), 2u);
+  EXPECT_EQ(tables.tables[0].table_name, "customers");
+  EXPECT_EQ(tables.tables[0].relid, 300u);
+  EXPECT_EQ(tables.tables[1].table_type, "BASE TABLE");
+  EXPECT_EQ(tables.tables[1].estimated_rows, 50);
+  EXPECT_EQ(tables.tables[1].description, "One row per checkout");
+  EXPECT_TRUE(tables.tables[0].description.empty());
+
+  auto orders = snapshot->details(100);
+  ASSERT_TRUE(orders.has_value());
+  EXPECT_EQ(orders->table_name, "orders");
+  ASSERT_EQ(orders->columns.size(), 2u);
+  EXPECT_TRUE(orders->columns[0].is_primary_key);
+  EXPECT_FALSE(orders->columns[0].is_nullable);
+  EXPECT_TRUE(orders->columns[1].is_foreign_key);
+  EXPECT_EQ(orders->columns[1].foreign_table, "customers");
+  EXPECT_EQ(orders->columns[1].description, "NULL for guests");
+  EXPECT_EQ(orders->description, "One row per checkout");
+  ASSERT_EQ(orders->indexes.size(), 1u);
+
+  // Listed without details, and not listed at all
+  EXPECT_FALSE(snapshot->details(300).has_value());
+  EXPECT_FALSE(snapshot->details(999).has_value());
+}
+
+// Test that replacing the file leaves an open mapping intact
+TEST_F(SchemaSnapshotTest, DetectsReplacedFile) {
+  ASSERT_TRUE(SchemaSnapshot::write(
+      path(), SchemaSnapshot::serialize(1, schema(), details())));
+  auto snapshot = SchemaSnapshot::open(path());
+  ASSERT_TRUE(snapshot.has_value());
+
+  ASSERT_TRUE(SchemaSnapshot::write(
+      path(), SchemaSnapshot::serialize(2, schema(), {})));
+  EXPECT_TRUE(snapshot->replaced(path()));
+  EXPECT_EQ(snapshot->version(), 1u);
+  EXPECT_TRUE(snapshot->details(100).has_value());
+
+  auto reopened = SchemaSnapshot::open(path());
+  ASSERT_TRUE(reopened.has_value());
+  EXPECT_EQ(reopened->version(), 2u);
+  EXPECT_FALSE(reopened->details(100).has_value());
+}
+
+// Test that missing, truncated and foreign files are rejected
+TEST_F(SchemaSnapshotTest, RejectsInvalidFiles) {
+  EXPECT_FALSE(SchemaSnapshot::open(path()).has_value());
+
+  std::string contents = SchemaSnapshot::serialize(1, schema(), details());
+  ASSERT_TRUE(SchemaSnapshot::write(
+      path(), std::string_view(contents).substr(0, contents.size() - 1)));
+  EXPECT_FALSE(SchemaSnapshot::open(path()).has_value());
+
+  std::ofstream(path(), std::ios::trunc) << "not a schema snapshot at all, "
+                                             "just some text in a file";
+  EXPECT_FALSE(SchemaSnapshot::open(path()).has_value());
+}
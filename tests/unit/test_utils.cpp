@@ -3,6 +3,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <nlohmann/json.hpp>
+
 #include "../test_helpers.hpp"
 #include "include/utils.hpp"
 
@@ -170,6 +172,50 @@ TEST_F(UtilsTest, FormatAPIErrorMissingErrorKey) {
   EXPECT_EQ(formatted, raw_error);
 }
 
+// Test appendJsonString with plain text
+TEST_F(UtilsTest, AppendJsonStringPlain) {
+  std::string out = "{\"text\":";
+  appendJsonString(out, "SELECT * FROM users");
+  out += '}';
+
+  EXPECT_EQ(out, R"({"text":"SELECT * FROM users"})");
+}
+
+// Test appendJsonString escapes quotes, backslashes and control characters
+TEST_F(UtilsTest, AppendJsonStringEscapes) {
+  std::string out;
+  appendJsonString(out, std::string("a\"b\\c\nd\te\x01", 10));
+
+  EXPECT_EQ(out, R"("a\"b\\c\nd\te\u0001")");
+}
+
+// Test appendJsonString output round-trips through a JSON parser
+TEST_F(UtilsTest, AppendJsonStringRoundTrip) {
+  std::string value =
+      "Schema info:\n- public.\"Orders\" (~10 rows)\r\n\xc3\xa9";
+  std::string out;
+  appendJsonString(out, value);
+
+  EXPECT_EQ(nlohmann::json::parse(out).get<std::string>(), value);
+}
+
+// Test oneLine collapses whitespace and keeps short text whole
+TEST_F(UtilsTest, OneLineCollapsesWhitespace) {
+  EXPECT_EQ(oneLine("  Amount in\n\tcents  ", 40), "Amount in cents");
+  EXPECT_EQ(oneLine("abc   ", 3), "abc");
+  EXPECT_EQ(oneLine("", 10), "");
+}
+
+// Test oneLine cuts long text at a word or character boundary
+TEST_F(UtilsTest, OneLineClipsLongText) {
+  EXPECT_EQ(oneLine("Amount in cents.\nNever negative.", 22),
+            "Amount in cents. Never...");
+  EXPECT_EQ(oneLine("abc def", 3), "abc...");
+  EXPECT_EQ(oneLine("abcdefgh", 4), "abcd...");
+  // "caf\xc3\xa9" must not be split inside the two-byte character
+  EXPECT_EQ(oneLine("caf\xc3\xa9s", 4), "caf...");
+}
+
 // Test reading actual fixture files
 TEST_F(UtilsTest, ReadFixtureFiles) {
   std::string config_path = getConfigFixture("valid_config.ini");